@@ -75,11 +75,15 @@ build: $(PROJECT).elf
 
 bin: $(PROJECT).bin
 
-flash: all
+hex: $(PROJECT).hex
+
+#Flashed from the .hex, which only holds the regions the image uses; a .bin fills any gap in the
+# image (e.g. the persist sectors on the STM32F410) and so would erase it
+flash: $(PROJECT).hex
 ifeq 'nucleo' '$(PROGRAMMER)'
-	@cp $(PROJECT).bin $(NUCLEO_FOLDER)/
+	@cp $(PROJECT).hex $(NUCLEO_FOLDER)/
 else
-	st-flash write $(PROJECT).bin 0x8000000
+	st-flash --format ihex write $(PROJECT).hex
 endif
 
 
@@ -116,10 +120,14 @@ $(PROJECT).asm: $(PROJECT).elf
 	@$(SIZE) -d "$<"
 	@$(OBJCOPY) -O binary -R .eeprom "$<" "$@"
 
+%.hex: %.elf
+	@echo "[HEX]\t$@"
+	@$(OBJCOPY) -O ihex -R .eeprom "$<" "$@"
+
 # compiler generated dependency info
 -include $(OBJS:.o=.d)
 
 clean:
 	@echo Cleaning...
 	@rm -rf "$(BUILDDIR)"
-	@rm -f "$(PROJECT).elf" "$(PROJECT).bin"
+	@rm -f "$(PROJECT).elf" "$(PROJECT).bin" "$(PROJECT).hex"
@@ -229,18 +229,18 @@ uint16_t SD::skip(uint16_t len) {
 /*
  * Using this method is a really bad idea
  */
-uint8_t SD::read(uint8_t* a){
-	uint8_t result;
-	uint16_t read = this->read(&result, 1);
-	return (read == 1) ? result : 0;
+uint8_t SD::read(uint8_t* b){
+	return this->read(b, 2);
 }
 
 uint16_t SD::read(uint8_t* a, uint16_t len){
-	if (status > 0) return 0;
+	if (status > 0 || len == 0) return 0;
+	len--;	//Same contract as Stream::read; at most len - 1 bytes
 
-	if (len > 512 || 512 - len < this->position) {
+	if (len > 512 - this->position) {
 		len = 512 - this->position;
 	}
+	if (len == 0) return 0;
 	uint16_t count = 0;
 	uint8_t b = 0;
 	uint32_t resp;
@@ -265,7 +265,7 @@ uint16_t SD::read(uint8_t* a, uint16_t len){
 	// read all 512 bytes, filling the array with the requested bytes
 	for (uint16_t i = 0; i < 512; i++) {
 		b = SDIO->FIFO;
-		if (i == this->position && count < (len - 1)) {
+		if (i >= this->position && count < len) {
 			a[count++] = b;
 		}
 	}
@@ -282,6 +282,7 @@ uint16_t SD::read(uint8_t* a, uint16_t len){
 	// Clear the static SDIO flags
 	SDIO->ICR = SDIO_ICR_STATIC;
 
+	this->position += count;
 	return count;
 }
 
@@ -13,30 +13,47 @@ using namespace digitalcave;
 
 #define Cmd0_GoIdleState           0x00
 #define Cmd8_SendIfCond            0x48
+#define Cmd12_StopTransmission     0x0c
 #define Cmd16_SetBlockLength       0x10
 #define Cmd17_ReadSingleBlock      0x11
+#define Cmd18_ReadMultipleBlock    0x12
+#define Cmd24_WriteBlock           0x18
+#define Cmd25_WriteMultipleBlock   0x19
 #define Cmd55_ApplicationCommand   0x37
-#define Cmd58_ReadOCR              0x3a
+#define Cmd58_ReadOCR              0x7a
 
 #define ACmd41_SendOpCond          0x29
 
 #define R1_IllegalCommand          0x04
 #define R1_InIdleState             0x01
 
+#define Token_StartBlock           0xfe
+#define Token_StartMultipleWrite   0xfc
+#define Token_StopTransmission     0xfd
+#define DataResponse_Mask          0x1f
+#define DataResponse_Accepted      0x05
+
 SD::SD(volatile uint8_t* port_cs, uint8_t pin_cs) :
 	port_cs(port_cs),
 	pin_cs(pin_cs),
 	block(0),
-	position(0)
+	position(0),
+	high_capacity(0),
+	stream(SD_STREAM_NONE),
+	stream_block(0),
+	stream_offset(0)
 {
 	*(this->port_cs - 0x01) |= this->pin_cs;	// Set CS DDR to output
+	this->deselect();
 	DDR_SPI = (1<<DD_MOSI)|(1<<DD_SCK);     // Set MOSI and SCK output
 	SPCR = (1<<SPE)|(1<<MSTR); //Enable SPI, Master
 
 	this->status = this->init();
+	this->deselect();
 }
 
 SD::~SD() {
+	this->flush();
 }
 
 void SD::select() {
@@ -64,7 +81,7 @@ uint8_t SD::transfer(uint8_t b) {
 }
 
 /*
- * Sends a command.
+ * Sends a command, and leaves the card selected.
  * bit 7 of cmd is always 0
  * bit 6 of cmd indicates if a (1) 5 byte or (0) 1 byte response is expected.
  */
@@ -79,11 +96,16 @@ uint8_t SD::command(uint8_t cmd, uint32_t arg, uint32_t* resp) {
 
 	this->select();
 
+	// the card may still be busy programming a block; CMD12 is sent in the middle of a read, where there is no such thing
+	if (cmd != Cmd12_StopTransmission) {
+		this->wait_not_busy();
+	}
+
 	// crc is 7 bits + 1 stop bit (always 1)
 	uint8_t crc = 0xff;
 	// the CRC is important for these two commands and ignored for all others
 	if (cmd == Cmd0_GoIdleState) { crc = 0x95; }
-  else if (cmd == Cmd8_SendIfCond) { crc = 0x87; }
+	else if (cmd == Cmd8_SendIfCond) { crc = 0x87; }
 
 	uint8_t result;
 	uint8_t responseValues[4];
@@ -93,6 +115,10 @@ uint8_t SD::command(uint8_t cmd, uint32_t arg, uint32_t* resp) {
 	this->transfer(arg>>8);
 	this->transfer(arg);
 	this->transfer(crc);
+	if (cmd == Cmd12_StopTransmission) {
+		// the byte after CMD12 is left over from the data being read
+		this->transfer(0xff);
+	}
 	// read until start bit is 0, up to 16 times
 	for (uint8_t i = 0; ((result = this->transfer(0xff)) & 0x80) && i < 0x10; i++);
 
@@ -109,39 +135,39 @@ uint8_t SD::command(uint8_t cmd, uint32_t arg, uint32_t* resp) {
 			(responseValues[3]);
 		}
 	}
-	this->deselect();
 	return result;
 }
 
+/* Waits for the card to release MISO (it holds it low while busy); returns 0 on timeout */
+uint8_t SD::wait_not_busy() {
+	for (uint32_t i = 0; i < SD_TIMEOUT; i++) {
+		if (this->transfer(0xff) == 0xff) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /* Initialize the card; return 1 if successful, or 0 if unsuccessful */
 uint8_t SD::init() {
 	uint8_t i;
 	uint8_t type;
-	uint8_t result;
+	uint8_t result = 0;
 	uint32_t resp;
 
 	this->slow_clock();
 
-	// send clock pulses for 80 cycles
+	// send clock pulses for 80 cycles, with the card deselected
 	// it's this clocking that switches the card from SDIO to SPI mode
-	this->select();
-	for (i=0; i<10; i++) {
+	for (i = 0; i < 10; i++) {
 		this->transfer(0xff);
 	}
 
-	// send clock pulses for 16 more cycles
-	this->deselect();
-	this->transfer(0xff);
-	this->transfer(0xff);
-
 	// try up to 10 times to reset the card and put it into idle state
-	for (i = 0; i < 10; i++) {
+	for (i = 0; i < 10 && result != R1_InIdleState; i++) {
 		result = this->command(Cmd0_GoIdleState, 0, 0);
-		if (result == R1_InIdleState) {
-			i = 0xf;
-		}
 	}
-	if (i < 0xf) {
+	if (result != R1_InIdleState) {
 		return 0; // card did not reset and go into idle state
 	}
 
@@ -158,26 +184,28 @@ uint8_t SD::init() {
 		type = 2; // SD 2.0 SDHC, SDCX
 	}
 
-	// try up to 10 times to initialize the card and have it go idle
-	for (i = 0; i < 10; i++) {
+	// wait up to about a second for the card to finish initializing and leave the idle state
+	for (uint16_t j = 0; ; j++) {
 		// flag the next command as an application command
-		result = this->command(Cmd55_ApplicationCommand, 0, 0);
-		// have the card send it's OCR
+		this->command(Cmd55_ApplicationCommand, 0, 0);
 		uint32_t arg = type == 2 ? 0x40000000 : 0x00; // enable HCS flag for type 2 cards
-		result = this->command(ACmd41_SendOpCond, arg, &resp);
-		if (result == R1_InIdleState) {
-			i = 0xf;
+		result = this->command(ACmd41_SendOpCond, arg, 0);
+		if (result == 0) {
+			break;
 		}
-	}
-	if (i < 0xf) {
-		return 0; // card did not go idle in 10 attempts
+		if (j == 1000) {
+			return 0; // card did not finish initializing
+		}
+		_delay_ms(1);
 	}
 
 	// read the operating conditions
 	result = this->command(Cmd58_ReadOCR, 0, &resp);
-  if ((resp & 0x300000) == 0) { // either bit 20 or 21 must be set to indicate 3.3V
+	if (result != 0 || (resp & 0x300000) == 0) { // either bit 20 or 21 must be set to indicate 3.3V
 		return 0; // card does not allow 3.3V
 	}
+	// CCS is set for cards addressed by block rather than by byte
+	this->high_capacity = (type == 2 && (resp & 0x40000000));
 
 	// set the block length to 512 bytes
 	result = this->command(Cmd16_SetBlockLength, 0x200, 0);
@@ -187,6 +215,156 @@ uint8_t SD::init() {
 	return 1;
 }
 
+uint8_t SD::stop() {
+	uint8_t result = 1;
+	if (this->stream == SD_STREAM_READ) {
+#if SD_STREAM
+		result = this->command(Cmd12_StopTransmission, 0, 0) == 0;
+		result &= this->wait_not_busy();
+#else
+		// a single block read can't be stopped; clock out the rest of it
+		if (this->stream_offset != 0xffff || this->wait_token()) {
+			this->receive(0, BLOCK_DEVICE_BLOCK_SIZE - this->stream_offset);
+		}
+#endif
+	} else if (this->stream == SD_STREAM_WRITE) {
+		// the stop token, then wait for the card to program the last block
+		result = this->wait_not_busy();
+		this->transfer(Token_StopTransmission);
+		this->transfer(0xff);
+		result &= this->wait_not_busy();
+	}
+	this->stream = SD_STREAM_NONE;
+	return result;
+}
+
+void SD::release() {
+	if (this->stream == SD_STREAM_NONE) {
+		this->deselect();
+	}
+}
+
+uint8_t SD::wait_token() {
+	for (uint32_t i = 0; i < SD_TIMEOUT; i++) {
+		uint8_t b = this->transfer(0xff);
+		if (b == Token_StartBlock) {
+			this->stream_offset = 0;
+			return 1;
+		} else if (b != 0xff) {
+			// error token
+			break;
+		}
+	}
+	return 0;
+}
+
+uint8_t SD::seek(uint32_t block, uint16_t position) {
+	// carry on with the open read if it has not gone past the position yet
+	uint8_t carry_on = 0;
+	if (this->stream == SD_STREAM_READ) {
+		if (block == this->stream_block) {
+			carry_on = this->stream_offset == 0xffff || this->stream_offset <= position;
+		} else if (SD_STREAM && block == this->stream_block + 1) {
+			carry_on = 1;
+		}
+	}
+
+	if (!carry_on) {
+		this->stop();
+		uint32_t arg = this->high_capacity ? block : block << 9;
+		if (this->command(SD_STREAM ? Cmd18_ReadMultipleBlock : Cmd17_ReadSingleBlock, arg, 0) != 0) {
+			return 0;
+		}
+		this->stream = SD_STREAM_READ;
+		this->stream_block = block;
+		this->stream_offset = 0xffff;
+	}
+
+	if (this->stream_block != block) {
+		// the rest of the block before, which the card sends first
+		if (this->stream_offset == 0xffff && !this->wait_token()) {
+			this->stop();
+			return 0;
+		}
+		this->receive(0, BLOCK_DEVICE_BLOCK_SIZE - this->stream_offset);
+	}
+	if (this->stream_offset == 0xffff && !this->wait_token()) {
+		this->stop();
+		return 0;
+	}
+	this->receive(0, position - this->stream_offset);
+	return 1;
+}
+
+void SD::receive(uint8_t* a, uint16_t len) {
+	for (uint16_t i = 0; i < len; i++) {
+		uint8_t b = this->transfer(0xff);
+		if (a) {
+			a[i] = b;
+		}
+	}
+	this->stream_offset += len;
+
+	if (this->stream_offset == BLOCK_DEVICE_BLOCK_SIZE) {
+		// the CRC, which is ignored
+		this->transfer(0xff);
+		this->transfer(0xff);
+#if SD_STREAM
+		// the card goes straight on to the next block
+		this->stream_block++;
+		this->stream_offset = 0xffff;
+#else
+		this->stream = SD_STREAM_NONE;
+#endif
+	}
+}
+
+uint8_t SD::write_block(uint32_t block, uint8_t* data) {
+	uint32_t arg = this->high_capacity ? block : block << 9;
+#if SD_STREAM
+	if (this->stream != SD_STREAM_WRITE || this->stream_block != block) {
+		this->stop();
+		if (this->command(Cmd25_WriteMultipleBlock, arg, 0) != 0) {
+			return 0;
+		}
+		this->stream = SD_STREAM_WRITE;
+		this->stream_block = block;
+	}
+	// wait for the block before to be programmed (or, for the first one, the gap after the command)
+	if (!this->wait_not_busy()) {
+		this->stop();
+		return 0;
+	}
+	this->transfer(Token_StartMultipleWrite);
+#else
+	this->stop();
+	if (this->command(Cmd24_WriteBlock, arg, 0) != 0) {
+		return 0;
+	}
+	this->transfer(0xff);
+	this->transfer(Token_StartBlock);
+#endif
+
+	for (uint16_t i = 0; i < BLOCK_DEVICE_BLOCK_SIZE; i++) {
+		this->transfer(data[i]);
+	}
+	// CRC, which is ignored
+	this->transfer(0xff);
+	this->transfer(0xff);
+
+	if ((this->transfer(0xff) & DataResponse_Mask) != DataResponse_Accepted) {
+		this->stop();
+		return 0;
+	}
+#if SD_STREAM
+	this->stream_block++;
+	return 1;
+#else
+	// wait for the block to be programmed
+	return this->wait_not_busy();
+#endif
+}
+
 void SD::setBlock(uint32_t block) {
 	this->block = block;
 	this->position = 0;
@@ -200,64 +378,70 @@ uint16_t SD::skip(uint16_t len) {
 	return len;
 }
 
-/*
- * Using this method is a really bad idea
- */
-uint8_t SD::read(uint8_t* a){
-	uint8_t result;
-	uint16_t read = this->read(&result, 1);
-	return (read == 1) ? result : 0;
+uint8_t SD::read(uint8_t* b){
+	return this->read(b, 2);
 }
 
 uint16_t SD::read(uint8_t* a, uint16_t len){
-	if (status > 0) return 0;
+	if (!this->status || len == 0) return 0;
+	len--;	//Same contract as Stream::read; at most len - 1 bytes
 
-	if (len > 512 || 512 - len < this->position) {
+	if (len > 512 - this->position) {
 		len = 512 - this->position;
 	}
-	uint16_t count = 0;
-	uint8_t b = 0;
-	uint32_t resp;
+	if (len == 0) return 0;
 
-  uint8_t result = this->command(Cmd17_ReadSingleBlock, this->block, &resp);
-	if (result != 0) {
-		this->deselect();
+	this->select();
+	if (!this->seek(this->block, this->position)) {
+		this->release();
 		return 0;
 	}
+	this->receive(a, len);
+	this->position += len;
+	this->release();
 
-	for (uint8_t i = 0; i < 16; i++){
-		b = this->transfer(0xff);
-		if (b == 0xff) {
-			_delay_ms(100);
-		} else {
+	return len;
+}
+
+// Parts of blocks can't be written; see SD.h
+uint8_t SD::write(uint8_t b) {
+	return 0;
+}
+
+uint8_t SD::readBlocks(uint32_t address, uint8_t** buffers, uint8_t count) {
+	if (!this->status) return 0;
+
+	this->select();
+	uint8_t i;
+	for (i = 0; i < count; i++) {
+		if (!this->seek(address + i, 0)) {
 			break;
 		}
-		if (b != 0xfe) {
-			// last byte read was not the data token
-			// either an error token was read or the card was busy
-			this->deselect();
-			return 0;
-		}
+		this->receive(buffers[i], BLOCK_DEVICE_BLOCK_SIZE);
 	}
+	this->release();
+	return i;
+}
 
-	// read all 512 bytes, filling the array with the requested bytes
-	for (uint16_t i = 0; i < 512; i++) {
-		b = this->transfer(0xff);
-		if (i == this->position && count < (len - 1)) {
-			a[count++] = b;
+uint8_t SD::writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count) {
+	if (!this->status) return 0;
+
+	this->select();
+	uint8_t i;
+	for (i = 0; i < count; i++) {
+		if (!this->write_block(address + i, buffers[i])) {
+			break;
 		}
 	}
+	this->release();
+	return i;
+}
 
-	// read the CRC bytes
-	b = this->transfer(0xff);
-	b = this->transfer(0xff);
+uint8_t SD::flush() {
+	if (!this->status) return 0;
 
+	this->select();
+	uint8_t result = this->stop();
 	this->deselect();
-
-	return count;
-}
-
-// TODO for now just read-only
-uint8_t SD::write(uint8_t b) {
-	return 0;
+	return result;
 }
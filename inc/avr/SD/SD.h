@@ -4,6 +4,39 @@
 #include <Stream.h>
 #include <BlockDevice.h>
 
+/*
+ * SD card in SPI mode.
+ *
+ * Reads, and whole block writes, use the card's multiple block commands (CMD18 / CMD25).  Once a
+ * transfer has been started it is left open, and as long as the next access is to the same
+ * block (further on) or the one after it, it just carries on without another command, and
+ * without waiting for the card to find the block again.  Anything else (going backwards,
+ * jumping ahead, switching between reading and writing) stops the transfer and starts a new
+ * one.  While a transfer is open the card stays selected; call flush() to end it before using
+ * other devices on the same SPI bus, and after writing, so that the last block is programmed
+ * before the power goes.
+ *
+ * Blocks can only be written whole, with writeBlocks() / writeBlock(); the stream write
+ * functions return 0.  Put a BlockCache in front of the card to write parts of blocks.
+ */
+
+/*
+ * Set to 0 to transfer one block per command (CMD17 / CMD24) instead, for cards which do not
+ * handle multiple block transfers properly.
+ */
+#ifndef SD_STREAM
+#define SD_STREAM			1
+#endif
+
+/* Bytes to poll for a data token, or for the card to finish programming, before giving up */
+#ifndef SD_TIMEOUT
+#define SD_TIMEOUT			0x7ffffUL
+#endif
+
+#define SD_STREAM_NONE		0
+#define SD_STREAM_READ		1
+#define SD_STREAM_WRITE		2
+
 namespace digitalcave {
 	class SD : public BlockDevice {
 
@@ -12,7 +45,13 @@ namespace digitalcave {
 			uint8_t pin_cs;
 			uint32_t block;
 			uint16_t position;
-			uint8_t status;
+			uint8_t status;				// 1 once the card has been initialized
+			uint8_t high_capacity;		// SDHC / SDXC cards are addressed in blocks, older cards in bytes
+
+			// open transfer
+			uint8_t stream;				// SD_STREAM_NONE / _READ / _WRITE
+			uint32_t stream_block;		// block being read, or the next block to be written
+			uint16_t stream_offset;		// bytes of stream_block clocked out so far; 0xffff before its data token
 
 			uint8_t init();
 			void fast_clock();
@@ -21,6 +60,20 @@ namespace digitalcave {
 			void deselect();
 			uint8_t transfer(uint8_t b);
 			uint8_t command(uint8_t cmd, uint32_t arg, uint32_t* resp);
+			uint8_t wait_not_busy();
+
+			/* Ends the open transfer, if any; returns 0 if the card reported an error */
+			uint8_t stop();
+			/* Deselects the card, unless a transfer is open */
+			void release();
+			/* Gets the read transfer to the given position, starting a new one if needed; returns 0 on error */
+			uint8_t seek(uint32_t block, uint16_t position);
+			/* Waits for the data token at the start of stream_block; returns 0 on timeout or an error token */
+			uint8_t wait_token();
+			/* Clocks in len bytes of the block being read; a may be NULL to discard them */
+			void receive(uint8_t* a, uint16_t len);
+			/* Writes a whole block; returns 0 on error */
+			uint8_t write_block(uint32_t block, uint8_t* data);
 		public:
 			SD(volatile uint8_t* cs_port, uint8_t cs_pin);
 			~SD();
@@ -32,6 +85,10 @@ namespace digitalcave {
 			uint16_t read(uint8_t* a, uint16_t len);
 			uint8_t write(uint8_t b);
 
+			uint8_t readBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+			uint8_t writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+			uint8_t flush();
+
 			using BlockDevice::read;
 			using BlockDevice::write;
 	};
@@ -10,3 +10,15 @@ uint8_t persist_read(uint32_t address, uint8_t* data, uint16_t length){
 	eeprom_read_block(data, (void*) (uint16_t) address, length);
 	return 0;
 }
+
+uint8_t persist_poll(){
+	return 0;
+}
+
+uint8_t persist_poll_erases(){
+	return 0;
+}
+
+uint8_t persist_write_erases(uint32_t address, uint16_t length){
+	return 0;
+}
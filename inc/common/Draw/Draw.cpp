@@ -1,5 +1,5 @@
 #include "Draw.h"
-#include <avr/pgmspace.h>
+#include "../font/font.h"
 
 using namespace digitalcave;
 
@@ -29,9 +29,51 @@ uint8_t Draw::getOverlay() {
 	return overlay;
 }
 
+void Draw::flush() {
+}
+
+void Draw::hline(int16_t x0, int16_t x1, int16_t y) {
+	if (x0 > x1) swap(x0, x1);
+	for (; x0 <= x1; x0++) setPixel(x0, y);
+}
+
+void Draw::vline(int16_t x, int16_t y0, int16_t y1) {
+	if (y0 > y1) swap(y0, y1);
+	for (; y0 <= y1; y0++) setPixel(x, y0);
+}
+
+void Draw::fillRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+	if (y0 > y1) swap(y0, y1);
+	for (; y0 <= y1; y0++) hline(x0, x1, y0);
+}
+
+uint8_t Draw::getDirty(int16_t* x0, int16_t* y0, int16_t* x1, int16_t* y1) {
+	if (dirty_x0 > dirty_x1) return 0;
+	*x0 = dirty_x0;
+	*y0 = dirty_y0;
+	*x1 = dirty_x1;
+	*y1 = dirty_y1;
+	return 1;
+}
+
+void Draw::clearDirty() {
+	dirty_x0 = 1;
+	dirty_x1 = 0;
+}
+
 // Implementation of Bresenham's algorithm; adapted from Lady Ada's GLCD library,
-// which was in turn adapted from Wikpedia.
+// which was in turn adapted from Wikpedia.  Each run of pixels along the major axis
+// is drawn as one span.
 void Draw::line(int16_t x0, int16_t y0, int16_t x1, int16_t y1){
+	if (y0 == y1) {
+		hline(x0, x1, y0);
+		return;
+	}
+	if (x0 == x1) {
+		vline(x0, y0, y1);
+		return;
+	}
+
 	uint8_t steep = abs(y1 - y0) > abs(x1 - x0);
 
 	if (steep) {
@@ -48,7 +90,7 @@ void Draw::line(int16_t x0, int16_t y0, int16_t x1, int16_t y1){
 	dx = x1 - x0;
 	dy = abs(y1 - y0);
 
-	int8_t err = dx / 2;
+	int16_t err = dx / 2;
 	int8_t ystep;
 
 	if (y0 < y1) {
@@ -58,14 +100,18 @@ void Draw::line(int16_t x0, int16_t y0, int16_t x1, int16_t y1){
 		ystep = -1;
 	}
 
+	int16_t start = x0;
 	for (; x0 <= x1; x0++) {
-		if (steep) {
-			setPixel(y0, x0);
-		}
-		else {
-			setPixel(x0, y0);
-		}
 		err -= dy;
+		if (err < 0 || x0 == x1) {
+			if (steep) {
+				vline(y0, start, x0);
+			}
+			else {
+				hline(start, x0, y0);
+			}
+			start = x0 + 1;
+		}
 		if (err < 0) {
 			y0 += ystep;
 			err += dx;
@@ -78,10 +124,17 @@ void Draw::rectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t f)
 	if (x0 > x1) swap(x0, x1);
 	if (y0 > y1) swap(y0, y1);
 
-	for(int16_t x = x0; x <= x1; x++){
-		for (int16_t y = y0; y <= y1; y++){
-			if (f || x == x0 || x == x1 || y == y0 || y == y1) setPixel(x, y);
-		}
+	if (f) {
+		fillRect(x0, y0, x1, y1);
+		return;
+	}
+
+	//Each pixel once, so that XOR outlines work
+	hline(x0, x1, y0);
+	if (y1 > y0) hline(x0, x1, y1);
+	if (y1 - y0 > 1) {
+		vline(x0, y0 + 1, y1 - 1);
+		if (x1 > x0) vline(x1, y0 + 1, y1 - 1);
 	}
 }
 
@@ -96,7 +149,7 @@ void Draw::text(int16_t x, int16_t y, const char* text, uint8_t orientation) {
 }
 void Draw::character(int16_t x, int16_t y, char c, uint8_t orientation) {
 	//Find the entry in the code page
-	uint8_t glyph_index = pgm_read_byte_near(font_codepage + (uint8_t) c);
+	uint8_t glyph_index = font_read_byte(font_codepage + (uint8_t) c);
 
 	if (glyph_index != 0xFF) {
 		bitmap(x, y, font_width, font_height, orientation, font + (glyph_index * font_glyph_byte_ct));
@@ -115,8 +168,8 @@ void Draw::circle(int16_t x0, int16_t y0, uint8_t r, uint8_t fill){
 	int8_t y = r;
 
 	if (fill){
-		line(max(0, x0), max(0, y0 - r), max(0, x0), max(0, y0 + r));
-		line(max(0, x0 - r), max(0, y0), max(0, x0 + r), max(0, y0));
+		vline(max(0, x0), max(0, y0 - r), max(0, y0 + r));
+		hline(max(0, x0 - r), max(0, x0 + r), max(0, y0));
 	}
 	else {
 		setPixel(x0, y0 + r);
@@ -138,10 +191,10 @@ void Draw::circle(int16_t x0, int16_t y0, uint8_t r, uint8_t fill){
 		ddF_x += 2;
 		f += ddF_x;
 		if (fill){
-			line(max(0, x0 - x), max(0, y0 + y), max(0, x0 + x), max(0, y0 + y));
-			line(max(0, x0 - x), max(0, y0 - y), max(0, x0 + x), max(0, y0 - y));
-			line(max(0, x0 - y), max(0, y0 + x), max(0, x0 + y), max(0, y0 + x));
-			line(max(0, x0 - y), max(0, y0 - x), max(0, x0 + y), max(0, y0 - x));
+			hline(max(0, x0 - x), max(0, x0 + x), max(0, y0 + y));
+			hline(max(0, x0 - x), max(0, x0 + x), max(0, y0 - y));
+			hline(max(0, x0 - y), max(0, x0 + y), max(0, y0 + x));
+			hline(max(0, x0 - y), max(0, x0 + y), max(0, y0 - x));
 		}
 		else {
 			setPixel(x0 + x, y0 + y);
@@ -156,3 +209,101 @@ void Draw::circle(int16_t x0, int16_t y0, uint8_t r, uint8_t fill){
 	}
 
 }
+
+void Draw::bitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t orientation, uint8_t* bitmap){
+	//We need to figure out which bit the beginning of the character is, and how
+	// many bytes are used for a glyph.
+	uint8_t byteCount = ((width * height) >> 3); //(w*h)/8, int math
+	uint8_t bitCount = (width * height) & 0x7; //(w*h)%8
+	
+	uint8_t bitCounter = 7;
+	uint8_t byteCounter = 0;
+
+	// account for padding, if any
+	if (bitCount != 0) {
+		byteCount++;
+		bitCounter = bitCount - 1; // the padding is at the front of the first byte, so don't start at bit 0
+	}
+	//Runs of set pixels along a row (0, 180) or column (90, 270) are drawn as one span
+	int16_t run;
+	if (orientation == DRAW_ORIENTATION_0){
+		for(int16_t iy = y; iy < y + height; iy++){
+			run = -1;
+			for(int16_t ix = x; ix < x + width; ix++){
+				if (font_read_byte(bitmap + byteCounter) & (1 << bitCounter)){
+					if (run < 0) run = ix;
+				}
+				else if (run >= 0){
+					hline(run, ix - 1, iy);
+					run = -1;
+				}
+				if (bitCounter == 0){
+					byteCounter++;
+					bitCounter = 8;
+				}
+				bitCounter--;
+			}
+			if (run >= 0) hline(run, x + width - 1, iy);
+		}
+	}
+	else if (orientation == DRAW_ORIENTATION_90){
+		for(int16_t ix = x + height - 1; ix >= x; ix--){
+			run = -1;
+			for(int16_t iy = y; iy < y + width; iy++){
+				if (font_read_byte(bitmap + byteCounter) & (1 << bitCounter)){
+					if (run < 0) run = iy;
+				}
+				else if (run >= 0){
+					vline(ix, run, iy - 1);
+					run = -1;
+				}
+				if (bitCounter == 0){
+					byteCounter++;
+					bitCounter = 8;
+				}
+				bitCounter--;
+			}
+			if (run >= 0) vline(ix, run, y + width - 1);
+		}
+	}
+	else if (orientation == DRAW_ORIENTATION_180){
+		for(int16_t iy = y + height - 1; iy >= y; iy--) {
+			run = -1;
+			for(int16_t ix = x + width - 1; ix >= x; ix--) {
+				if (font_read_byte(bitmap + byteCounter) & (1 << bitCounter)){
+					if (run < 0) run = ix;
+				}
+				else if (run >= 0){
+					hline(ix + 1, run, iy);
+					run = -1;
+				}
+				if (bitCounter == 0){
+					byteCounter++;
+					bitCounter = 8;
+				}
+				bitCounter--;
+			}
+			if (run >= 0) hline(x, run, iy);
+		}
+	}
+	else if (orientation == DRAW_ORIENTATION_270){
+		for (int16_t ix = x; ix < x + height; ix++){
+			run = -1;
+			for (int16_t iy = y + width - 1; iy >= y; iy--) {
+				if (font_read_byte(bitmap + byteCounter) & (1 << bitCounter)){
+					if (run < 0) run = iy;
+				}
+				else if (run >= 0){
+					vline(ix, iy + 1, run);
+					run = -1;
+				}
+				if (bitCounter == 0){
+					byteCounter++;
+					bitCounter = 8;
+				}
+				bitCounter--;
+			}
+			if (run >= 0) vline(ix, y, run);
+		}
+	}
+}
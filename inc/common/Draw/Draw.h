@@ -41,13 +41,53 @@ namespace digitalcave {
 		uint8_t blue;
 		uint8_t alpha;
 
+		//Bounding box of the pixels changed since the last clearDirty(); empty while dirty_x0 > dirty_x1
+		int16_t dirty_x0 = 1;
+		int16_t dirty_y0 = 1;
+		int16_t dirty_x1 = 0;
+		int16_t dirty_y1 = 0;
+
 	protected:
 		uint8_t overlay = DRAW_OVERLAY_REPLACE;
 
+		/*
+		 * Adds a rectangle (x0 <= x1, y0 <= y1) to the dirty region.  Drivers call this from setPixel()
+		 * and their span functions when they change the buffer.
+		 */
+		void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+			if (dirty_x0 > dirty_x1){
+				dirty_x0 = x0; dirty_y0 = y0; dirty_x1 = x1; dirty_y1 = y1;
+				return;
+			}
+			if (x0 < dirty_x0) dirty_x0 = x0;
+			if (y0 < dirty_y0) dirty_y0 = y0;
+			if (x1 > dirty_x1) dirty_x1 = x1;
+			if (y1 > dirty_y1) dirty_y1 = y1;
+		}
+
 	public:
-		virtual void setPixel(int16_t x, int16_t y);
+		virtual void setPixel(int16_t x, int16_t y) = 0;
 		virtual void flush();
 
+		/*
+		 * Draws a run of pixels from x0 to x1 in row y, from y0 to y1 in column x, or every pixel in
+		 * the rectangle with corners x0, y0 and x1, y1 (inclusive, either way around).  All of the
+		 * shapes below are drawn with these where they can be.  The defaults call setPixel() once per
+		 * pixel (fillRect() calls hline() once per row); drivers with a frame buffer should override
+		 * them to fill a whole run at once.
+		 */
+		virtual void hline(int16_t x0, int16_t x1, int16_t y);
+		virtual void vline(int16_t x, int16_t y0, int16_t y1);
+		virtual void fillRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+
+		/*
+		 * Gets the bounding box of everything the driver has marked dirty since the last clearDirty().
+		 * Returns 0 (and leaves the arguments alone) if nothing has changed.  A driver's flush() can use
+		 * this to send only the changed region to the display, and then clear it.
+		 */
+		uint8_t getDirty(int16_t* x0, int16_t* y0, int16_t* x1, int16_t* y1);
+		void clearDirty();
+
 		void setOverlay(uint8_t o);
 		uint8_t getOverlay();
 
@@ -58,11 +98,12 @@ namespace digitalcave {
 		void setColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 
 		/*
-		 * Draws a bitmap from flash memory of the specified size on the screen at the specified position.
+		 * Draws a bitmap from flash memory (FONT_PROGMEM) of the specified size on the screen at the specified position.
 		 * For every bit set in the bitmap a pixel of the specified value will be drawn with the specified overlay.
+		 * Drivers with a packed 1 bit buffer can override this to draw glyphs a byte at a time (see font/glyph.h).
 		 * Deprecated, use the Icon class instead
 		 */
-		void bitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t orientation, uint8_t* bitmap);
+		virtual void bitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t orientation, uint8_t* bitmap);
 
 		void setFont(uint8_t* font, uint8_t* codepage, uint8_t width, uint8_t height);
 		/*
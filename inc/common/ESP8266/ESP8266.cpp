@@ -1,5 +1,7 @@
 #include "ESP8266.h"
 
+#include <string.h>
+
 using namespace digitalcave;
 
 ESP8266::ESP8266(Stream* serial, uint8_t txBufferSize) :
@@ -138,6 +140,15 @@ uint8_t ESP8266::read(uint8_t* b) {
 	return 1;
 }
 
+uint16_t ESP8266::read(uint8_t* a, uint16_t len) {
+	if (data == NULL || len == 0) return 0;
+	uint16_t count = length - position;
+	if (count > len - 1) count = len - 1;
+	memcpy(a, data + position, count);
+	position += count;
+	return count;
+}
+
 void ESP8266::select(uint8_t id) {
 	this->id = id;
 	this->flush();
@@ -205,8 +216,11 @@ uint8_t ESP8266::flush() {
 	serial->write("\r\n");
 	serial->read(&b); 			// >
 	serial->read(&b); 			// sp
-	while (txBuffer.read(&b)) {
-		serial->write(b);
+	uint8_t* region;
+	uint8_t available;
+	while ((available = txBuffer.acquireRead(&region)) > 0) {
+		serial->write(region, available);
+		txBuffer.commitRead(available);
 	}
 	return at_response();
 }
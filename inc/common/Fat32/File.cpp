@@ -1,111 +1,552 @@
 #include "File.h"
 
+#include <string.h>
+
+#if FILE_MAX_EXTENTS < 2
+#error FILE_MAX_EXTENTS must be at least 2
+#endif
+
 using namespace digitalcave;
 
+// FAT entries are 28 bits; these values (and 0 / 1, which are not valid in a chain) end it
+#define FAT_ENTRY_MASK		0x0fffffff
+#define FAT_ENTRY_BAD		0x0ffffff7
+
+#define FAT_ENTRY_EOC		0x0fffffff
+
+// FAT entries read per block device call while walking a chain
+#define FAT_CHUNK			16
+
+// FSInfo fields
+#define FSINFO_FREE_COUNT	488
+#define FSINFO_UNKNOWN		0xffffffff
+
+// long file name entries hold 13 UCS-2 characters each, at these offsets
+static const uint8_t long_name_offsets[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+
+static uint16_t le16(uint8_t* b) {
+	return (((uint16_t)b[1]) << 8) | b[0];
+}
+
+static uint32_t le32(uint8_t* b) {
+	return (((uint32_t)b[3]) << 24) | (((uint32_t)b[2]) << 16) | (((uint16_t)b[1]) << 8) | b[0];
+}
+
+static void put_le16(uint8_t* b, uint16_t v) {
+	b[0] = v;
+	b[1] = v >> 8;
+}
+
+static void put_le32(uint8_t* b, uint32_t v) {
+	b[0] = v;
+	b[1] = v >> 8;
+	b[2] = v >> 16;
+	b[3] = v >> 24;
+}
+
 File::File(File* parent, uint8_t* name, uint8_t attrib, uint32_t cluster, uint32_t size) :
 	bd(parent->bd),
 	sectors_per_cluster(parent->sectors_per_cluster),
 	fat_begin_lba(parent->fat_begin_lba),
 	reserved_sectors(parent->reserved_sectors),
 	cluster_begin_lba(parent->cluster_begin_lba),
+	sectors_per_fat(parent->sectors_per_fat),
+	fat_count(parent->fat_count),
+	cluster_count(parent->cluster_count),
+	fsinfo_lba(parent->fsinfo_lba),
+	free_hint(parent->free_hint),
+	free_delta(0),
+	entry_lba(0),
+	entry_offset(0),
+	entry_dirty(0),
+	long_lba(0),
+	long_offset(0),
+	long_count(0),
 	attrib(attrib),
  	start_cluster(cluster),
 	size(size),
-	current_cluster(cluster),
-	sector(0),
 	position(0)
 {
 	for (uint8_t i = 0; i < 11; i++) {
 		this->name[i] = name[i];
 	}
+	init_chain(cluster);
 }
 
 File::File(BlockDevice* bd) :
 	bd(bd),
+	free_delta(0),
+	entry_lba(0),
+	entry_offset(0),
+	entry_dirty(0),
+	long_lba(0),
+	long_offset(0),
+	long_count(0),
 	attrib(0x18), // Filename is Volume ID, Is a subdirectory
-	sector(0),
+	size(0),
 	position(0)
 {
-	// read the MBR
-	uint8_t a[37];
+	memset(this->name, 0, sizeof(this->name));
+
+	// read the first partition entry of the MBR
+	uint8_t a[40];
+	uint32_t lba_begin = 0;
 	this->bd->setBlock(0);
-	this->bd->skip(255); this->bd->skip(191); // skip the 446 bytes of boot code
-	this->bd->read(a, 16);
+	this->bd->skip(446); // skip the boot code
+	this->bd->read(a, 17);
 	if (a[4] == 0x0b || a[4] == 0x0c) {
-		// FAT32; read the Volume ID
-		uint32_t lba_begin = (((uint32_t)a[8]) << 24) | (((uint32_t)a[9]) << 16) | (((uint16_t)a[10]) << 8) | a[11];
-
-		this->bd->setBlock(lba_begin);
-		this->bd->skip(11);
-		this->bd->read(a, 37);
-		if (a[0] == 0x02 && a[1] == 0x00) {
-			// verified 512 bytes per sector
-		}
-		this->sectors_per_cluster = a[2];
-		uint16_t reserved_sectors = (a[3] << 8) | a[4];
-		if (a[5] == 0x02) {
-			// verified 2 FATs
-		}
-		uint32_t sectors_per_fat = (((uint32_t)a[25]) << 24) | (((uint32_t)a[26]) << 16) | (((uint16_t)a[27]) << 8) | a[28];
-		this->start_cluster = (((uint32_t)a[33]) << 24) | (((uint32_t)a[34]) << 16) | (((uint16_t)a[35]) << 8) | a[36];
-		this->fat_begin_lba = lba_begin + reserved_sectors;
-		this->cluster_begin_lba = this->fat_begin_lba + (sectors_per_fat << 1);
+		// FAT32 partition
+		lba_begin = le32(&a[8]);
+	}
+	// else assume there is no partition table, and the volume starts at block 0 (as made by mkfs.fat on a whole device)
+
+	// read the Volume ID
+	this->bd->setBlock(lba_begin);
+	this->bd->skip(11);
+	if (this->bd->read(a, 40) < 39 || le16(&a[0]) != 512 || a[2] == 0 || a[5] == 0 || le16(&a[11]) != 0) {
+		// not 512 bytes per sector, no clusters, no FATs, or a FAT12 / FAT16 sector count; unknown filesystem
+		this->bd = NULL;
+		init_chain(0);
+		return;
+	}
+	this->sectors_per_cluster = a[2];
+	this->reserved_sectors = le16(&a[3]);
+	this->fat_count = a[5];
+	this->sectors_per_fat = le32(&a[25]);
+	this->start_cluster = le32(&a[33]);
+	this->fat_begin_lba = lba_begin + this->reserved_sectors;
+	this->cluster_begin_lba = this->fat_begin_lba + this->sectors_per_fat * this->fat_count;
+	this->cluster_count = (lba_begin + le32(&a[21]) - this->cluster_begin_lba) / this->sectors_per_cluster;
+	this->fsinfo_lba = le16(&a[37]);
+	if (this->fsinfo_lba > 0 && this->fsinfo_lba < 0xffff) {
+		this->fsinfo_lba += lba_begin;
 	} else {
-		// TODO how to deal with unknown filesystem
+		this->fsinfo_lba = 0;
+	}
+
+	// the FSInfo next free cluster is only a hint, and may be unknown
+	this->free_hint = 2;
+	if (this->fsinfo_lba) {
+		this->bd->setBlock(this->fsinfo_lba);
+		this->bd->skip(FSINFO_FREE_COUNT + 4);
+		if (this->bd->read(a, 5) == 4 && le32(a) >= 2 && le32(a) < this->cluster_count + 2) {
+			this->free_hint = le32(a);
+		}
 	}
+	init_chain(this->start_cluster);
 }
 
 File::~File() {
 }
 
-File File::ls( uint8_t (*f)(File*) ) {
-	if (!this->isDirectory()) return NULL;
-
-	uint8_t b[512];
-	reset();
-	while (1) {
-		uint16_t c = read(b,512);
-		while (c > 0) {
-			for (uint16_t i = 0; i < c; i += 32) {
-				uint8_t attrib = b[11];
-				uint32_t cluster = (((uint32_t)b[i+20]) << 24) | (((uint32_t)b[i+21]) << 16) | (((uint16_t)b[i+26]) << 8) | b[i+27];
-				uint32_t size = (((uint32_t)b[i+28]) << 24) | (((uint32_t)b[i+29]) << 16) | (((uint16_t)b[i+30]) << 8) | b[i+31];
-
-				if ((attrib & 0xf) == 0xf) {
-					// long file name; ignore
-				} else if (b[i] == 0xe5) {
-					// unused / deleted file; ignore
-				} else if (b[i] == 0x0) {
-					// end of directory marker; stop
-					return 0;
+// The checksum of the 8.3 name which each of its long file name entries holds
+static uint8_t short_name_checksum(uint8_t* name) {
+	uint8_t sum = 0;
+	for (uint8_t i = 0; i < 11; i++) {
+		sum = ((sum & 1) << 7) + (sum >> 1) + name[i];
+	}
+	return sum;
+}
+
+void File::short_name(uint8_t* e, char* name) {
+	uint8_t n = 0;
+	for (uint8_t i = 0; i < 8 && e[i] != ' '; i++) {
+		name[n++] = (i == 0 && e[i] == 0x05) ? 0xe5 : e[i]; // 0x05 stands for a name which really starts with 0xe5
+	}
+	if (e[8] != ' ') {
+		name[n++] = '.';
+		for (uint8_t i = 8; i < 11 && e[i] != ' '; i++) {
+			name[n++] = e[i];
+		}
+	}
+	name[n] = 0;
+}
+
+static char upper(char c) {
+	return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+uint8_t File::same_name(const char* a, const char* b) {
+	while (*a && upper(*a) == upper(*b)) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+uint8_t File::next_entry(uint8_t* e, char* name, uint32_t* first) {
+	// sequence number of the last long name entry read; they count down to 1, just before the 8.3 entry
+	uint8_t sequence = 0;
+	uint8_t checksum = 0;
+	uint8_t too_long = 0;
+
+	while (read(e, 33) == 32) {
+		if (e[0] == 0x00) {
+			// end of directory marker; stop
+			return 0;
+		} else if (e[0] == 0xe5) {
+			// unused / deleted file
+			sequence = 0;
+		} else if ((e[11] & 0x3f) == 0x0f) {
+			// long file name; the entries come last part first, the first one flagged with 0x40
+			uint8_t n = e[0] & 0x1f;
+			if ((e[0] & 0x40) && n > 0) {
+				*first = this->position - 32;
+				checksum = e[13];
+				too_long = 0;
+				name[(n * 13 < FILE_NAME_LENGTH) ? n * 13 : FILE_NAME_LENGTH] = 0; // in case the name fills the last entry, and has no terminator
+			} else if (sequence == 0 || n != sequence - 1 || e[13] != checksum) {
+				// out of order, or left over from a deleted file; ignore the whole name
+				sequence = 0;
+				continue;
+			}
+			sequence = n;
+			for (uint8_t i = 0; i < 13; i++) {
+				uint16_t c = le16(&e[long_name_offsets[i]]);
+				uint16_t index = (n - 1) * 13 + i;
+				if (index >= FILE_NAME_LENGTH) {
+					too_long |= (c != 0x0000 && c != 0xffff);
+				} else if (c == 0x0000) {
+					name[index] = 0;
+					break;
 				} else {
-					// normal file / directory
-					File file = File(this, &b[i], b[11], cluster, size);
-					uint8_t ret = f(&file);
-					if (ret) {
-						return file;
+					name[index] = (c < 0x80) ? c : '?'; // only ASCII is kept
+				}
+			}
+		} else {
+			// 8.3 entry; use the long name only if it was complete and belongs to this entry
+			if (sequence != 1 || too_long || checksum != short_name_checksum(e)) {
+				*first = this->position - 32;
+				short_name(e, name);
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+File File::entry_file(uint8_t* e, uint32_t first) {
+	uint32_t cluster = (((uint32_t)le16(&e[20])) << 16) | le16(&e[26]);
+	File file = File(this, e, e[11], cluster, le32(&e[28]));
+	file.entry_lba = this->position_lba(this->position - 32, &file.entry_offset);
+	file.long_count = (this->position - 32 - first) / 32;
+	if (file.long_count) {
+		file.long_lba = this->position_lba(first, &file.long_offset);
+	}
+	return file;
+}
+
+File File::invalid() {
+	uint8_t e[11];
+	memset(e, 0, sizeof(e));
+	File none = File(this, e, 0, 0, 0);
+	none.bd = NULL;
+	return none;
+}
+
+File File::open_at(uint32_t first, const char* name) {
+	uint8_t e[33];
+	char entry_name[FILE_NAME_LENGTH + 1];
+	char entry_short_name[13];
+	uint32_t entry_first;
+
+	if (this->isDirectory() && this->seek(first) && next_entry(e, entry_name, &entry_first) && entry_first == first) {
+		short_name(e, entry_short_name);
+		if (same_name(name, entry_name) || same_name(name, entry_short_name)) {
+			return entry_file(e, first);
+		}
+	}
+	return invalid();
+}
+
+File File::ls( uint8_t (*f)(File*) ) {
+	uint8_t e[33];
+	char name[FILE_NAME_LENGTH + 1];
+	uint32_t first;
+
+	if (this->isDirectory()) {
+		reset();
+		while (next_entry(e, name, &first)) {
+			File file = entry_file(e, first);
+			if (f(&file)) {
+				return file;
+			}
+		}
+	}
+	return invalid();
+}
+
+File File::ls( uint8_t (*f)(File*, const char*) ) {
+	uint8_t e[33];
+	char name[FILE_NAME_LENGTH + 1];
+	uint32_t first;
+
+	if (this->isDirectory()) {
+		reset();
+		while (next_entry(e, name, &first)) {
+			File file = entry_file(e, first);
+			if (f(&file, name)) {
+				return file;
+			}
+		}
+	}
+	return invalid();
+}
+
+File File::open(const char* name) {
+	uint8_t e[33];
+	char entry_name[FILE_NAME_LENGTH + 1];
+	char entry_short_name[13];
+	uint32_t first;
+
+	if (this->isDirectory()) {
+		reset();
+		while (next_entry(e, entry_name, &first)) {
+			short_name(e, entry_short_name);
+			if (same_name(name, entry_name) || same_name(name, entry_short_name)) {
+				return entry_file(e, first);
+			}
+		}
+	}
+	return invalid();
+}
+
+File File::create(uint8_t* name, uint8_t attrib) {
+	uint8_t e[33];
+	uint32_t slot = 0xffffffff;
+
+	if (this->isDirectory() && this->bd != NULL) {
+		// look for the name, and remember the first free entry
+		reset();
+		while (read(e, 33) == 32) {
+			if (e[0] == 0x00 || e[0] == 0xe5) {
+				if (slot == 0xffffffff) {
+					slot = this->position - 32;
+				}
+				if (e[0] == 0x00) {
+					break;
+				}
+			} else if ((e[11] & 0x0f) != 0x0f && memcmp(e, name, 11) == 0) {
+				slot = 0xfffffffe;
+				break;
+			}
+		}
+
+		if (slot == 0xffffffff) {
+			// the directory is full; add a cluster of empty entries to it
+			uint32_t cluster = this->append_cluster();
+			if (cluster) {
+				slot = this->mapped_clusters - 1;
+				slot *= this->sectors_per_cluster * BLOCK_DEVICE_BLOCK_SIZE;
+				memset(e, 0, sizeof(e));
+				for (uint8_t i = 0; i < this->sectors_per_cluster; i++) {
+					this->bd->setBlock(this->lba_addr(cluster) + i);
+					for (uint8_t j = 0; j < BLOCK_DEVICE_BLOCK_SIZE / 32; j++) {
+						this->bd->write(e, 32);
+					}
+				}
+			}
+		}
+	}
+
+	if (slot < 0xfffffffe) {
+		memset(e, 0, 32);
+		memcpy(e, name, 11);
+		e[11] = attrib;
+		File file = File(this, e, attrib, 0, 0);
+		file.entry_lba = this->position_lba(slot, &file.entry_offset);
+		this->bd->setBlock(file.entry_lba);
+		this->bd->skip(file.entry_offset);
+		if (this->bd->write(e, 32) == 32) {
+			if (attrib & 0x10) {
+				// a directory starts with a cluster holding the . and .. entries
+				uint32_t cluster = file.append_cluster();
+				if (cluster) {
+					memset(e, 0, sizeof(e));
+					for (uint8_t i = 0; i < this->sectors_per_cluster; i++) {
+						this->bd->setBlock(this->lba_addr(cluster) + i);
+						for (uint8_t j = 0; j < BLOCK_DEVICE_BLOCK_SIZE / 32; j++) {
+							this->bd->write(e, 32);
+						}
 					}
+					uint32_t parent = this->entry_lba ? this->start_cluster : 0; // .. is 0 for the root directory
+					memset(e, ' ', 11);
+					e[0] = '.';
+					e[11] = 0x10;
+					put_le16(&e[20], cluster >> 16);
+					put_le16(&e[26], cluster);
+					this->bd->setBlock(this->lba_addr(cluster));
+					this->bd->write(e, 32);
+					e[1] = '.';
+					put_le16(&e[20], parent >> 16);
+					put_le16(&e[26], parent);
+					this->bd->write(e, 32);
 				}
 			}
+			// the entry (and any cluster added to this directory) must be on the card before the file is used
+			this->flush();
+			file.flush();
+			return file;
+		}
+	}
+
+	return invalid();
+}
+
+uint8_t File::truncate(uint32_t size) {
+	if (this->bd == NULL || this->isDirectory() || size > this->size) {
+		return 0;
+	}
+
+	uint32_t cluster_size = this->sectors_per_cluster * BLOCK_DEVICE_BLOCK_SIZE;
+	uint32_t keep = (size + cluster_size - 1) / cluster_size;
+	if (keep == 0) {
+		// nothing left; free the whole chain
+		this->free_chain(this->start_cluster);
+		this->start_cluster = 0;
+	} else {
+		// end the chain after the last cluster which is still needed
+		uint32_t run;
+		uint32_t last = this->map(keep - 1, &run);
+		uint32_t next = this->walk_chain(last, 1);
+		if (next != FILE_END_OF_CHAIN) {
+			this->set_fat(last, FAT_ENTRY_EOC);
+			this->free_chain(next);
 		}
 	}
+	init_chain(this->start_cluster);
+
+	this->size = size;
+	if (this->position > size) {
+		this->position = size;
+	}
+	this->entry_dirty = 1;
+	return 1;
 }
 
+uint8_t File::remove() {
+	if (this->bd == NULL || this->entry_lba == 0 || this->isDirectory()) {
+		return 0;
+	}
+	this->truncate(0);
+	uint8_t deleted = 0xe5;
+	this->bd->setBlock(this->entry_lba);
+	this->bd->skip(this->entry_offset);
+	this->bd->write(&deleted, 1);
+
+	// the long name entries run up to the directory entry, but may start in an earlier cluster of the
+	// directory, which is not known here; mark those following the first one to the end of its cluster,
+	// then those just before the directory entry in its own cluster
+	uint16_t cluster_entries = this->sectors_per_cluster * (BLOCK_DEVICE_BLOCK_SIZE / 32);
+	uint16_t before = ((this->long_lba - this->cluster_begin_lba) % this->sectors_per_cluster) * (BLOCK_DEVICE_BLOCK_SIZE / 32) + this->long_offset / 32;
+	uint8_t count = this->long_count;
+	if (count > cluster_entries - before) {
+		count = cluster_entries - before;
+	}
+	uint32_t lba = this->long_lba;
+	uint16_t offset = this->long_offset;
+	for (uint8_t i = 0; i < this->long_count; i++) {
+		if (i == count) {
+			// the rest are in the directory entry's cluster
+			uint16_t index = ((this->entry_lba - this->cluster_begin_lba) % this->sectors_per_cluster) * (BLOCK_DEVICE_BLOCK_SIZE / 32) + this->entry_offset / 32;
+			if (index < this->long_count - i) {
+				break; // the name spans more than two clusters; the middle part is left as orphaned entries, which are ignored
+			}
+			index -= this->long_count - i;
+			lba = this->entry_lba - (this->entry_lba - this->cluster_begin_lba) % this->sectors_per_cluster + index / (BLOCK_DEVICE_BLOCK_SIZE / 32);
+			offset = (index % (BLOCK_DEVICE_BLOCK_SIZE / 32)) * 32;
+		}
+		this->bd->setBlock(lba);
+		this->bd->skip(offset);
+		this->bd->write(&deleted, 1);
+		offset += 32;
+		if (offset == BLOCK_DEVICE_BLOCK_SIZE) {
+			offset = 0;
+			lba++;
+		}
+	}
+	this->entry_dirty = 0;
+	uint8_t result = this->flush();
+	this->bd = NULL;
+	return result;
+}
+
+uint8_t File::flush() {
+	if (this->bd == NULL) {
+		return 0;
+	}
+	uint8_t b[9];
+	if (this->entry_dirty && this->entry_lba) {
+		put_le16(&b[0], this->start_cluster >> 16);
+		this->bd->setBlock(this->entry_lba);
+		this->bd->skip(this->entry_offset + 20);
+		this->bd->write(b, 2);
+		put_le16(&b[0], this->start_cluster);
+		put_le32(&b[2], this->size);
+		this->bd->setBlock(this->entry_lba);
+		this->bd->skip(this->entry_offset + 26);
+		this->bd->write(b, 6);
+		this->entry_dirty = 0;
+	}
+	if (this->free_delta != 0 && this->fsinfo_lba) {
+		// free count (if known) and next free cluster
+		this->bd->setBlock(this->fsinfo_lba);
+		this->bd->skip(FSINFO_FREE_COUNT);
+		if (this->bd->read(b, 9) == 8) {
+			uint32_t free = le32(&b[0]);
+			if (free != FSINFO_UNKNOWN) {
+				put_le32(&b[0], free + this->free_delta);
+			}
+			put_le32(&b[4], this->free_hint);
+			this->bd->setBlock(this->fsinfo_lba);
+			this->bd->skip(FSINFO_FREE_COUNT);
+			this->bd->write(b, 8);
+			this->free_delta = 0;
+		}
+	}
+	return this->bd->flush();
+}
 
 void File::filename(uint8_t* name) {
 	for (uint8_t i = 0; i < 11; i++) {
 		name[i] = this->name[i];
 	}
 }
+
+uint8_t File::isValid() {
+	return this->bd != NULL;
+}
+uint8_t File::isReadOnly() {
+	return this->attrib & 0x01;
+}
+uint8_t File::isHidden() {
+	return this->attrib & 0x02;
+}
+uint8_t File::isSystem() {
+	return this->attrib & 0x04;
+}
+uint8_t File::isVolumeId() {
+	return this->attrib & 0x08;
+}
+uint8_t File::isDirectory() {
+	return this->attrib & 0x10;
+}
+
 uint8_t File::reset() {
-	this->current_cluster = this->start_cluster;
-	this->sector = 0;
 	this->position = 0;
 	return 1;
 }
 
+uint8_t File::seek(uint32_t position) {
+	if (!this->isDirectory() && position > this->size) {
+		return 0;
+	}
+	this->position = position;
+	return 1;
+}
+
 uint16_t File::skip(uint16_t len) {
-	if (len > this->size || this->size - len < this->position) {
+	if (!this->isDirectory() && (len > this->size || this->size - len < this->position)) {
 		len = this->size - this->position;
 	}
 	this->position += len;
@@ -113,59 +554,352 @@ uint16_t File::skip(uint16_t len) {
 }
 
 uint8_t File::read(uint8_t* b) {
-	return this->read(b,1);
+	return this->read(b, 2);
 }
 
 uint16_t File::read(uint8_t* a, uint16_t len){
-	if (this->current_cluster == 0xffffffff) {
+	if (this->bd == NULL || len == 0) {
 		return 0;
 	}
-	if (len > this->size || this->size - len < this->position) {
-		len = this->size - this->position;
+	len--;	//Same contract as Stream::read; at most len - 1 bytes
+
+	// directories have no size; they end with their cluster chain
+	uint32_t end = this->isDirectory() ? 0xffffffff : this->size;
+	if (this->position >= end) {
+		return 0;
+	}
+	if (len > end - this->position) {
+		len = end - this->position;
 	}
 
-	while (this->position < this->size) {
-		this->bd->setBlock(this->lba_addr(this->current_cluster) + this->sector);
-		this->bd->skip(this->position % 512);
-		uint16_t read = this->bd->read(a,len);
-		this->position += read;
-		if (read < len) {
-			// reached the end of the sector
-			if (this->sector == this->sectors_per_cluster) {
-				// follow the cluster chain
-				this->current_cluster = this->next_cluster(this->current_cluster);
-				this->sector = 0;
-
-				if (this->current_cluster == 0xffffffff) {
-					// end of the cluster chain
-					return read;
-				}
-			} else {
-				// advance to the next sector in the cluster
-				this->sector++;
+	uint16_t count = 0;
+	uint32_t cluster_size = this->sectors_per_cluster * BLOCK_DEVICE_BLOCK_SIZE;
+	while (count < len) {
+		uint32_t run;
+		uint32_t cluster = this->map(this->position / cluster_size, &run);
+		if (cluster == FILE_END_OF_CHAIN) {
+			break;
+		}
+		uint8_t sector = (this->position % cluster_size) / BLOCK_DEVICE_BLOCK_SIZE;
+		uint32_t lba = this->lba_addr(cluster) + sector;
+		uint16_t offset = this->position % BLOCK_DEVICE_BLOCK_SIZE;
+
+		uint16_t read;
+		if (offset == 0 && len - count >= BLOCK_DEVICE_BLOCK_SIZE) {
+			// whole blocks straight into the caller's buffer, as many as are consecutive on the disk
+			uint32_t blocks = run * this->sectors_per_cluster - sector;
+			if (blocks > (uint16_t) (len - count) / BLOCK_DEVICE_BLOCK_SIZE) blocks = (len - count) / BLOCK_DEVICE_BLOCK_SIZE;
+			if (blocks > FILE_MAX_BLOCK_RUN) blocks = FILE_MAX_BLOCK_RUN;
+			uint8_t* buffers[FILE_MAX_BLOCK_RUN];
+			for (uint8_t i = 0; i < blocks; i++) {
+				buffers[i] = a + count + i * BLOCK_DEVICE_BLOCK_SIZE;
 			}
+			read = this->bd->readBlocks(lba, buffers, blocks) * BLOCK_DEVICE_BLOCK_SIZE;
+		} else {
+			// part of a block
+			uint16_t chunk = BLOCK_DEVICE_BLOCK_SIZE - offset;
+			if (chunk > len - count) chunk = len - count;
+			this->bd->setBlock(lba);
+			this->bd->skip(offset);
+			read = this->bd->read(a + count, chunk + 1);
+		}
+		if (read == 0) {
+			break;
 		}
-		return read;
+		count += read;
+		this->position += read;
 	}
-	return 0;
+	return count;
 }
 
-// TODO for everything is read-only
 uint8_t File::write(uint8_t b) {
-	return 0;
+	return this->write(&b, 1);
+}
+
+uint16_t File::write(uint8_t* a, uint16_t len) {
+	if (this->bd == NULL || this->isDirectory()) {
+		return 0;
+	}
+
+	uint16_t count = 0;
+	uint32_t cluster_size = this->sectors_per_cluster * BLOCK_DEVICE_BLOCK_SIZE;
+	while (count < len) {
+		uint32_t run = 1;
+		uint32_t cluster = this->map(this->position / cluster_size, &run);
+		if (cluster == FILE_END_OF_CHAIN) {
+			// past the end of the chain (which map has now walked to the end); add a cluster
+			cluster = this->append_cluster();
+			if (cluster == 0) {
+				break;
+			}
+		}
+		uint8_t sector = (this->position % cluster_size) / BLOCK_DEVICE_BLOCK_SIZE;
+		uint32_t lba = this->lba_addr(cluster) + sector;
+		uint16_t offset = this->position % BLOCK_DEVICE_BLOCK_SIZE;
+
+		uint16_t written;
+		if (offset == 0 && len - count >= BLOCK_DEVICE_BLOCK_SIZE) {
+			// whole blocks straight from the caller's buffer
+			uint32_t blocks = run * this->sectors_per_cluster - sector;
+			if (blocks > (uint16_t) (len - count) / BLOCK_DEVICE_BLOCK_SIZE) blocks = (len - count) / BLOCK_DEVICE_BLOCK_SIZE;
+			if (blocks > FILE_MAX_BLOCK_RUN) blocks = FILE_MAX_BLOCK_RUN;
+			uint8_t* buffers[FILE_MAX_BLOCK_RUN];
+			for (uint8_t i = 0; i < blocks; i++) {
+				buffers[i] = a + count + i * BLOCK_DEVICE_BLOCK_SIZE;
+			}
+			written = this->bd->writeBlocks(lba, buffers, blocks) * BLOCK_DEVICE_BLOCK_SIZE;
+		} else {
+			// part of a block
+			uint16_t chunk = BLOCK_DEVICE_BLOCK_SIZE - offset;
+			if (chunk > len - count) chunk = len - count;
+			this->bd->setBlock(lba);
+			this->bd->skip(offset);
+			written = this->bd->write(a + count, chunk);
+		}
+		if (written == 0) {
+			break;
+		}
+		count += written;
+		this->position += written;
+		if (this->position > this->size) {
+			this->size = this->position;
+			this->entry_dirty = 1;
+		}
+	}
+	return count;
 }
 
 uint32_t File::lba_addr(uint32_t cluster) {
 	return this->cluster_begin_lba + (cluster - 2) * this->sectors_per_cluster;
 }
 
-uint32_t File::next_cluster(uint32_t cluster) {
-	uint32_t fat_sector = cluster >> 7;  // 128 values per sectors_per_cluster
-	this->bd->setBlock(this->fat_begin_lba + fat_sector);
-	//uint16_t cluster - fat_sector;
-	this->bd->skip((cluster - (fat_sector << 7)) * 4);
+uint32_t File::position_lba(uint32_t position, uint16_t* offset) {
+	uint32_t cluster_size = this->sectors_per_cluster * BLOCK_DEVICE_BLOCK_SIZE;
+	uint32_t run;
+	uint32_t cluster = this->map(position / cluster_size, &run);
+	if (cluster == FILE_END_OF_CHAIN) {
+		return 0;
+	}
+	*offset = position % BLOCK_DEVICE_BLOCK_SIZE;
+	return this->lba_addr(cluster) + (position % cluster_size) / BLOCK_DEVICE_BLOCK_SIZE;
+}
+
+uint8_t File::set_fat(uint32_t cluster, uint32_t value) {
 	uint8_t b[4];
-	this->bd->read(b, 4);
-	uint32_t result = (((uint32_t)b[3]) << 24) | (((uint32_t)b[2]) << 16) | (((uint16_t)b[1]) << 8) | b[0];
-	return (result >= 0xfffffff8) ? 0xffffffff : (result & 0xfffffff);
+	put_le32(b, value);
+	uint8_t result = 1;
+	for (uint8_t i = 0; i < this->fat_count; i++) {
+		this->bd->setBlock(this->fat_begin_lba + i * this->sectors_per_fat + (cluster >> 7));
+		this->bd->skip((cluster & 0x7f) * 4);
+		result &= (this->bd->write(b, 4) == 4);
+	}
+	return result;
+}
+
+uint32_t File::allocate_cluster() {
+	// try to keep the file contiguous, then look from the hint onwards, wrapping around the end of the volume
+	uint32_t cluster = (this->last_cluster >= 2) ? this->last_cluster + 1 : this->free_hint;
+	uint8_t b[FAT_CHUNK * 4 + 1];
+	for (uint32_t checked = 0; checked < this->cluster_count; ) {
+		if (cluster < 2 || cluster >= this->cluster_count + 2) {
+			cluster = 2;
+		}
+		uint8_t n = this->read_fat(cluster, b);
+		if (n == 0) {
+			return 0;
+		}
+		for (uint8_t i = 0; i < n && cluster < this->cluster_count + 2; i++, cluster++, checked++) {
+			if ((le32(&b[i * 4]) & FAT_ENTRY_MASK) == 0) {
+				if (!this->set_fat(cluster, FAT_ENTRY_EOC)) {
+					return 0;
+				}
+				this->free_hint = cluster + 1;
+				this->free_delta--;
+				return cluster;
+			}
+		}
+	}
+	return 0;
+}
+
+uint32_t File::append_cluster() {
+	// make sure that last_cluster really is the end of the chain
+	while (this->extend_chain());
+
+	uint32_t cluster = this->allocate_cluster();
+	if (cluster == 0) {
+		return 0;
+	}
+	if (this->start_cluster == 0) {
+		this->start_cluster = cluster;
+		this->entry_dirty = 1;
+		init_chain(cluster);
+	} else {
+		this->set_fat(this->last_cluster, cluster);
+		this->add_cluster(cluster);
+	}
+	return cluster;
+}
+
+void File::free_chain(uint32_t cluster) {
+	while (cluster >= 2 && cluster != FILE_END_OF_CHAIN) {
+		uint32_t next = this->walk_chain(cluster, 1);
+		this->set_fat(cluster, 0);
+		this->free_delta++;
+		cluster = next;
+	}
+}
+
+void File::init_chain(uint32_t cluster) {
+	this->extent_count = 0;
+	this->mapped_clusters = 0;
+	this->last_cluster = cluster;
+	this->chain_complete = 1;
+	this->last_recorded = 1;
+	this->extent_stride = 1;
+	this->extent_skipped = 0;
+	this->cursor_index = 0;
+	this->cursor_cluster = cluster;
+	if (cluster >= 2) {
+		this->extents[0].offset = 0;
+		this->extents[0].cluster = cluster;
+		this->extents[0].length = 1;
+		this->extent_count = 1;
+		this->mapped_clusters = 1;
+		this->chain_complete = 0;
+	}
+}
+
+uint8_t File::read_fat(uint32_t cluster, uint8_t* b) {
+	uint8_t n = 128 - (cluster & 0x7f);
+	if (n > FAT_CHUNK) n = FAT_CHUNK;
+	this->bd->setBlock(this->fat_begin_lba + (cluster >> 7));
+	this->bd->skip((cluster & 0x7f) * 4);
+	return (this->bd->read(b, n * 4 + 1) == n * 4) ? n : 0;
+}
+
+uint8_t File::extend_chain() {
+	if (this->chain_complete) {
+		return 0;
+	}
+
+	uint8_t b[FAT_CHUNK * 4 + 1];
+	uint32_t cluster = this->last_cluster;
+	uint8_t n = this->read_fat(cluster, b);
+
+	// entry i is for cluster + i, so the chain can be followed through this chunk for as long as it is contiguous
+	for (uint8_t i = 0; i < n; i++) {
+		uint32_t next = le32(&b[i * 4]) & FAT_ENTRY_MASK;
+		if (next < 2 || next >= FAT_ENTRY_BAD) {
+			this->chain_complete = 1;
+			return 0;
+		}
+		this->add_cluster(next);
+		if (next != cluster + 1) {
+			// the next entry is somewhere else in the FAT
+			return 1;
+		}
+		cluster = next;
+	}
+	if (n == 0) {
+		// read error
+		this->chain_complete = 1;
+		return 0;
+	}
+	return 1;
+}
+
+void File::add_cluster(uint32_t next) {
+	uint8_t contiguous = (next == this->last_cluster + 1);
+	this->mapped_clusters++;
+	this->last_cluster = next;
+	if (contiguous) {
+		if (this->last_recorded) {
+			this->extents[this->extent_count - 1].length++;
+		}
+		return;
+	}
+
+	// a new fragment
+	this->last_recorded = 0;
+	if (++this->extent_skipped >= this->extent_stride) {
+		if (this->extent_count == FILE_MAX_EXTENTS) {
+			// full; keep every other extent, and only add every other fragment from now on
+			for (uint8_t j = 1; j < FILE_MAX_EXTENTS / 2; j++) {
+				this->extents[j] = this->extents[j * 2];
+			}
+			this->extent_count = FILE_MAX_EXTENTS / 2;
+			this->extent_stride <<= 1;
+		}
+		FileExtent* e = &this->extents[this->extent_count++];
+		e->offset = this->mapped_clusters - 1;
+		e->cluster = next;
+		e->length = 1;
+		this->extent_skipped = 0;
+		this->last_recorded = 1;
+	}
+}
+
+uint32_t File::walk_chain(uint32_t cluster, uint32_t hops) {
+	uint8_t b[FAT_CHUNK * 4 + 1];
+	while (hops > 0) {
+		uint8_t n = this->read_fat(cluster, b);
+		if (n == 0) {
+			return FILE_END_OF_CHAIN;
+		}
+		for (uint8_t i = 0; i < n && hops > 0; i++) {
+			uint32_t next = le32(&b[i * 4]) & FAT_ENTRY_MASK;
+			if (next < 2 || next >= FAT_ENTRY_BAD) {
+				return FILE_END_OF_CHAIN;
+			}
+			hops--;
+			if (next != cluster + 1) {
+				// the next entry is somewhere else in the FAT
+				cluster = next;
+				break;
+			}
+			cluster = next;
+		}
+	}
+	return cluster;
+}
+
+uint32_t File::map(uint32_t index, uint32_t* run) {
+	while (index >= this->mapped_clusters && this->extend_chain());
+	if (index >= this->mapped_clusters) {
+		return FILE_END_OF_CHAIN;
+	}
+
+	// last extent starting at or before index
+	uint8_t low = 0;
+	uint8_t high = this->extent_count - 1;
+	while (low < high) {
+		uint8_t mid = (low + high + 1) >> 1;
+		if (this->extents[mid].offset <= index) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	FileExtent* e = &this->extents[low];
+	if (index < e->offset + e->length) {
+		*run = e->offset + e->length - index;
+		return e->cluster + (index - e->offset);
+	}
+
+	// in a fragment which is not in the list; follow the FAT from the end of the extent before it, or from
+	// the cursor if that is closer, so that reading forwards through such fragments only walks each hop once
+	uint32_t from = e->offset + e->length - 1;
+	uint32_t cluster = e->cluster + e->length - 1;
+	if (this->cursor_index > from && this->cursor_index <= index) {
+		from = this->cursor_index;
+		cluster = this->cursor_cluster;
+	}
+	cluster = this->walk_chain(cluster, index - from);
+	if (cluster != FILE_END_OF_CHAIN) {
+		this->cursor_index = index;
+		this->cursor_cluster = cluster;
+	}
+	*run = 1;
+	return cluster;
 }
@@ -5,8 +5,42 @@
 #include <BlockDevice.h>
 #include <Stream.h>
 
+/*
+ * Number of extents (runs of consecutive clusters) remembered per file.  A file with more
+ * fragments than this still works: when the list fills up, every other extent is dropped and
+ * from then on only every other fragment is remembered (then every fourth, and so on), so the
+ * remembered extents stay spread evenly over the file.  Positions in fragments which are not
+ * remembered are found by following the FAT from the nearest remembered extent before them.
+ */
+#ifndef FILE_MAX_EXTENTS
+#define FILE_MAX_EXTENTS		8
+#endif
+
+/* Most blocks transferred by a single readBlocks() call from File::read */
+#ifndef FILE_MAX_BLOCK_RUN
+#define FILE_MAX_BLOCK_RUN		8
+#endif
+
+#define FILE_END_OF_CHAIN		0xffffffff
+
+/*
+ * Longest long file name (in characters) which ls() and open() put together from the VFAT long
+ * name entries.  Files with longer names are still listed, under their 8.3 name.
+ */
+#ifndef FILE_NAME_LENGTH
+#define FILE_NAME_LENGTH		64
+#endif
+
 namespace digitalcave {
+	/* A run of consecutive clusters: file cluster offset .. offset + length - 1 are disk clusters cluster .. cluster + length - 1 */
+	struct FileExtent {
+		uint32_t offset;
+		uint32_t cluster;
+		uint32_t length;
+	};
+
 	class File : Stream {
+		friend class FileIndex;
 
 		private:
 			File(File* parent, uint8_t* name, uint8_t attrib, uint32_t cluster, uint32_t size);
@@ -17,6 +51,20 @@ namespace digitalcave {
 			uint32_t fat_begin_lba;
 			uint32_t reserved_sectors;
 			uint32_t cluster_begin_lba;
+			uint32_t sectors_per_fat;
+			uint8_t fat_count;
+			uint32_t cluster_count;   // data clusters; valid cluster numbers are 2 .. cluster_count + 1
+			uint32_t fsinfo_lba;      // 0 if there is no FSInfo block
+			uint32_t free_hint;       // where to start looking for a free cluster
+			int32_t free_delta;       // clusters allocated (-) / freed (+) since FSInfo was last updated
+
+			// directory entry for this file; entry_lba is 0 for the root directory, which has none
+			uint32_t entry_lba;
+			uint16_t entry_offset;
+			uint8_t entry_dirty;      // first cluster or size have changed since the entry was written
+			uint32_t long_lba;        // first of the long file name entries before the directory entry, if any
+			uint16_t long_offset;
+			uint8_t long_count;
 
 			// file
 			uint8_t name[11];
@@ -24,34 +72,148 @@ namespace digitalcave {
 			uint32_t start_cluster;
 			uint32_t size;
 
+			// cluster chain, mapped lazily as the file is read or seeked
+			FileExtent extents[FILE_MAX_EXTENTS];
+			uint8_t extent_count;
+			uint32_t mapped_clusters; // number of clusters from the start of the file which have been walked
+			uint32_t last_cluster;    // disk cluster of file cluster mapped_clusters - 1
+			uint8_t chain_complete;   // the end of the chain has been found
+			uint8_t last_recorded;    // last_cluster is part of the last extent in the list
+			uint16_t extent_stride;   // only every extent_stride'th fragment is added to the list
+			uint16_t extent_skipped;  // fragments since the last one added to the list
+			uint32_t cursor_index;    // last position found by following the FAT through fragments not in the list
+			uint32_t cursor_cluster;
+
 			// stream
-			uint32_t current_cluster;
-			uint8_t sector;    // current sector in the cluster
 			uint32_t position; // current position in the entire file
 
+			/*
+			 * Reads this directory from the current position up to and including the next 8.3 entry (skipping
+			 * deleted ones) into e, and its name into name: the long file name if the entries before it hold a
+			 * valid one, else the 8.3 name as NAME.EXT.  first is set to the position of the first entry (long
+			 * name or 8.3) belonging to the file.  Returns 0 at the end of the directory.
+			 */
+			uint8_t next_entry(uint8_t* e, char* name, uint32_t* first);
+			/* Returns the File for the entry e just read by next_entry */
+			File entry_file(uint8_t* e, uint32_t first);
+			/* Returns the entry whose first directory entry is at position first, if it has the given name; else an invalid File */
+			File open_at(uint32_t first, const char* name);
+			/* Returns a File which is not valid */
+			File invalid();
+			/* Writes the 8.3 name of entry e as NAME.EXT, without padding; name must hold 13 characters */
+			static void short_name(uint8_t* e, char* name);
+			/* Compares two names, ignoring case */
+			static uint8_t same_name(const char* a, const char* b);
+
 			/* Uses the Volume ID to determine the block address of a cluster */
 			uint32_t lba_addr(uint32_t cluster);
-			/* Uses the FAT to determine the next cluster, or 0xffffffff at the end of the chain */
-			uint32_t next_cluster(uint32_t cluster);
+			/* Returns the block address of the given position in this file, and the offset within that block; 0 past the end of the chain */
+			uint32_t position_lba(uint32_t position, uint16_t* offset);
+
+			/* Writes value into the FAT entry for cluster, in every copy of the FAT */
+			uint8_t set_fat(uint32_t cluster, uint32_t value);
+			/* Finds a free cluster, starting at the free cluster hint, and marks it as the end of a chain; 0 if the volume is full */
+			uint32_t allocate_cluster();
+			/* Adds a newly allocated cluster to the end of this file's chain; returns the cluster, or 0 if the volume is full */
+			uint32_t append_cluster();
+			/* Marks every cluster in the chain starting at cluster as free */
+			void free_chain(uint32_t cluster);
+			/* Adds next to the extent list as the cluster following last_cluster */
+			void add_cluster(uint32_t next);
+
+			/* Starts the extent list for a chain beginning at cluster (0 for an empty file) */
+			void init_chain(uint32_t cluster);
+			/* Reads the FAT entries for cluster onwards, up to FAT_CHUNK of them in the same FAT block; returns how many */
+			uint8_t read_fat(uint32_t cluster, uint8_t* b);
+			/* Walks the chain further, up to one FAT chunk at a time; returns 0 once the end of the chain has been reached */
+			uint8_t extend_chain();
+			/* Follows the chain hops clusters on from cluster; returns FILE_END_OF_CHAIN if it ends first */
+			uint32_t walk_chain(uint32_t cluster, uint32_t hops);
+			/*
+			 * Returns the disk cluster holding file cluster index, or FILE_END_OF_CHAIN past the end of the
+			 * chain.  run is set to the number of consecutive disk clusters starting there which are known
+			 * to belong to the file (at least 1).
+			 */
+			uint32_t map(uint32_t index, uint32_t* run);
 
 		public:
 			File(BlockDevice* bd);
 			~File();
 
 			void filename(uint8_t *b);
+			uint8_t isValid();
 			uint8_t isReadOnly();
 			uint8_t isSystem();
 			uint8_t isVolumeId();
 			uint8_t isHidden();
 			uint8_t isDirectory();
 
+			uint32_t getSize() { return size; }
+			uint32_t getPosition() { return position; }
+
+			/*
+			 * Calls f for each entry in this directory, until f returns non zero; that entry is returned.
+			 * If no entry is chosen (or this is not a directory), the returned File is not valid.
+			 */
 			File ls( uint8_t (*f)(File*) );
 
+			/*
+			 * As above, but f is also given the name of the entry: its long file name if it has one, else
+			 * the 8.3 name as NAME.EXT (without the padding).
+			 */
+			File ls( uint8_t (*f)(File*, const char*) );
+
+			/*
+			 * Returns the entry in this directory with the given name, which may be either its long file
+			 * name or its 8.3 name as NAME.EXT; upper and lower case are the same.  The returned File is not
+			 * valid if there is no such entry.  This reads the directory up to the entry each time; to open
+			 * files in a large directory over and over, use a FileIndex.
+			 */
+			File open(const char* name);
+
+			/*
+			 * Creates an empty file (or, with attrib 0x10, an empty directory) in this directory.  The name is
+			 * given in the same 11 byte, space padded 8.3 form as filename().  Returns an invalid File if this is
+			 * not a directory, the name is already in use, or the volume is full.
+			 */
+			File create(uint8_t* name, uint8_t attrib = 0x20);
+
+			/*
+			 * Shortens the file to the given size, freeing any clusters which are no longer needed.  Returns 1
+			 * if successful, or 0 if the size is larger than the file.
+			 */
+			uint8_t truncate(uint32_t size);
+
+			/*
+			 * Deletes the file (and its long file name entries), freeing all of its clusters.  The File is
+			 * no longer valid afterwards.
+			 */
+			uint8_t remove();
+
+			/*
+			 * Writes the directory entry (first cluster and size) and the FSInfo free cluster count, then flushes
+			 * the block device.  Call this after writing, before the card is removed or the power goes away.
+			 */
+			uint8_t flush();
+
+			/*
+			 * Moves to the given position in the file.  Returns 1 if successful, or 0 if the position is
+			 * past the end of the file (in which case the position is not changed).
+			 */
+			uint8_t seek(uint32_t position);
+
 			uint8_t reset();
 			uint16_t skip(uint16_t n);
 			uint8_t read(uint8_t *b);
 			uint16_t read(uint8_t* a, uint16_t len);
+			/*
+			 * Writes at the current position, overwriting what is there and growing the file (allocating clusters as
+			 * needed) when writing past the end.  Whole, block aligned blocks are written with writeBlocks(); anything
+			 * smaller is written through the block device's stream functions, so for small writes put a BlockCache in
+			 * between, which turns a run of small appends into whole block writes.
+			 */
 			uint8_t write(uint8_t b);
+			uint16_t write(uint8_t* a, uint16_t len);
 
 			using Stream::read;
 			using Stream::write;
@@ -0,0 +1,89 @@
+#include "FileIndex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace digitalcave;
+
+// Entry numbers are kept in 16 bits, and a quarter of the slots must stay empty
+#define FILE_INDEX_MAX_CAPACITY		49151
+
+FileIndex::FileIndex(File* directory, uint16_t capacity) :
+	directory(directory),
+	count(0)
+{
+	if (capacity > FILE_INDEX_MAX_CAPACITY) capacity = FILE_INDEX_MAX_CAPACITY;
+	this->capacity = capacity;
+	uint32_t slots = 1;
+	while (slots < (uint32_t) capacity + capacity / 3 + 1) slots <<= 1;
+	this->slot_mask = slots - 1;
+	this->slots = (FileIndexSlot*) calloc(slots, sizeof(FileIndexSlot));
+}
+
+FileIndex::~FileIndex(){
+	free(slots);
+}
+
+uint32_t FileIndex::hash(const char* name){
+	uint32_t h = 2166136261UL;
+	for (; *name; name++){
+		char c = *name;
+		if (c >= 'a' && c <= 'z') c = c - 'a' + 'A';
+		h = (h ^ (uint8_t) c) * 16777619UL;
+	}
+	return h;
+}
+
+uint8_t FileIndex::add(const char* name, uint32_t first){
+	uint32_t entry = first / 32 + 1;
+	if (slots == NULL || entry > 0xffff) return 0;
+	uint32_t h = hash(name);
+	uint16_t i = h & slot_mask;
+	while (slots[i].entry){
+		if (slots[i].hash == h && slots[i].entry == entry) return 1;	//Already there
+		i = (i + 1) & slot_mask;
+	}
+	if (count >= capacity) return 0;
+	slots[i].hash = h;
+	slots[i].entry = entry;
+	count++;
+	return 1;
+}
+
+uint8_t FileIndex::build(){
+	uint8_t e[33];
+	char name[FILE_NAME_LENGTH + 1];
+	char short_name[13];
+	uint32_t first;
+	uint8_t complete = (slots != NULL);
+
+	count = 0;
+	if (slots) memset(slots, 0, sizeof(FileIndexSlot) * ((uint32_t) slot_mask + 1));
+	if (!directory->isDirectory()) return 0;
+
+	directory->reset();
+	while (directory->next_entry(e, name, &first)){
+		complete &= add(name, first);
+		File::short_name(e, short_name);
+		if (!File::same_name(name, short_name)) complete &= add(short_name, first);
+	}
+	return complete;
+}
+
+File FileIndex::open(const char* name){
+	if (slots){
+		uint32_t h = hash(name);
+		for (uint16_t i = h & slot_mask; slots[i].entry; i = (i + 1) & slot_mask){
+			if (slots[i].hash != h) continue;
+			File file = directory->open_at((uint32_t) (slots[i].entry - 1) * 32, name);
+			if (file.isValid()) return file;
+		}
+	}
+
+	//Not indexed (or no longer where the index says); read the directory, and remember where it was
+	File file = directory->open(name);
+	if (file.isValid()){
+		add(name, directory->position - 32 * (file.long_count + 1));
+	}
+	return file;
+}
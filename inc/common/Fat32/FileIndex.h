@@ -0,0 +1,69 @@
+/*
+ * In RAM hash index of the names in one directory, so that opening a file by name takes a
+ * block or two of reading instead of a scan of the directory up to the file.  Build it once
+ * after mounting (it reads the whole directory), then open files through it as often as
+ * needed.
+ *
+ * Each file is listed under its long file name and its 8.3 name (NAME.EXT), and each name costs
+ * one FileIndexSlot of RAM.  The index only remembers where in the directory each entry is; the
+ * entry itself is read (and its name compared) on every open, so a stale index never returns
+ * the wrong file.  Names which are not in the index (files created since build(), or files
+ * which did not fit) are looked up by reading the directory, the same as File::open, and added
+ * to the index if there is room.
+ *
+ * Usage:
+ *		File root(&sd);
+ *		FileIndex index(&root, 512);
+ *		index.build();
+ *		...
+ *		File sample = index.open("Kick 01.wav");
+ */
+
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include "File.h"
+
+namespace digitalcave {
+	struct FileIndexSlot {
+		uint32_t hash;
+		uint16_t entry;		// Position of the file's first directory entry / 32, plus 1; 0 if the slot is empty
+	};
+
+	class FileIndex {
+
+		private:
+			File* directory;
+			FileIndexSlot* slots;
+			uint16_t slot_mask;		// Number of slots - 1; a power of 2, with at least a quarter of the slots left empty
+			uint16_t capacity;
+			uint16_t count;
+
+			/* Case insensitive FNV-1a hash of a name */
+			static uint32_t hash(const char* name);
+			/* Adds a name for the entry at directory position first; returns 0 if the index is full */
+			uint8_t add(const char* name, uint32_t first);
+
+		public:
+			/*
+			 * Creates an empty index of up to capacity names in the given directory.  directory must stay
+			 * valid while the index is in use.
+			 */
+			FileIndex(File* directory, uint16_t capacity);
+			~FileIndex();
+
+			/*
+			 * Reads the directory and indexes every name in it.  Returns 1 if all of them fit.
+			 */
+			uint8_t build();
+
+			/*
+			 * Returns the entry with the given name (long or 8.3, any case), as File::open does.
+			 */
+			File open(const char* name);
+
+			uint16_t getCount() { return count; }
+	};
+}
+
+#endif
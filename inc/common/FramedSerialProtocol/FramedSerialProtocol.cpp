@@ -1,16 +1,24 @@
 #include "FramedSerialProtocol.h"
 
+#include <string.h>
+#include <dcutil/crc16.h>
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
 using namespace digitalcave;
 
 FramedSerialMessage::FramedSerialMessage(uint8_t command, uint8_t maxSize){
 	this->data = (uint8_t*) malloc(maxSize);
 	this->command = command;
 	this->maxSize = maxSize;
+	this->allocated = 1;
 	length = 0;
 }
 
 FramedSerialMessage::~FramedSerialMessage(){
-	free((void*) data);
+	if (allocated) free((void*) data);
 }
 
 FramedSerialMessage::FramedSerialMessage(uint8_t command, uint8_t* data, uint8_t length){
@@ -18,17 +26,27 @@ FramedSerialMessage::FramedSerialMessage(uint8_t command, uint8_t* data, uint8_t
 	this->command = command;
 	this->length = length;
 	this->maxSize = length;
-	for(uint8_t i = 0; i < length; i++){
-		this->data[i] = data[i];
-	}
+	this->allocated = 1;
+	memcpy(this->data, data, length);
+}
+
+FramedSerialMessage::FramedSerialMessage(uint8_t command, uint8_t* buffer, uint8_t maxSize, uint8_t length){
+	this->data = buffer;
+	this->command = command;
+	this->length = length;
+	this->maxSize = maxSize;
+	this->allocated = 0;
 }
 
 void FramedSerialMessage::clone(FramedSerialMessage* m){
-	command = m->command;
-	for(uint8_t i = 0; i < maxSize; i++){
-		data[i] = m->data[i];
-	}
-	length = m->length;
+	set(m->command, m->data, m->length);
+}
+
+void FramedSerialMessage::set(uint8_t command, uint8_t* data, uint8_t length){
+	if (length > maxSize) length = maxSize;
+	this->command = command;
+	if (data != this->data) memcpy(this->data, data, length);
+	this->length = length;
 }
 
 uint8_t FramedSerialMessage::getCommand(){
@@ -39,6 +57,10 @@ uint8_t FramedSerialMessage::getLength(){
 	return length;
 }
 
+uint8_t FramedSerialMessage::getMaxSize(){
+	return maxSize;
+}
+
 uint8_t* FramedSerialMessage::getData(){
 	return data;
 }
@@ -47,147 +69,266 @@ void FramedSerialMessage::append(uint8_t b){
 	data[length++] = b;
 }
 
+FramedSerialMessagePool::FramedSerialMessagePool(FramedSerialMessage** messages, uint8_t count){
+	this->messages = messages;
+	this->count = (count > 8) ? 8 : count;
+	this->used = 0;
+}
+
+FramedSerialMessage* FramedSerialMessagePool::acquire(){
+	for (uint8_t i = 0; i < count; i++){
+		if (!(used & _BV(i))){
+			used |= _BV(i);
+			return messages[i];
+		}
+	}
+	return NULL;
+}
+
+void FramedSerialMessagePool::release(FramedSerialMessage* message){
+	for (uint8_t i = 0; i < count; i++){
+		if (messages[i] == message){
+			used &= ~_BV(i);
+			return;
+		}
+	}
+}
+
+uint8_t FramedSerialMessagePool::available(){
+	uint8_t result = 0;
+	for (uint8_t i = 0; i < count; i++){
+		if (!(used & _BV(i))) result++;
+	}
+	return result;
+}
+
 FramedSerialProtocol::FramedSerialProtocol(uint8_t maxSize){
-	data = (uint8_t*) malloc(maxSize);
+	buffer = (uint8_t*) malloc(maxSize);
+	bufferSize = maxSize;
+	allocated = 1;
+	data = buffer;
 	this->maxSize = maxSize;
+	target = NULL;
 	position = 0;
 	length = 0;
 	command = 0;
 	checksum = 0;
+	checksumType = FSP_CHECKSUM_ADDITIVE;
+	escape = 0;
+	error = 0;
+}
+
+FramedSerialProtocol::FramedSerialProtocol(uint8_t* buffer, uint8_t maxSize){
+	this->buffer = buffer;
+	bufferSize = maxSize;
+	allocated = 0;
+	data = buffer;
+	this->maxSize = maxSize;
+	target = NULL;
+	position = 0;
+	length = 0;
+	command = 0;
+	checksum = 0;
+	checksumType = FSP_CHECKSUM_ADDITIVE;
 	escape = 0;
 	error = 0;
 }
 
 FramedSerialProtocol::~FramedSerialProtocol(){
-	free(data);
+	if (allocated) free(buffer);
 }
 
 uint8_t FramedSerialProtocol::getError(){
 	return error;
 }
 
-void FramedSerialProtocol::escapeByte(Stream* stream, uint8_t b){
+void FramedSerialProtocol::setChecksumType(uint8_t type){
+	checksumType = type;
+}
+
+uint8_t FramedSerialProtocol::getChecksumType(){
+	return checksumType;
+}
+
+uint8_t FramedSerialProtocol::escapeByte(Stream* stream, uint8_t* buffer, uint8_t n, uint8_t b){
+	if (n > FSP_WRITE_BUFFER_SIZE - 2){
+		stream->write(buffer, n);
+		n = 0;
+	}
 	if (b == START || b == ESCAPE) {
-		stream->write(ESCAPE);
-		stream->write(b ^ 0x20);
+		buffer[n++] = ESCAPE;
+		buffer[n++] = b ^ 0x20;
 	} else {
-		stream->write(b);
+		buffer[n++] = b;
 	}
+	return n;
 }
 
-uint8_t FramedSerialProtocol::read(Stream* stream, FramedSerialMessage* result){
-	uint8_t b;
-	while (stream->read(&b)){
-		if (position == 0 && b != START){
-			//Garbage data, ignore
-			continue;
-		}
-		
-		if (error > 0){
-			if (b == START) {
-				// recover from any previous error condition
-				error = NO_ERROR;
-				position = 0;
-			}
-			else {
-				continue;
-			}
-		}
+uint8_t FramedSerialProtocol::decode(uint8_t b, FramedSerialMessagePool* pool){
+	if (position == 0 && b != START){
+		//Garbage data, ignore
+		return 0;
+	}
 	
-		if (position > 0 && b == START) {
-			// unexpected start of frame
-			error = INCOMING_ERROR_UNEXPECTED_START_OF_FRAME;
-			continue;
-		}
-		if (position > 0 && b == ESCAPE) {
-			// unescape next byte
-			escape = 1;
-			continue;
-		}
-		if (escape) {
-			// unescape current byte
-			b = 0x20 ^ b;
+	if (error > 0){
+		if (b == START) {
+			// recover from any previous error condition
+			error = NO_ERROR;
+			position = 0;
 			escape = 0;
 		}
-		if (position > 1) { // start byte and length byte not included in checksum
-			checksum += b;
+		else {
+			return 0;
 		}
-	
-		switch(position) {
-			case 0: // start frame
-				position++;
-				break;
-			case 1: // length
-				if (b == 0){
-					error = INCOMING_ERROR_INVALID_LENGTH;
-				}
-				else {
-					length = b;
-					position++;
-				}
-				break;
-			case 2:
-				command = b;
-				position++;
-				break;
-			default:
-				if ((position - 3) > maxSize){
-					//Max size exceeded
-					error = INCOMING_ERROR_EXCEED_MAX_LENGTH;
-				}
-				else if (position == (length + 2)) {
-					if (checksum == 0xff) {
-						FramedSerialMessage m(command, data, length - 1);
-						result->clone(&m);
-						position = 0;
-						checksum = 0;
-						return 1;
-					} else {
-						error = INCOMING_ERROR_INVALID_CHECKSUM;
+	}
+
+	if (position > 0 && b == START) {
+		// unexpected start of frame
+		error = INCOMING_ERROR_UNEXPECTED_START_OF_FRAME;
+		return 0;
+	}
+	if (position > 0 && b == ESCAPE) {
+		// unescape next byte
+		escape = 1;
+		return 0;
+	}
+	if (escape) {
+		// unescape current byte
+		b = 0x20 ^ b;
+		escape = 0;
+	}
+	if (position > 1) { // start byte and length byte not included in checksum
+		if (checksumType == FSP_CHECKSUM_CRC16) checksum = crc16_update(checksum, b);
+		else checksum += b;
+	}
+
+	switch(position) {
+		case 0: // start frame
+			checksum = (checksumType == FSP_CHECKSUM_CRC16) ? CRC16_INIT : 0;
+			if (pool != NULL){
+				// decode straight into a pooled message; keep any message left over from a failed frame
+				if (target == NULL){
+					target = pool->acquire();
+					if (target == NULL){
+						error = INCOMING_ERROR_POOL_EMPTY;
+						return 0;
 					}
-					position = 0;
-					checksum = 0;
 				}
-				else {
-					data[position - 3] = b;
-					position++;
+				data = target->getData();
+				maxSize = target->getMaxSize();
+			}
+			position++;
+			break;
+		case 1: // length
+			if (b == 0){
+				error = INCOMING_ERROR_INVALID_LENGTH;
+			}
+			else {
+				length = b;
+				position++;
+			}
+			break;
+		case 2:
+			command = b;
+			position++;
+			break;
+		default:
+			if (position == (length + 2) && checksumType == FSP_CHECKSUM_CRC16) {
+				// first (high) CRC byte; the CRC over the data plus both CRC bytes is 0 for a good frame
+				position++;
+			}
+			else if (position >= (length + 2)) {
+				position = 0;
+				if (checksumType == FSP_CHECKSUM_CRC16 ? checksum == 0 : (uint8_t) checksum == 0xff) {
+					return 1;
+				} else {
+					error = INCOMING_ERROR_INVALID_CHECKSUM;
 				}
-				break;
+			}
+			else if ((position - 3) >= maxSize){
+				//Max size exceeded
+				error = INCOMING_ERROR_EXCEED_MAX_LENGTH;
+			}
+			else {
+				data[position - 3] = b;
+				position++;
+			}
+			break;
+	}
+	return 0;
+}
+
+uint8_t FramedSerialProtocol::read(Stream* stream, FramedSerialMessage* result){
+	uint8_t b;
+	while (stream->read(&b)){
+		if (decode(b, NULL)){
+			result->set(command, data, length - 1);
+			return 1;
 		}
 	}
 	
 	return 0;
 }
 
-void FramedSerialProtocol::write(Stream* stream, FramedSerialMessage* message){
-	uint8_t length = message->getLength();
-	uint8_t command = message->getCommand();
-	uint8_t* data = message->getData();
-	
-	uint8_t checksum  = 0;
-	for(uint8_t position = 0; position <= (length + 3); position++){
-		switch(position){
-			case 0:
-				stream->write(START);
-				break;
-			case 1:
-				escapeByte(stream, length + 1);
-				break;
-			case 2:
-				escapeByte(stream, command);
-				checksum = command;
-				break;
-			default:
-				if (position - 3 == length){
-					escapeByte(stream, 0xff - checksum);
-				}
-				else {
-					uint8_t b = data[position - 3];
-					escapeByte(stream, b);
-					checksum += b;
-				}
-				break;
+FramedSerialMessage* FramedSerialProtocol::read(Stream* stream, FramedSerialMessagePool* pool){
+	uint8_t b;
+	while (stream->read(&b)){
+		if (decode(b, pool)){
+			FramedSerialMessage* result = target;
+			result->set(command, result->getData(), length - 1);	// data is already in place; nothing is copied
+			target = NULL;
+			return result;
 		}
 	}
+
+	return NULL;
 }
 
+void FramedSerialProtocol::write(Stream* stream, FramedSerialMessage* message){
+	write(stream, message->getCommand(), message->getData(), message->getLength());
+}
+
+void FramedSerialProtocol::write(Stream* stream, uint8_t command, uint8_t* data, uint8_t length){
+	FramedSerialSpan span = { data, length };
+	write(stream, command, &span, 1);
+}
+
+void FramedSerialProtocol::write(Stream* stream, uint8_t command, FramedSerialSpan* spans, uint8_t count){
+	uint8_t buffer[FSP_WRITE_BUFFER_SIZE];
+	uint8_t n = 0;
+
+	uint8_t length = 1;		// command byte
+	for (uint8_t i = 0; i < count; i++){
+		length += spans[i].length;
+	}
+
+	buffer[n++] = START;
+	n = escapeByte(stream, buffer, n, length);
+	n = escapeByte(stream, buffer, n, command);
+
+	if (checksumType == FSP_CHECKSUM_CRC16){
+		uint16_t crc = crc16_update(CRC16_INIT, command);
+		for (uint8_t i = 0; i < count; i++){
+			uint8_t* data = spans[i].data;
+			for (uint8_t j = 0; j < spans[i].length; j++){
+				crc = crc16_update(crc, data[j]);
+				n = escapeByte(stream, buffer, n, data[j]);
+			}
+		}
+		n = escapeByte(stream, buffer, n, crc >> 8);
+		n = escapeByte(stream, buffer, n, crc & 0xff);
+	}
+	else {
+		uint8_t checksum = command;
+		for (uint8_t i = 0; i < count; i++){
+			uint8_t* data = spans[i].data;
+			for (uint8_t j = 0; j < spans[i].length; j++){
+				checksum += data[j];
+				n = escapeByte(stream, buffer, n, data[j]);
+			}
+		}
+		n = escapeByte(stream, buffer, n, 0xff - checksum);
+	}
+
+	stream->write(buffer, n);
+}
@@ -12,11 +12,26 @@
 #define INCOMING_ERROR_INVALID_LENGTH				3
 #define INCOMING_ERROR_EXCEED_MAX_LENGTH			4
 #define OUTGOING_ERROR_QUEUE_FULL					5
+#define INCOMING_ERROR_POOL_EMPTY					6
 
 //Special bytes
 #define START 0x7e
 #define ESCAPE 0x7d
 
+//Frame integrity check types
+#define FSP_CHECKSUM_ADDITIVE						0	// 8-bit additive checksum (default)
+#define FSP_CHECKSUM_CRC16							1	// CRC-16/CCITT, sent high byte first
+
+//Size of the stack buffer which outgoing frames are escaped into before being handed to the stream.  Frames
+// (after escaping) which fit are sent with a single bulk write; longer ones are sent a buffer at a time.
+#ifndef FSP_WRITE_BUFFER_SIZE
+#define FSP_WRITE_BUFFER_SIZE 64
+#endif
+
+//Most bytes on the wire for a frame with a payload of the given length: the start byte, then the length, command,
+// payload and (up to two) checksum bytes, each of which may be escaped.
+#define FSP_MAX_FRAME_SIZE(length)	(1 + 2 * ((length) + 4))
+
 namespace digitalcave {
 
 	class FramedSerialMessage {
@@ -30,6 +45,7 @@ namespace digitalcave {
 			
 			//Metadata
 			uint8_t maxSize;	//Cannot be larger than length
+			uint8_t allocated;	//Set if data was malloc'd by this object and must be freed
 
 		public:
 			//Construct a new message for writing
@@ -37,48 +53,131 @@ namespace digitalcave {
 		
 			//Encapsulate an existing message for reading
 			FramedSerialMessage(uint8_t command, uint8_t* message, uint8_t length);
+
+			//Wrap a caller owned buffer of maxSize bytes, the first length of which are already valid.  Nothing is
+			// allocated or copied, and the buffer is not freed when the message is destroyed.
+			FramedSerialMessage(uint8_t command, uint8_t* buffer, uint8_t maxSize, uint8_t length);
 			
 			~FramedSerialMessage();
 			
 			//Copies all of the attributes from message m to this object
 			void clone(FramedSerialMessage* m);
+
+			//Replaces the contents of this message; at most maxSize bytes of data are copied
+			void set(uint8_t command, uint8_t* data, uint8_t length);
 		
 			uint8_t getCommand();
 			uint8_t getLength();
+			uint8_t getMaxSize();
 			uint8_t* getData();
 		
 			//Construct the message one byte at a time
 			void append(uint8_t b);
 	};
 
+	/*
+	 * One piece of an outgoing payload, for gathering a frame from several buffers (e.g. a header
+	 * struct and a data array) without copying them together first.
+	 */
+	struct FramedSerialSpan {
+		uint8_t* data;
+		uint8_t length;
+	};
+
+	/*
+	 * A fixed set of caller owned messages which the protocol can decode into directly, so that
+	 * completed frames are neither allocated nor copied.  At most 8 messages can be pooled.
+	 *
+	 *		FramedSerialMessage a(0, 32), b(0, 32);
+	 *		FramedSerialMessage* messages[] = {&a, &b};
+	 *		FramedSerialMessagePool pool(messages, 2);
+	 *		...
+	 *		FramedSerialMessage* m = protocol.read(&serial, &pool);
+	 *		if (m) { dispatch(m); pool.release(m); }
+	 */
+	class FramedSerialMessagePool {
+		private:
+			FramedSerialMessage** messages;
+			uint8_t count;
+			uint8_t used;		// Bit mask of messages currently handed out
+
+		public:
+			FramedSerialMessagePool(FramedSerialMessage** messages, uint8_t count);
+
+			//Returns a free message, or NULL if all messages are in use
+			FramedSerialMessage* acquire();
+
+			//Returns a message to the pool once the caller has finished with it
+			void release(FramedSerialMessage* message);
+
+			//Number of messages which can currently be acquired
+			uint8_t available();
+	};
+
 	class FramedSerialProtocol {
 		private:
 			//Incoming state
-			uint8_t position;			// Current position in the frame
+			uint16_t position;			// Current position in the frame
 			uint8_t length;				// Frame length
 			uint8_t command;			// Incoming message command
-			uint8_t checksum;			// Checksum
+			uint16_t checksum;			// Running checksum or CRC, depending on checksumType
+			uint8_t checksumType;		// FSP_CHECKSUM_* used for both directions
 			uint8_t escape;	 			// Escape byte seen, unescape next byte
 			uint8_t error;	 			// Error condition, ignore bytes until next frame start byte
-			uint8_t* data;				// Incoming message
+			uint8_t* data;				// Incoming message; either buffer or the data of target
 			uint8_t maxSize;			// Data array size
+
+			uint8_t* buffer;			// Scratch buffer used by read(Stream*, FramedSerialMessage*)
+			uint8_t bufferSize;
+			uint8_t allocated;			// Set if buffer was malloc'd by the constructor
+			FramedSerialMessage* target;	// Pool message being decoded into by read(Stream*, FramedSerialMessagePool*)
 			
-			//Convenience method to escape the given byte if needed
-			void escapeByte(Stream* stream, uint8_t b);
+			//Append the given byte to the outgoing buffer at position n, escaping it if needed.  The buffer is
+			// flushed to the stream first if there is no room.  Returns the new position.
+			uint8_t escapeByte(Stream* stream, uint8_t* buffer, uint8_t n, uint8_t b);
+
+			//Run a single incoming byte through the state machine.  Returns 1 if it completed a valid frame.
+			uint8_t decode(uint8_t b, FramedSerialMessagePool* pool);
 
 		public:
 			FramedSerialProtocol(uint8_t maxSize);
+
+			//Decode into a caller owned scratch buffer of maxSize bytes instead of allocating one.  The buffer
+			// may be NULL if only the pool version of read() is used.
+			FramedSerialProtocol(uint8_t* buffer, uint8_t maxSize);
 			~FramedSerialProtocol();
 
 			/*
 			 * Process any available incoming bytes from the stream.  This function MUST be called from the main code repeatedly.
 			 * If a message is completed with this call, then return 1 and update the message's internal values, otherwise return 0.
+			 * No memory is allocated; the payload is copied into result once the frame has been validated.
 			 */
 			uint8_t read(Stream* stream, FramedSerialMessage* result);
+
+			/*
+			 * As above, but each frame is decoded straight into a message acquired from the pool.  Returns the completed
+			 * message, which the caller MUST release back to the pool once it is finished with it, or NULL if no message
+			 * has been completed yet.  Frames which arrive while the pool is empty are dropped with INCOMING_ERROR_POOL_EMPTY.
+			 * Do not mix this with the other version of read() on the same protocol object.
+			 */
+			FramedSerialMessage* read(Stream* stream, FramedSerialMessagePool* pool);
 			
 			//Call this to write the entire message into the provided stream.
 			void write(Stream* stream, FramedSerialMessage* message);
+
+			//Write a frame directly from a payload array, without constructing a message
+			void write(Stream* stream, uint8_t command, uint8_t* data, uint8_t length);
+
+			//Write a frame whose payload is the concatenation of the given spans (at most 254 bytes in total)
+			void write(Stream* stream, uint8_t command, FramedSerialSpan* spans, uint8_t count);
 		
+			/*
+			 * Selects the frame integrity check, FSP_CHECKSUM_ADDITIVE (default) or FSP_CHECKSUM_CRC16, for both
+			 * reading and writing.  Both ends of the link must use the same type; see README.txt.
+			 */
+			void setChecksumType(uint8_t type);
+			uint8_t getChecksumType();
+
 			/*
 			 * Gets the latest error status code.  0 means no error, non-zero is error.
 			 */
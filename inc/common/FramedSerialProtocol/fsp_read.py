@@ -8,8 +8,9 @@
 import serial, sys
 from time import sleep
 
-# Argument is serial port
+# Arguments are serial port, baud rate, and optionally 'crc16' to expect CRC-16 trailers instead of the additive checksum
 ser = serial.Serial(sys.argv[1], sys.argv[2])
+crc16 = len(sys.argv) > 3 and sys.argv[3] == 'crc16'
 
 sleep(1);
 
@@ -23,9 +24,20 @@ pos = 0
 length = 0
 cmd = 0
 chk = 0x00
+crc = 0xFFFF
 
 buf = {}
 
+# CRC-16/CCITT (poly 0x1021, init 0xFFFF), matching dcutil/crc16.h
+def crc16_update(crc, b):
+	crc ^= b << 8
+	for i in range(8):
+		if (crc & 0x8000):
+			crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+		else:
+			crc = (crc << 1) & 0xFFFF
+	return crc
+
 while True:
 	c = ser.read()
 	b = ord(c)
@@ -57,8 +69,11 @@ while True:
 
 	if (pos > 1):
 		chk = (chk + b) & 0xFF
+		crc = crc16_update(crc, b)
 	
 	if (pos == 0):
+		chk = 0
+		crc = 0xFFFF
 		pos = pos + 1
 		sys.stdout.write("Start of Frame: 0x7e\n");
 		continue
@@ -78,8 +93,11 @@ while True:
 			sys.stdout.write("Position > MAX_SIZE\n")
 			continue
 
-		if (pos == (length + 2)):
-			if (chk == 0xff):
+		if (crc16 and pos == (length + 2)):
+			# high CRC byte; the CRC over the data plus both CRC bytes is 0 for a good frame
+			pos = pos + 1
+		elif (pos >= (length + 2)):
+			if ((crc16 and crc == 0) or (not crc16 and chk == 0xff)):
 				#Finished the message; decode it
 				sys.stdout.write("Finished Command " + hex(cmd) + "\n")
 				
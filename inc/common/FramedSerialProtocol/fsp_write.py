@@ -8,14 +8,31 @@ def __escape_byte(message, b):
 	else:
 		message.append(b);
 
-def write(command, data):
+# CRC-16/CCITT (poly 0x1021, init 0xFFFF), matching dcutil/crc16.h
+def crc16_update(crc, b):
+	crc ^= b << 8
+	for i in range(8):
+		if (crc & 0x8000):
+			crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+		else:
+			crc = (crc << 1) & 0xFFFF
+	return crc
+
+# Set crc16 to True to send a CRC-16 trailer instead of the additive checksum; see README.txt
+def write(command, data, crc16 = False):
 	message = [0x7e]
 	__escape_byte(message, len(data) + 1)
 	__escape_byte(message, command)
 	checksum = command
+	crc = crc16_update(0xFFFF, command)
 	for b in data:
 		b = ord(b)
 		__escape_byte(message, b)
 		checksum = (checksum + b) & 0xFF
-	__escape_byte(message, (0xFF - checksum) % 0xFF)
+		crc = crc16_update(crc, b)
+	if (crc16):
+		__escape_byte(message, crc >> 8)
+		__escape_byte(message, crc & 0xFF)
+	else:
+		__escape_byte(message, (0xFF - checksum) % 0xFF)
 	return ''.join(chr(b) for b in message)		#This is a string of raw byte values which can be written to the serial port
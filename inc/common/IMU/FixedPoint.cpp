@@ -0,0 +1,88 @@
+#include "FixedPoint.h"
+
+#include <math.h>
+
+using namespace digitalcave;
+
+//1 / sqrt(x) for x in the middle of each 1/64 wide bin of [0.25, 1), Q2.30
+static const uint32_t rsqrt_seed[48] = {
+	0x7E0BB221, 0x7A64336B, 0x77099EFB, 0x73F1F68D, 0x7114F644, 0x6E6BB6E9, 0x6BF06762, 0x699E16D0,
+	0x67708AF9, 0x65641FAE, 0x6375AD16, 0x61A27320, 0x5FE808FC, 0x5E444FAF, 0x5CB56711, 0x5B39A4C7,
+	0x59CF8CBC, 0x5875CADE, 0x572B2DE0, 0x55EEA2C4, 0x54BF311A, 0x539BF7CD, 0x52842A5F, 0x51770E8F,
+	0x5073FA50, 0x4F7A5202, 0x4E8986EA, 0x4DA115DA, 0x4CC08605, 0x4BE767F5, 0x4B1554A6, 0x4A49ECB3,
+	0x4984D7A4, 0x48C5C34B, 0x480C6332, 0x4758701C, 0x46A9A794, 0x45FFCB80, 0x455AA1CB, 0x44B9F40B,
+	0x441D8F3B, 0x43854374, 0x42F0E3AE, 0x4260458E, 0x41D3412A, 0x4149B0E5, 0x40C3713B, 0x404060A1
+};
+
+/*
+ * Returns y = 1 / sqrt(x) in Q2.30, where the sum of the squares of v (divided by 4 so that four of
+ * them can not overflow) is s = x * 2^(62 + 2k), with x in [0.25, 1).  So |v| = sqrt(x) * 2^(32 + k).
+ * Returns 0 if v is all zero.
+ */
+static uint32_t rsqrt(const fixed_t* v, uint8_t n, uint8_t frac, uint32_t* x, int8_t* k){
+	uint64_t s = 0;
+	for (uint8_t i = 0; i < n; i++){
+		s += (uint64_t) ((int64_t) v[i] * v[i]) >> 2;
+	}
+	if (s == 0) return 0;
+
+	//Shift s by an even number of bits into [2^60, 2^62)
+	uint8_t zeros = __builtin_clzll(s);
+	if (zeros < 2){
+		s >>= 2;
+		*k = 1;
+	}
+	else {
+		uint8_t shift = (zeros - 2) & ~0x01;
+		s <<= shift;
+		*k = -(shift >> 1);
+	}
+	*x = s >> 32;
+
+	//The seed is good to 1.5%, so two Newton-Raphson iterations give 22 bits and three give all 30
+	uint32_t y = rsqrt_seed[(*x >> 24) - 16];
+	for (uint8_t i = (frac > 22 ? 3 : 2); i > 0; i--){
+		uint64_t yy = ((uint64_t) y * y) >> 30;
+		uint64_t xyy = (*x * yy) >> 30;
+		y = ((uint64_t) y * ((3ULL << 30) - xyy)) >> 31;
+	}
+	return y;
+}
+
+void digitalcave::fixed_normalise(fixed_t* v, uint8_t n, uint8_t frac){
+	uint32_t x;
+	int8_t k;
+	uint32_t y = rsqrt(v, n, frac, &x, &k);
+	if (y == 0) return;
+
+	//v / |v| = v * y / 2^(62 + k) in Q(frac)
+	uint8_t shift = 62 + k - frac;
+	int64_t half = (int64_t) 1 << (shift - 1);
+	for (uint8_t i = 0; i < n; i++){
+		v[i] = ((int64_t) v[i] * y + half) >> shift;
+	}
+}
+
+fixed_t digitalcave::fixed_magnitude(const fixed_t* v, uint8_t n, uint8_t frac){
+	uint32_t x;
+	int8_t k;
+	uint32_t y = rsqrt(v, n, frac, &x, &k);
+	if (y == 0) return 0;
+
+	//sqrt(x) = x * y, Q2.30; |v| = sqrt(x) * 2^(2 + k) in the same format as v
+	uint32_t root = ((uint64_t) x * y) >> 30;
+	int8_t shift = 2 + k;
+	return shift >= 0 ? root << shift : root >> -shift;
+}
+
+void digitalcave::fixed_sensor(fixed_t* v, float x, float y, float z){
+	float largest = fabsf(x);
+	if (fabsf(y) > largest) largest = fabsf(y);
+	if (fabsf(z) > largest) largest = fabsf(z);
+	int exponent;
+	frexpf(largest, &exponent);		//largest = [0.5, 1) * 2^exponent; 0 for an all zero vector
+
+	v[0] = lrintf(ldexpf(x, 30 - exponent));
+	v[1] = lrintf(ldexpf(y, 30 - exponent));
+	v[2] = lrintf(ldexpf(z, 30 - exponent));
+}
@@ -0,0 +1,68 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/*
+ * Signed 32 bit fixed point numbers for the fixed point attitude filters (MadgwickFixed and
+ * MahonyFixed).  The precision policy is the number of fraction bits:
+ *  - Q16_16: range +/- 32768, resolution 1.5e-5
+ *  - Q2_30: range +/- 2, resolution 9.3e-10
+ * The filters are written so that every intermediate value stays within +/- 2, so they work with
+ * either policy.  Products are formed in 64 bits and rounded to nearest; truncating instead
+ * would bias every product by half a bit, which adds up to a steady drift over thousands of updates.
+ */
+namespace digitalcave {
+	typedef int32_t fixed_t;
+
+	template <uint8_t FRAC_BITS>
+	struct FixedPoint {
+		static_assert(FRAC_BITS >= 8 && FRAC_BITS <= 30, "FixedPoint must have between 8 and 30 fraction bits");
+
+		static const uint8_t FRAC = FRAC_BITS;
+		static const fixed_t ONE = (fixed_t) 1 << FRAC_BITS;
+		static const fixed_t HALF = (fixed_t) 1 << (FRAC_BITS - 1);
+
+		//Converts from float, rounding to nearest and saturating at the ends of the range
+		static inline fixed_t fromFloat(float f){
+			const float limit = (float) ((int64_t) 1 << (31 - FRAC_BITS));
+			if (f >= limit) return INT32_MAX;
+			if (f <= -limit) return INT32_MIN;
+			return (fixed_t) (f * ONE + (f < 0 ? -0.5f : 0.5f));
+		}
+
+		static inline float toFloat(fixed_t x){
+			return x * (1.0f / ONE);
+		}
+
+		static inline fixed_t mul(fixed_t a, fixed_t b){
+			return (fixed_t) (((int64_t) a * b + HALF) >> FRAC_BITS);
+		}
+	};
+
+	typedef FixedPoint<16> Q16_16;
+	typedef FixedPoint<30> Q2_30;
+
+	//Gyro rates are held divided by 32, so that rates up to 64 rad/s fit with Q2_30.  The filters
+	// multiply by dt as late as possible, since the change over one update is only a few bits with Q16_16.
+	#define FIXED_RATE_SCALE		(1.0f / 32)
+
+	/*
+	 * Converts a sensor reading (accelerometer, magnetometer) for fixed_normalise().  These are only
+	 * ever normalised, so their units (g, gauss, raw counts) do not matter: the vector is scaled by
+	 * the power of two which puts its largest component between 2^29 and 2^30.
+	 */
+	void fixed_sensor(fixed_t* v, float x, float y, float z);
+
+	/*
+	 * Scales the first n values of v (all with the same, any, scale) to a unit vector with frac
+	 * fraction bits.  Uses a table lookup and two or three (for more than 22 fraction bits)
+	 * Newton-Raphson iterations of 1 / sqrt, with no division.  Leaves v alone if it is all zero.
+	 */
+	void fixed_normalise(fixed_t* v, uint8_t n, uint8_t frac);
+
+	//Returns the length of the first n values of v, in the same format as v
+	fixed_t fixed_magnitude(const fixed_t* v, uint8_t n, uint8_t frac);
+}
+
+#endif
@@ -10,6 +10,15 @@ IMU::IMU(uint32_t time) :
 {
 }
 
+IMU::~IMU(){
+}
+
+void IMU::computeFrames(const imu_frame_t* frames, uint8_t count, vector_t mag, uint8_t armed){
+	for (uint8_t i = 0; i < count; i++){
+		compute(frames[i].accel, frames[i].gyro, mag, armed, frames[i].time);
+	}
+}
+
 vector_t IMU::getEuler(){
 	vector_t result;
 	result.x = atan2f(q0*q1 + q2*q3, 0.5f - q1*q1 - q2*q2);
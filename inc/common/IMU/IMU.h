@@ -14,6 +14,14 @@ namespace digitalcave {
 			IMU(uint32_t time);
 			~IMU();
 
+			// Perform the actual calculations (implemented by each filter).  It should be called repeatedly in the main loop.
+			virtual void compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time) = 0;
+			virtual void compute(vector_t accel, vector_t gyro, uint8_t armed, uint32_t time) = 0;
+
+			// Calls compute for each of count frames (e.g. from MPU6050::readFrames), oldest first, using
+			// the frame times.  The magnetometer is much slower, so the same reading is used for all of them.
+			void computeFrames(const imu_frame_t* frames, uint8_t count, vector_t mag, uint8_t armed);
+
 			//Returns the euler angles (in radians) for Roll, Pitch, and Yaw
 			vector_t getEuler();
 			
@@ -19,6 +19,9 @@ Madgwick::Madgwick(float beta, uint32_t time) :
 {
 }
 
+Madgwick::~Madgwick(){
+}
+
 void Madgwick::compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time){
 	float recipNorm;
 	float s0, s1, s2, s3;
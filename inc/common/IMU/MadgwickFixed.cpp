@@ -0,0 +1,170 @@
+/**********************************************************************************************
+ * Fixed point version of Madgwick's IMU implementation (see Madgwick.cpp).
+ *
+ * To keep every intermediate value within +/- 2 (so that Q2.30 can be used), the gradient is
+ * computed divided by 8 (IMU) or 32 (MARG), and the accelerometer / magnetometer errors are
+ * computed halved; the gradient is normalised afterwards so its scale does not matter.  Gyro
+ * rates are scaled by FIXED_RATE_SCALE.
+ *
+ * This Library is licensed under a GPLv3 License
+ **********************************************************************************************/
+
+#include <stddef.h>
+
+#include "MadgwickFixed.h"
+
+using namespace digitalcave;
+
+#define M(a, b)		Q::mul(a, b)
+
+template <class Q>
+MadgwickFixed<Q>::MadgwickFixed(float beta, uint32_t time) :
+	IMU(time),
+	beta(beta)
+{
+	qf[0] = Q::ONE;
+	qf[1] = 0;
+	qf[2] = 0;
+	qf[3] = 0;
+}
+
+template <class Q>
+void MadgwickFixed<Q>::compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time){
+	// Use IMU algorithm if magnetometer measurement invalid (avoids NaN in magnetometer normalisation)
+	if((mag.x == 0.0f) && (mag.y == 0.0f) && (mag.z == 0.0f)) {
+		this->compute(accel, gyro, armed, time);
+		return;
+	}
+
+	float dt = (time - lastTime) / 1000.0;
+	lastTime = time;
+
+	float b = (armed ? beta : beta * 100);	//If not armed, increase beta substantially.  This will more quickly take accelerometers into account and mark the craft as level.
+
+	fixed_t q0 = qf[0], q1 = qf[1], q2 = qf[2], q3 = qf[3];
+
+	// Rate of change of quaternion from gyroscope, times dt
+	fixed_t gx = Q::fromFloat(gyro.x * FIXED_RATE_SCALE), gy = Q::fromFloat(gyro.y * FIXED_RATE_SCALE), gz = Q::fromFloat(gyro.z * FIXED_RATE_SCALE);
+	fixed_t h = Q::fromFloat(0.5f * dt / FIXED_RATE_SCALE);
+	fixed_t qDot[4];
+	qDot[0] = M(-M(q1, gx) - M(q2, gy) - M(q3, gz), h);
+	qDot[1] = M(M(q0, gx) + M(q2, gz) - M(q3, gy), h);
+	qDot[2] = M(M(q0, gy) - M(q1, gz) + M(q3, gx), h);
+	qDot[3] = M(M(q0, gz) + M(q1, gy) - M(q2, gx), h);
+
+	// Compute feedback only if accelerometer measurement valid (avoids NaN in accelerometer normalisation)
+	if(!((accel.x == 0.0f) && (accel.y == 0.0f) && (accel.z == 0.0f))) {
+
+		// Normalise accelerometer and magnetometer measurements
+		fixed_t a[3];
+		fixed_sensor(a, accel.x, accel.y, accel.z);
+		fixed_normalise(a, 3, Q::FRAC);
+		fixed_t m[3];
+		fixed_sensor(m, mag.x, mag.y, mag.z);
+		fixed_normalise(m, 3, Q::FRAC);
+
+		// Auxiliary variables to avoid repeated arithmetic
+		fixed_t q0q1 = M(q0, q1), q0q2 = M(q0, q2), q0q3 = M(q0, q3);
+		fixed_t q1q1 = M(q1, q1), q1q2 = M(q1, q2), q1q3 = M(q1, q3);
+		fixed_t q2q2 = M(q2, q2), q2q3 = M(q2, q3), q3q3 = M(q3, q3);
+
+		// Reference direction of Earth's magnetic field (h is halved; |q| = 1 is used to simplify the terms)
+		fixed_t hx = M(m[0], Q::HALF - q2q2 - q3q3) + M(m[1], q1q2 - q0q3) + M(m[2], q1q3 + q0q2);
+		fixed_t hy = M(m[0], q1q2 + q0q3) + M(m[1], Q::HALF - q1q1 - q3q3) + M(m[2], q2q3 - q0q1);
+		fixed_t h[2] = { hx, hy };
+		fixed_t _2bx = fixed_magnitude(h, 2, Q::FRAC) << 1;
+		fixed_t _2bz = (M(m[0], q1q3 - q0q2) + M(m[1], q0q1 + q2q3) + M(m[2], Q::HALF - q1q1 - q2q2)) << 1;
+
+		// Halved errors between the estimated and measured directions
+		fixed_t fa1 = (q1q3 - q0q2) - (a[0] >> 1);
+		fixed_t fa2 = (q0q1 + q2q3) - (a[1] >> 1);
+		fixed_t fa3 = Q::HALF - q1q1 - q2q2 - (a[2] >> 1);
+		fixed_t fm1 = (M(_2bx, Q::HALF - q2q2 - q3q3) + M(_2bz, q1q3 - q0q2) - m[0]) >> 1;
+		fixed_t fm2 = (M(_2bx, q1q2 - q0q3) + M(_2bz, q0q1 + q2q3) - m[1]) >> 1;
+		fixed_t fm3 = (M(_2bx, q0q2 + q1q3) + M(_2bz, Q::HALF - q1q1 - q2q2) - m[2]) >> 1;
+
+		// Gradient decent algorithm corrective step, divided by 32
+		fixed_t s[4];
+		s[0] = ((-M(q2, fa1) + M(q1, fa2)) >> 3)
+			+ ((-M(M(_2bz, q2), fm1) + M(-M(_2bx, q3) + M(_2bz, q1), fm2) + M(M(_2bx, q2), fm3)) >> 4);
+		s[1] = ((M(q3, fa1) + M(q0, fa2)) >> 3) - (M(q1, fa3) >> 2)
+			+ ((M(M(_2bz, q3), fm1) + M(M(_2bx, q2) + M(_2bz, q0), fm2)) >> 4)
+			+ (M((M(_2bx, q3) >> 1) - M(_2bz, q1), fm3) >> 3);
+		s[2] = ((-M(q0, fa1) + M(q3, fa2)) >> 3) - (M(q2, fa3) >> 2)
+			+ (M(-M(_2bx, q2) - (M(_2bz, q0) >> 1), fm1) >> 3)
+			+ (M(M(_2bx, q1) + M(_2bz, q3), fm2) >> 4)
+			+ (M((M(_2bx, q0) >> 1) - M(_2bz, q2), fm3) >> 3);
+		s[3] = ((M(q1, fa1) + M(q2, fa2)) >> 3)
+			+ (M(-M(_2bx, q3) + (M(_2bz, q1) >> 1), fm1) >> 3)
+			+ ((M(-M(_2bx, q0) + M(_2bz, q2), fm2) + M(M(_2bx, q1), fm3)) >> 4);
+
+		integrate(qDot, s, b * dt);
+	}
+	else {
+		integrate(qDot, NULL, 0);
+	}
+}
+
+template <class Q>
+void MadgwickFixed<Q>::compute(vector_t accel, vector_t gyro, uint8_t armed, uint32_t time){
+	float dt = (time - lastTime) / 1000.0;
+	lastTime = time;
+
+	float b = (armed ? beta : beta * 100);	//If not armed, increase beta substantially.  This will more quickly take accelerometers into account and mark the craft as level.
+
+	fixed_t q0 = qf[0], q1 = qf[1], q2 = qf[2], q3 = qf[3];
+
+	// Rate of change of quaternion from gyroscope, times dt
+	fixed_t gx = Q::fromFloat(gyro.x * FIXED_RATE_SCALE), gy = Q::fromFloat(gyro.y * FIXED_RATE_SCALE), gz = Q::fromFloat(gyro.z * FIXED_RATE_SCALE);
+	fixed_t h = Q::fromFloat(0.5f * dt / FIXED_RATE_SCALE);
+	fixed_t qDot[4];
+	qDot[0] = M(-M(q1, gx) - M(q2, gy) - M(q3, gz), h);
+	qDot[1] = M(M(q0, gx) + M(q2, gz) - M(q3, gy), h);
+	qDot[2] = M(M(q0, gy) - M(q1, gz) + M(q3, gx), h);
+	qDot[3] = M(M(q0, gz) + M(q1, gy) - M(q2, gx), h);
+
+	// Compute feedback only if accelerometer measurement valid (avoids NaN in accelerometer normalisation)
+	if(!((accel.x == 0.0f) && (accel.y == 0.0f) && (accel.z == 0.0f))) {
+
+		// Normalise accelerometer measurement
+		fixed_t a[3];
+		fixed_sensor(a, accel.x, accel.y, accel.z);
+		fixed_normalise(a, 3, Q::FRAC);
+
+		// Gradient decent algorithm corrective step, divided by 8.  With |q| = 1 the -4q1 and -4q2 terms
+		// cancel against the q0q0 and q3q3 ones, which leaves n = q1q1 + q2q2.
+		fixed_t n = M(q1, q1) + M(q2, q2);
+		fixed_t s[4];
+		s[0] = (M(q0, n) >> 1) + ((M(q2, a[0]) - M(q1, a[1])) >> 2);
+		s[1] = (M(q1, n) >> 1) + (M(q1, a[2]) >> 1) - ((M(q3, a[0]) + M(q0, a[1])) >> 2);
+		s[2] = (M(q2, n) >> 1) + (M(q2, a[2]) >> 1) + ((M(q0, a[0]) - M(q3, a[1])) >> 2);
+		s[3] = (M(q3, n) >> 1) - ((M(q1, a[0]) + M(q2, a[1])) >> 2);
+
+		integrate(qDot, s, b * dt);
+	}
+	else {
+		integrate(qDot, NULL, 0);
+	}
+}
+
+template <class Q>
+void MadgwickFixed<Q>::integrate(fixed_t* qDot, fixed_t* s, float bdt){
+	if (s){
+		// Apply feedback step
+		fixed_normalise(s, 4, Q::FRAC);
+		fixed_t b = Q::fromFloat(bdt);
+		for (uint8_t i = 0; i < 4; i++) qDot[i] -= M(b, s[i]);
+	}
+
+	// Integrate rate of change of quaternion to yield quaternion, and normalise
+	for (uint8_t i = 0; i < 4; i++) qf[i] += qDot[i];
+	fixed_normalise(qf, 4, Q::FRAC);
+
+	q0 = Q::toFloat(qf[0]);
+	q1 = Q::toFloat(qf[1]);
+	q2 = Q::toFloat(qf[2]);
+	q3 = Q::toFloat(qf[3]);
+}
+
+template class digitalcave::MadgwickFixed<Q16_16>;
+template class digitalcave::MadgwickFixed<Q2_30>;
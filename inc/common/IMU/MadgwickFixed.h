@@ -0,0 +1,44 @@
+#ifndef MADGWICK_FIXED_H
+#define MADGWICK_FIXED_H
+
+#include "IMU.h"
+#include "FixedPoint.h"
+
+namespace digitalcave {
+	/*
+	 * Fixed point version of Madgwick, for MCUs without a (fast) FPU.  The interface is the same:
+	 * sensor values, beta and the Euler angles stay in float, but all of the filter arithmetic is
+	 * done in 32 bit fixed point, with no square roots or divisions.  Q is the precision policy,
+	 * Q16_16 or Q2_30 (see FixedPoint.h); both are compiled in MadgwickFixed.cpp.
+	 *
+	 * Usage:
+	 *		MadgwickFixed<Q2_30> imu(0.1, timer_millis());
+	 *		imu.compute(accel, gyro, mag, armed, timer_millis());
+	 *		vector_t angle = imu.getEuler();
+	 */
+	template <class Q>
+	class MadgwickFixed : public IMU {
+		public:
+			//Constructor
+			MadgwickFixed(float beta, uint32_t time);
+
+			// Perform the actual calculations.  It should be called repeatedly in the main loop.
+			// No return from this function; call getEuler to get the updated RPY angles
+			void compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time);
+			void compute(vector_t accel, vector_t gyro, uint8_t armed, uint32_t time);
+
+			float getBeta(){ return beta; }
+			void setBeta(float beta) { this->beta = beta; }
+
+		private:
+			//Tuning variables
+			float beta;
+
+			//Quaternion in fixed point; copied to the float one in IMU after every update
+			fixed_t qf[4];
+
+			//Applies the feedback step s (not normalised) and the gyro rate qDot (both times dt), then normalises
+			void integrate(fixed_t* qDot, fixed_t* s, float bdt);
+	};
+}
+#endif
@@ -23,6 +23,9 @@ Mahony::Mahony(float kp, float ki, uint32_t time) :
 {
 }
 
+Mahony::~Mahony(){
+}
+
 void Mahony::compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time){
 	float recipNorm;
     float q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;  
@@ -0,0 +1,169 @@
+/**********************************************************************************************
+ * Fixed point version of Madwick's implementation of Mahoney's IMU (see Mahony.cpp).
+ *
+ * As in MadgwickFixed, the gyro rates (and so the feedback) are scaled by FIXED_RATE_SCALE so
+ * that every intermediate value stays within +/- 2.  The feedback is added to the rates before
+ * they are multiplied by dt, so that it is not lost to rounding with Q16.16.
+ *
+ * This Library is licensed under a GPLv3 License
+ **********************************************************************************************/
+
+#include <stddef.h>
+
+#include "MahonyFixed.h"
+
+using namespace digitalcave;
+
+#define M(a, b)		Q::mul(a, b)
+
+template <class Q>
+MahonyFixed<Q>::MahonyFixed(float kp, float ki, uint32_t time) :
+	IMU(time),
+	kp(kp),
+	ki(ki)
+{
+	integralFB[0] = 0;
+	integralFB[1] = 0;
+	integralFB[2] = 0;
+	qf[0] = Q::ONE;
+	qf[1] = 0;
+	qf[2] = 0;
+	qf[3] = 0;
+}
+
+template <class Q>
+void MahonyFixed<Q>::compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time){
+	// Use IMU algorithm if magnetometer measurement invalid (avoids NaN in magnetometer normalisation)
+	if((mag.x == 0.0f) && (mag.y == 0.0f) && (mag.z == 0.0f)) {
+		compute(accel, gyro, armed, time);
+		return;
+	}
+
+	float dt = (time - lastTime) / 1000.0;
+	lastTime = time;
+
+	fixed_t g[3] = { Q::fromFloat(gyro.x * FIXED_RATE_SCALE), Q::fromFloat(gyro.y * FIXED_RATE_SCALE), Q::fromFloat(gyro.z * FIXED_RATE_SCALE) };
+
+	// Compute feedback only if accelerometer measurement valid (avoids NaN in accelerometer normalisation)
+	if(!((accel.x == 0.0f) && (accel.y == 0.0f) && (accel.z == 0.0f))) {
+		fixed_t q0 = qf[0], q1 = qf[1], q2 = qf[2], q3 = qf[3];
+
+		// Normalise accelerometer and magnetometer measurements
+		fixed_t a[3];
+		fixed_sensor(a, accel.x, accel.y, accel.z);
+		fixed_normalise(a, 3, Q::FRAC);
+		fixed_t m[3];
+		fixed_sensor(m, mag.x, mag.y, mag.z);
+		fixed_normalise(m, 3, Q::FRAC);
+
+		// Auxiliary variables to avoid repeated arithmetic
+		fixed_t q0q0 = M(q0, q0), q0q1 = M(q0, q1), q0q2 = M(q0, q2), q0q3 = M(q0, q3);
+		fixed_t q1q1 = M(q1, q1), q1q2 = M(q1, q2), q1q3 = M(q1, q3);
+		fixed_t q2q2 = M(q2, q2), q2q3 = M(q2, q3), q3q3 = M(q3, q3);
+
+		// Reference direction of Earth's magnetic field (h and b are halved)
+		fixed_t hx = M(m[0], Q::HALF - q2q2 - q3q3) + M(m[1], q1q2 - q0q3) + M(m[2], q1q3 + q0q2);
+		fixed_t hy = M(m[0], q1q2 + q0q3) + M(m[1], Q::HALF - q1q1 - q3q3) + M(m[2], q2q3 - q0q1);
+		fixed_t h[2] = { hx, hy };
+		fixed_t bx = fixed_magnitude(h, 2, Q::FRAC);
+		fixed_t bz = M(m[0], q1q3 - q0q2) + M(m[1], q2q3 + q0q1) + M(m[2], Q::HALF - q1q1 - q2q2);
+
+		// Estimated direction of gravity and magnetic field
+		fixed_t halfvx = q1q3 - q0q2;
+		fixed_t halfvy = q0q1 + q2q3;
+		fixed_t halfvz = q0q0 - Q::HALF + q3q3;
+		fixed_t halfwx = (M(bx, Q::HALF - q2q2 - q3q3) + M(bz, q1q3 - q0q2)) << 1;
+		fixed_t halfwy = (M(bx, q1q2 - q0q3) + M(bz, q0q1 + q2q3)) << 1;
+		fixed_t halfwz = (M(bx, q0q2 + q1q3) + M(bz, Q::HALF - q1q1 - q2q2)) << 1;
+
+		// Error is sum of cross product between estimated direction and measured direction of field vectors
+		fixed_t e[3];
+		e[0] = (M(a[1], halfvz) - M(a[2], halfvy)) + (M(m[1], halfwz) - M(m[2], halfwy));
+		e[1] = (M(a[2], halfvx) - M(a[0], halfvz)) + (M(m[2], halfwx) - M(m[0], halfwz));
+		e[2] = (M(a[0], halfvy) - M(a[1], halfvx)) + (M(m[0], halfwy) - M(m[1], halfwx));
+
+		integrate(g, e, dt);
+	}
+	else {
+		integrate(g, NULL, dt);
+	}
+}
+
+template <class Q>
+void MahonyFixed<Q>::compute(vector_t accel, vector_t gyro, uint8_t armed, uint32_t time){
+	float dt = (time - lastTime) / 1000.0;
+	lastTime = time;
+
+	fixed_t g[3] = { Q::fromFloat(gyro.x * FIXED_RATE_SCALE), Q::fromFloat(gyro.y * FIXED_RATE_SCALE), Q::fromFloat(gyro.z * FIXED_RATE_SCALE) };
+
+	// Compute feedback only if accelerometer measurement valid (avoids NaN in accelerometer normalisation)
+	if(!((accel.x == 0.0f) && (accel.y == 0.0f) && (accel.z == 0.0f))) {
+		fixed_t q0 = qf[0], q1 = qf[1], q2 = qf[2], q3 = qf[3];
+
+		// Normalise accelerometer measurement
+		fixed_t a[3];
+		fixed_sensor(a, accel.x, accel.y, accel.z);
+		fixed_normalise(a, 3, Q::FRAC);
+
+		// Estimated direction of gravity and vector perpendicular to magnetic flux
+		fixed_t halfvx = M(q1, q3) - M(q0, q2);
+		fixed_t halfvy = M(q0, q1) + M(q2, q3);
+		fixed_t halfvz = M(q0, q0) - Q::HALF + M(q3, q3);
+
+		// Error is sum of cross product between estimated and measured direction of gravity
+		fixed_t e[3];
+		e[0] = M(a[1], halfvz) - M(a[2], halfvy);
+		e[1] = M(a[2], halfvx) - M(a[0], halfvz);
+		e[2] = M(a[0], halfvy) - M(a[1], halfvx);
+
+		integrate(g, e, dt);
+	}
+	else {
+		integrate(g, NULL, dt);
+	}
+}
+
+template <class Q>
+void MahonyFixed<Q>::integrate(fixed_t* g, fixed_t* e, float dt){
+	if (e){
+		// Compute and apply integral feedback if enabled
+		if(ki > 0.0f) {
+			fixed_t kidt = Q2_30::fromFloat(ki * dt);
+			fixed_t scale = Q::fromFloat(FIXED_RATE_SCALE);
+			for (uint8_t i = 0; i < 3; i++){
+				integralFB[i] += ((int64_t) kidt * e[i] + Q::HALF) >> Q::FRAC;	// integral error scaled by Ki
+				if (integralFB[i] > Q2_30::ONE) integralFB[i] = Q2_30::ONE;
+				else if (integralFB[i] < -Q2_30::ONE) integralFB[i] = -Q2_30::ONE;
+				g[i] += ((int64_t) integralFB[i] * scale + Q2_30::HALF) >> Q2_30::FRAC;	// apply integral feedback
+			}
+		}
+		else {
+			integralFB[0] = 0;	// prevent integral windup
+			integralFB[1] = 0;
+			integralFB[2] = 0;
+		}
+
+		// Apply proportional feedback
+		fixed_t k = Q::fromFloat(kp * FIXED_RATE_SCALE);
+		for (uint8_t i = 0; i < 3; i++) g[i] += M(k, e[i]);
+	}
+
+	// Integrate rate of change of quaternion
+	fixed_t h = Q::fromFloat(0.5f * dt / FIXED_RATE_SCALE);
+	fixed_t qa = qf[0], qb = qf[1], qc = qf[2], qd = qf[3];
+	qf[0] += M(-M(qb, g[0]) - M(qc, g[1]) - M(qd, g[2]), h);
+	qf[1] += M(M(qa, g[0]) + M(qc, g[2]) - M(qd, g[1]), h);
+	qf[2] += M(M(qa, g[1]) - M(qb, g[2]) + M(qd, g[0]), h);
+	qf[3] += M(M(qa, g[2]) + M(qb, g[1]) - M(qc, g[0]), h);
+
+	// Normalise quaternion
+	fixed_normalise(qf, 4, Q::FRAC);
+
+	q0 = Q::toFloat(qf[0]);
+	q1 = Q::toFloat(qf[1]);
+	q2 = Q::toFloat(qf[2]);
+	q3 = Q::toFloat(qf[3]);
+}
+
+template class digitalcave::MahonyFixed<Q16_16>;
+template class digitalcave::MahonyFixed<Q2_30>;
@@ -0,0 +1,43 @@
+#ifndef MAHONY_FIXED_H
+#define MAHONY_FIXED_H
+
+#include "IMU.h"
+#include "FixedPoint.h"
+
+namespace digitalcave {
+	/*
+	 * Fixed point version of Mahony; see MadgwickFixed.h.  The integral feedback terms change by
+	 * far less than Q16_16's resolution in each update, so they are held in Q2_30 whichever
+	 * policy is used, and limited to +/- 1 rad/s.
+	 */
+	template <class Q>
+	class MahonyFixed : public IMU {
+		public:
+			//Constructor
+			MahonyFixed(float kp, float ki, uint32_t time);
+
+			// Perform the actual calculations.  It should be called repeatedly in the main loop.
+			// No return from this function; call getEuler to get the updated RPY angles
+			void compute(vector_t accel, vector_t gyro, vector_t mag, uint8_t armed, uint32_t time);
+			void compute(vector_t accel, vector_t gyro, uint8_t armed, uint32_t time);
+
+			float getKp(){ return kp; }
+			void setKp(float kp) { this->kp = kp; }
+			float getKi(){ return ki; }
+			void setKi(float ki) { this->ki = ki; }
+
+		private:
+			//Tuning variables
+			float kp;
+			float ki;
+
+			fixed_t integralFB[3];	// integral error terms scaled by Ki, rad/s in Q2_30
+
+			//Quaternion in fixed point; copied to the float one in IMU after every update
+			fixed_t qf[4];
+
+			//Applies the feedback for the halved error e (if any) to the scaled gyro rates g, and integrates
+			void integrate(fixed_t* g, fixed_t* e, float dt);
+	};
+}
+#endif
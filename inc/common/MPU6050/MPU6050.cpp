@@ -6,7 +6,9 @@ using namespace digitalcave;
 MPU6050::MPU6050(I2C* i2c, uint8_t accelRange, uint8_t gyroRange) :
 	i2c(i2c),
 	calibration(),
-	accelRange(accelRange)
+	accelRange(accelRange),
+	fifoPeriod(1),
+	fifoTime(0)
 {
 	uint8_t data[2];
 	I2CMessage message(data, sizeof(data));
@@ -223,6 +225,89 @@ void MPU6050::getRaw(uint8_t* raw){
 	}
 }
 
+void MPU6050::enableFifo(uint8_t divider){
+	uint8_t data[2];
+	I2CMessage message(data, sizeof(data));
+
+	//Output rate; the FIFO is filled at this rate
+	data[0] = MPU6050_SMPLRT_DIV;
+	data[1] = divider;
+	i2c->write(MPU6050_ADDRESS, &message);
+
+	//Accel X/Y/Z and Gyro X/Y/Z go into the FIFO, in register order
+	data[0] = MPU6050_FIFO_EN;
+	data[1] = 0x78;
+	i2c->write(MPU6050_ADDRESS, &message);
+
+	fifoPeriod = divider + 1;
+	resetFifo();
+}
+
+void MPU6050::disableFifo(){
+	uint8_t data[2];
+	I2CMessage message(data, sizeof(data));
+
+	data[0] = MPU6050_FIFO_EN;
+	data[1] = 0x00;
+	i2c->write(MPU6050_ADDRESS, &message);
+
+	data[0] = MPU6050_USER_CTRL;
+	data[1] = 0x00;
+	i2c->write(MPU6050_ADDRESS, &message);
+}
+
+void MPU6050::resetFifo(){
+	uint8_t data[2];
+	I2CMessage message(data, sizeof(data));
+
+	//Empty the FIFO (with it disabled), then enable it again.  The I2C Master bit stays clear (see constructor).
+	data[0] = MPU6050_USER_CTRL;
+	data[1] = 0x04;
+	i2c->write(MPU6050_ADDRESS, &message);
+	data[1] = 0x40;
+	i2c->write(MPU6050_ADDRESS, &message);
+
+	fifoTime = 0;
+}
+
+uint8_t MPU6050::readFrames(imu_frame_t* frames, uint8_t max, uint32_t time){
+	uint8_t data[MPU6050_FIFO_FRAME * MPU6050_FIFO_BURST];
+	I2CMessage message(data, 1);
+	data[0] = MPU6050_FIFO_COUNTH;
+	i2c->write(MPU6050_ADDRESS, &message);				//Go to register MPU6050_FIFO_COUNTH
+	message.setLength(2);
+	i2c->read(MPU6050_ADDRESS, &message);				//Read 2 bytes (FIFO count, 16 bits unsigned)
+
+	//When the FIFO overflows the oldest bytes are dropped, so it is full and no longer a whole number of frames
+	uint16_t available = ((uint16_t) data[0] << 8) | data[1];
+	if (available > MPU6050_FIFO_SIZE - MPU6050_FIFO_FRAME || available % MPU6050_FIFO_FRAME){
+		resetFifo();
+		return 0;
+	}
+	available /= MPU6050_FIFO_FRAME;
+	if (fifoTime == 0) fifoTime = time - available * fifoPeriod;
+
+	uint8_t count = available;
+	if (count > max) count = max;
+	if (count > MPU6050_FIFO_BURST) count = MPU6050_FIFO_BURST;
+	if (count == 0) return 0;
+
+	message.setLength(1);
+	data[0] = MPU6050_FIFO_R_W;
+	i2c->write(MPU6050_ADDRESS, &message);				//Go to register MPU6050_FIFO_R_W
+	message.setLength(count * MPU6050_FIFO_FRAME);
+	i2c->read(MPU6050_ADDRESS, &message);				//Read count frames (Accel X/Y/Z, Gyro X/Y/Z, 16 bits signed each)
+
+	for (uint8_t i = 0; i < count; i++){
+		uint8_t* frame = data + i * MPU6050_FIFO_FRAME;
+		frames[i].accel = getAccelConverted(frame, calibration, accelScale);
+		frames[i].gyro = getGyroConverted(frame + 6, calibration, gyroScale);
+		fifoTime += fifoPeriod;
+		frames[i].time = fifoTime;
+	}
+	return count;
+}
+
 //Get / set calibration data.  Order is Accel X, Y, Z, Gyro X, Y, Z, sent as an int16_t array.
 // These functions can be used to persist to / from EEPROM from main program.
 void MPU6050::setCalibration(int16_t* calibration){
@@ -60,6 +60,19 @@ namespace digitalcave {
 			//Returns the temperature (in C)
 			float getTemperature();
 
+			//Starts the hardware FIFO.  From now on the chip pushes an accel + gyro frame (12 bytes) into
+			// its 1024 byte FIFO every (1 + divider) ms (1kHz / (1 + divider), with the DLPF enabled),
+			// which readFrames() drains.  It holds 85 frames, so read it at least that often.
+			void enableFifo(uint8_t divider = 0);
+			void disableFifo();
+
+			//Reads up to max frames from the FIFO, oldest first, and returns how many were read.  This
+			// takes one I2C read of the count and one burst read of the frames, however many there are
+			// (up to MPU6050_FIFO_BURST; any more are left for next time).  Frames are timestamped at the
+			// sample period, counted from time (ms) on the first read after enableFifo().  If the FIFO
+			// has overflowed (so frames are lost, and the rest misaligned) it is reset and 0 is returned.
+			uint8_t readFrames(imu_frame_t* frames, uint8_t max, uint32_t time);
+
 			//Get / set calibration data.  Order is Accel X, Y, Z, Gyro X, Y, Z, sent as an int16_t array.
 			// These functions can be used to persist to / from EEPROM from main program.
 			int16_t* getCalibration() { return calibration; }
@@ -75,10 +88,22 @@ namespace digitalcave {
 
 			//We need to keep this for the calibration routines
 			uint8_t accelRange;
+
+			//FIFO mode: the sample period (ms), and the time of the last frame read (0 until the first read)
+			uint8_t fifoPeriod;
+			uint32_t fifoTime;
+
+			void resetFifo();
 	};
 
 	#define MPU6050_ADDRESS				0x68
 
+	//Size of one FIFO frame (accel X/Y/Z, gyro X/Y/Z, 16 bits each), the FIFO, and the most frames
+	// that fit in one I2C message
+	#define MPU6050_FIFO_FRAME			12
+	#define MPU6050_FIFO_SIZE			1024
+	#define MPU6050_FIFO_BURST			21
+
 	// Blatently stolen from http://playground.arduino.cc/Main/MPU-6050
 	//
 	// Register names according to the datasheet.
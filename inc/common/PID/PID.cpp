@@ -84,6 +84,11 @@ void PID::setOutputLimits(float min, float max){
 	outMax = max;
 }
 
+void PID::getOutputLimits(float* min, float* max){
+	*min = outMin;
+	*max = outMax;
+}
+
 void PID::setDirection(uint8_t direction){
 	if(direction != this->direction){
 		kp = (0 - kp);
@@ -37,6 +37,7 @@ namespace digitalcave {
 
 			//Clamps the output to a specific range. (0-255 by default)
 			void setOutputLimits(float min, float max);
+			void getOutputLimits(float* min, float* max);
 
 			//Get / Set PID tunings
 			void getTunings(float* kp, float* ki, float* kd);
@@ -0,0 +1,70 @@
+#include "Scheduler.h"
+
+#include <string.h>
+
+using namespace digitalcave;
+
+Scheduler::Scheduler() :
+	count(0)
+{
+	resetStats();
+}
+
+uint8_t Scheduler::add(uint32_t period, uint32_t deadline, uint32_t offset){
+	if (count >= SCHEDULER_MAX_TASKS || period == 0) return SCHEDULER_IDLE;
+
+	scheduler_task_t* t = &tasks[count];
+	t->period = period;
+	t->deadline = deadline ? deadline : period;
+	t->offset = offset;
+	t->release = offset;
+	t->start = offset;
+	return count++;
+}
+
+void Scheduler::start(uint32_t time){
+	for (uint8_t i = 0; i < count; i++){
+		tasks[i].release = time + tasks[i].offset;
+	}
+	resetStats();
+}
+
+uint8_t Scheduler::poll(uint32_t time){
+	for (uint8_t i = 0; i < count; i++){
+		scheduler_task_t* t = &tasks[i];
+		uint32_t late = time - t->release;
+		if ((int32_t) late < 0) continue;
+
+		//Releases which have passed while it waited are dropped, rather than run in a burst to
+		// catch up, so this run is for the latest of them and the task stays on its release grid
+		if (late >= t->period){
+			uint32_t skipped = late / t->period;
+			t->release += skipped * t->period;
+			late -= skipped * t->period;
+			stats[i].skips = (stats[i].skips + skipped > 0xFFFF) ? 0xFFFF : stats[i].skips + skipped;
+		}
+
+		t->start = time;
+		if (late > stats[i].latency) stats[i].latency = late;
+		return i;
+	}
+	return SCHEDULER_IDLE;
+}
+
+void Scheduler::done(uint8_t task, uint32_t time){
+	if (task >= count) return;
+	scheduler_task_t* t = &tasks[task];
+	scheduler_stats_t* s = &stats[task];
+
+	uint32_t elapsed = time - t->start;
+	uint32_t late = time - t->release;
+	if (elapsed > s->wcet) s->wcet = elapsed;
+	if (late > t->deadline && s->overruns < 0xFFFF) s->overruns++;
+	s->runs++;
+
+	t->release += t->period;
+}
+
+void Scheduler::resetStats(){
+	memset(stats, 0, sizeof(stats));
+}
@@ -0,0 +1,77 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+//The most tasks one scheduler holds
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS		4
+#endif
+
+//Returned by poll() when no task is due, and by add() when there is no room
+#define SCHEDULER_IDLE			0xFF
+
+namespace digitalcave {
+
+	/*
+	 * Execution statistics for one task, in µs.  A task is released every period; it overruns when
+	 * it finishes more than its deadline after the release, and releases are skipped when it has not
+	 * started by the time the next one is due.
+	 */
+	typedef struct scheduler_stats {
+		uint32_t wcet;			//Longest execution time
+		uint32_t latency;		//Longest delay from release to start
+		uint32_t runs;
+		uint16_t overruns;		//Saturates at 0xFFFF
+		uint16_t skips;			//Saturates at 0xFFFF
+	} scheduler_stats_t;
+
+	/*
+	 * A cooperative rate group scheduler.  Tasks are added in priority order; when several are due,
+	 * the one added first runs first.  The scheduler does not call the tasks or read the clock: the
+	 * main loop asks poll() which task to run, runs it, and then calls done().  Nothing is preempted,
+	 * so a long low priority task delays the high priority ones, which shows in their latency and
+	 * overruns.  Times are µs on a free running 32 bit clock, and may wrap.
+	 */
+	class Scheduler {
+		private:
+			typedef struct scheduler_task {
+				uint32_t period;
+				uint32_t deadline;
+				uint32_t offset;
+				uint32_t release;		//When it is (or was last) due
+				uint32_t start;			//When it was last started
+			} scheduler_task_t;
+
+			scheduler_task_t tasks[SCHEDULER_MAX_TASKS];
+			scheduler_stats_t stats[SCHEDULER_MAX_TASKS];
+			uint8_t count;
+
+		public:
+			Scheduler();
+
+			//Adds a task which is released every period µs, offset µs after start(), and must finish
+			// within deadline µs of each release (0 for the whole period).  Offsets spread the slower
+			// tasks between releases of the faster ones.  Returns the task index.
+			uint8_t add(uint32_t period, uint32_t deadline, uint32_t offset);
+
+			//Releases every task relative to time, and clears the statistics
+			void start(uint32_t time);
+
+			//Returns the highest priority task which is due at time, or SCHEDULER_IDLE.  A task which
+			// has waited past one or more later releases runs once, for the latest of them.
+			uint8_t poll(uint32_t time);
+
+			//Records that task (as returned from poll()) finished at time, and schedules its next release
+			void done(uint8_t task, uint32_t time);
+
+			//The release which the task (as returned from poll()) is running for.  Releases stay on the
+			// task's grid however late it starts, so they are a jitter free time base for the task.
+			uint32_t getRelease(uint8_t task) { return tasks[task].release; }
+
+			uint8_t getCount() { return count; }
+			scheduler_stats_t* getStats(uint8_t task) { return &stats[task]; }
+			void resetStats();
+	};
+}
+#endif
@@ -1,5 +1,7 @@
 #include "ArrayStream.h"
 
+#include <string.h>
+
 using namespace digitalcave;
 
 ArrayStream::ArrayStream(uint8_t capacity) {
@@ -22,6 +24,10 @@ uint8_t ArrayStream::remaining() {
 	return capacity - size();
 }
 
+uint16_t ArrayStream::writable() {
+	return remaining() - 1;
+}
+
 uint8_t ArrayStream::size() {
 	return (head >= tail) ? head - tail : capacity - tail + head;
 }
@@ -54,3 +60,62 @@ uint8_t ArrayStream::write(uint8_t b){
 	if (++head >= capacity) head = 0;
 	return 1;
 }
+
+uint16_t ArrayStream::read(uint8_t* a, uint16_t len){
+	if (len == 0) return 0;
+	len--;	//Same contract as Stream::read; at most len - 1 bytes
+
+	uint16_t count = 0;
+	uint8_t* region;
+	uint8_t available;
+	while (count < len && (available = acquireRead(&region)) > 0){
+		if (available > len - count) available = len - count;
+		memcpy(a + count, region, available);
+		commitRead(available);
+		count += available;
+	}
+	return count;
+}
+
+uint16_t ArrayStream::write(uint8_t* data, uint16_t len){
+	uint16_t count = 0;
+	uint8_t* region;
+	uint8_t available;
+	while (count < len && (available = acquireWrite(&region)) > 0){
+		if (available > len - count) available = len - count;
+		memcpy(region, data + count, available);
+		commitWrite(available);
+		count += available;
+	}
+	return count;
+}
+
+uint8_t ArrayStream::acquireWrite(uint8_t** region){
+	uint8_t t = tail;
+	uint8_t h = head;
+	*region = (uint8_t*) data + h;
+	if (h >= t){
+		//Free space runs to the end of the array, less one slot if the tail is at the start
+		return capacity - h - (t == 0 ? 1 : 0);
+	}
+	return t - h - 1;
+}
+
+void ArrayStream::commitWrite(uint8_t n){
+	uint16_t h = head + n;
+	if (h >= capacity) h -= capacity;
+	head = h;
+}
+
+uint8_t ArrayStream::acquireRead(uint8_t** region){
+	uint8_t h = head;
+	uint8_t t = tail;
+	*region = (uint8_t*) data + t;
+	return (h >= t) ? h - t : capacity - t;
+}
+
+void ArrayStream::commitRead(uint8_t n){
+	uint16_t t = tail + n;
+	if (t >= capacity) t -= capacity;
+	tail = t;
+}
@@ -1,6 +1,11 @@
 /*
  * Stream implementation of a ring buffer.  The size is determined at instntiation,
  * and you can read / write to it just like any other stream.
+ *
+ * In addition to the normal stream functions, the buffer can be accessed directly by
+ * acquiring a contiguous region, copying into / out of it, and then committing the number
+ * of bytes actually used.  This lets callers memcpy (or DMA) whole spans instead of going
+ * through read / write once per byte.
  */
 
 #ifndef ARRAY_STREAM_H
@@ -23,8 +28,31 @@ namespace digitalcave {
 			uint8_t read(uint8_t *b);
 			uint8_t write(uint8_t b);
 
+			// Bulk overrides; these copy at most two spans (before and after the wrap point)
+			uint16_t read(uint8_t* a, uint16_t len);
+			uint16_t write(uint8_t* data, uint16_t len);
+
+			// Free space; one slot is always left empty to tell full from empty
+			uint16_t writable();
+
 			uint8_t peek(uint8_t *b);
 
+			/*
+			 * Returns the number of bytes which can be written contiguously starting at the
+			 * head of the buffer, and points region at the first of them.  After filling
+			 * (part of) the region, call commitWrite() with the number of bytes written.
+			 */
+			uint8_t acquireWrite(uint8_t** region);
+			void commitWrite(uint8_t n);
+
+			/*
+			 * Returns the number of bytes which can be read contiguously starting at the
+			 * tail of the buffer, and points region at the first of them.  After consuming
+			 * (part of) the region, call commitRead() with the number of bytes consumed.
+			 */
+			uint8_t acquireRead(uint8_t** region);
+			void commitRead(uint8_t n);
+
 			void clear();
 			uint8_t remaining();
 			uint8_t size();
@@ -0,0 +1,215 @@
+#include "BlockCache.h"
+
+#include <string.h>
+
+using namespace digitalcave;
+
+BlockCache::BlockCache(BlockDevice* device, uint8_t slotCount, uint8_t readAhead) :
+	device(device),
+	tick(0),
+	block(0),
+	position(0),
+	current(NULL),
+	hits(0),
+	misses(0)
+{
+	if (slotCount == 0) slotCount = 1;
+	if (readAhead >= slotCount) readAhead = slotCount - 1;	//The block asked for needs a slot too
+	this->slotCount = slotCount;
+	this->readAhead = readAhead;
+	this->slots = (BlockCacheSlot*) malloc(sizeof(BlockCacheSlot) * slotCount);
+	this->run = (uint8_t**) malloc(sizeof(uint8_t*) * slotCount);
+	for (uint8_t i = 0; i < slotCount; i++){
+		slots[i].flags = 0;
+		slots[i].used = 0;
+	}
+}
+
+BlockCache::~BlockCache(){
+	flush();
+	free(slots);
+	free(run);
+}
+
+BlockCacheSlot* BlockCache::find(uint32_t address){
+	for (uint8_t i = 0; i < slotCount; i++){
+		if ((slots[i].flags & BLOCK_CACHE_VALID) && slots[i].block == address) return &slots[i];
+	}
+	return NULL;
+}
+
+BlockCacheSlot* BlockCache::victim(){
+	BlockCacheSlot* oldest = NULL;
+	for (uint8_t i = 0; i < slotCount; i++){
+		BlockCacheSlot* s = &slots[i];
+		if (s->flags == 0) return s;
+		if (!(s->flags & BLOCK_CACHE_LOADING) && (oldest == NULL || s->used < oldest->used)) oldest = s;
+	}
+	if (oldest == NULL) return NULL;
+	if ((oldest->flags & BLOCK_CACHE_DIRTY) && !writeBack(oldest)) return NULL;
+	if (oldest == current) current = NULL;
+	oldest->flags = 0;
+	return oldest;
+}
+
+BlockCacheSlot* BlockCache::load(){
+	if (current) return current;
+
+	BlockCacheSlot* s = find(block);
+	if (s){
+		hits++;
+		s->used = ++tick;
+		current = s;
+		return s;
+	}
+
+	//Miss; claim a slot for this block and for each following block which is not already cached
+	misses++;
+	tick++;
+	uint8_t count = 0;
+	while (count <= readAhead){
+		if (count > 0 && find(block + count)) break;
+		s = victim();
+		if (s == NULL) break;
+		s->block = block + count;
+		s->flags = BLOCK_CACHE_LOADING;
+		s->used = tick;
+		count++;
+	}
+	if (count == 0) return NULL;
+
+	//Only list the buffers now, as victim() may have used run to write back
+	for (uint8_t i = 0; i < slotCount; i++){
+		s = &slots[i];
+		if (s->flags & BLOCK_CACHE_LOADING) run[s->block - block] = s->data;
+	}
+
+	uint8_t read = device->readBlocks(block, run, count);
+	for (uint8_t i = 0; i < slotCount; i++){
+		s = &slots[i];
+		if (s->flags & BLOCK_CACHE_LOADING){
+			s->flags = (s->block - block < read) ? BLOCK_CACHE_VALID : 0;
+			if (s->block == block && s->flags) current = s;
+		}
+	}
+	return current;
+}
+
+void BlockCache::setBlock(uint32_t address){
+	this->block = address;
+	this->position = 0;
+	this->current = NULL;
+}
+
+uint16_t BlockCache::skip(uint16_t n){
+	if (n > BLOCK_DEVICE_BLOCK_SIZE - position) n = BLOCK_DEVICE_BLOCK_SIZE - position;
+	position += n;
+	return n;
+}
+
+uint8_t BlockCache::read(uint8_t* b){
+	if (position >= BLOCK_DEVICE_BLOCK_SIZE) return 0;
+	BlockCacheSlot* s = load();
+	if (s == NULL) return 0;
+	*b = s->data[position++];
+	return 1;
+}
+
+uint16_t BlockCache::read(uint8_t* a, uint16_t len){
+	if (len == 0) return 0;
+	len--;	//Same contract as Stream::read; at most len - 1 bytes
+	if (len > BLOCK_DEVICE_BLOCK_SIZE - position) len = BLOCK_DEVICE_BLOCK_SIZE - position;
+	if (len == 0) return 0;
+	BlockCacheSlot* s = load();
+	if (s == NULL) return 0;
+	memcpy(a, s->data + position, len);
+	position += len;
+	return len;
+}
+
+uint8_t BlockCache::write(uint8_t b){
+	if (position >= BLOCK_DEVICE_BLOCK_SIZE) return 0;
+	BlockCacheSlot* s = load();
+	if (s == NULL) return 0;
+	s->data[position++] = b;
+	s->flags |= BLOCK_CACHE_DIRTY;
+	return 1;
+}
+
+uint16_t BlockCache::write(uint8_t* a, uint16_t len){
+	if (len > BLOCK_DEVICE_BLOCK_SIZE - position) len = BLOCK_DEVICE_BLOCK_SIZE - position;
+	if (len == 0) return 0;
+	BlockCacheSlot* s = load();
+	if (s == NULL) return 0;
+	memcpy(s->data + position, a, len);
+	position += len;
+	s->flags |= BLOCK_CACHE_DIRTY;
+	return len;
+}
+
+uint8_t BlockCache::readBlocks(uint32_t address, uint8_t** buffers, uint8_t count){
+	//Go through the stream state so that misses get read ahead, then put it back
+	uint32_t block = this->block;
+	uint16_t position = this->position;
+	uint8_t i;
+	for (i = 0; i < count; i++){
+		setBlock(address + i);
+		BlockCacheSlot* s = load();
+		if (s == NULL) break;
+		memcpy(buffers[i], s->data, BLOCK_DEVICE_BLOCK_SIZE);
+	}
+	setBlock(block);
+	this->position = position;
+	return i;
+}
+
+uint8_t BlockCache::writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count){
+	for (uint8_t i = 0; i < count; i++){
+		//Whole blocks are overwritten, so there is no need to read them first
+		BlockCacheSlot* s = find(address + i);
+		if (s == NULL){
+			s = victim();
+			if (s == NULL) return i;
+			s->block = address + i;
+		}
+		memcpy(s->data, buffers[i], BLOCK_DEVICE_BLOCK_SIZE);
+		s->flags = BLOCK_CACHE_VALID | BLOCK_CACHE_DIRTY;
+		s->used = ++tick;
+	}
+	return count;
+}
+
+uint8_t BlockCache::writeBack(BlockCacheSlot* first){
+	//The block, followed by as many consecutive dirty blocks as there are
+	uint32_t address = first->block;
+	uint8_t count = 0;
+	for (BlockCacheSlot* s = first; s && (s->flags & BLOCK_CACHE_DIRTY); s = find(address + count)){
+		run[count++] = s->data;
+	}
+
+	uint8_t written = device->writeBlocks(address, run, count);
+	for (uint8_t i = 0; i < written; i++){
+		find(address + i)->flags &= ~BLOCK_CACHE_DIRTY;
+	}
+	return written == count;
+}
+
+uint8_t BlockCache::flush(){
+	while (1){
+		//Lowest dirty block first, so that runs are written whole
+		BlockCacheSlot* first = NULL;
+		for (uint8_t i = 0; i < slotCount; i++){
+			if ((slots[i].flags & BLOCK_CACHE_DIRTY) && (first == NULL || slots[i].block < first->block)) first = &slots[i];
+		}
+		if (first == NULL) return device->flush();
+		if (!writeBack(first)) return 0;
+	}
+}
+
+void BlockCache::invalidate(){
+	flush();
+	for (uint8_t i = 0; i < slotCount; i++){
+		slots[i].flags = 0;
+	}
+	current = NULL;
+}
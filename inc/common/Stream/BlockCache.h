@@ -0,0 +1,100 @@
+/*
+ * BlockDevice decorator which keeps the most recently used blocks of another BlockDevice in
+ * RAM.  File systems tend to go back to the same few blocks over and over (the FAT, the
+ * directory, the block of a file being read a few bytes at a time); with a cache in between,
+ * each of those is read from the card once instead of on every call.
+ *
+ * Each slot costs a little over BLOCK_DEVICE_BLOCK_SIZE bytes of RAM.  When a block is not in
+ * the cache, the least recently used slot is reused, and the following readAhead blocks are
+ * fetched in the same readBlocks() call, which helps sequential reads on drivers which support
+ * multi block commands.  Writes (stream writes or writeBlocks) only change the cached copy and
+ * mark it dirty; dirty blocks are written back when their slot is reused (along with any dirty
+ * blocks which follow it, in one writeBlocks() call), on flush(), or
+ * when the cache is destroyed.  Call flush() before removing power or the card.
+ *
+ * Usage:
+ *		SD sd(&PORTB, _BV(PORTB0));
+ *		BlockCache cache(&sd, 4, 1);
+ *		File root(&cache);
+ */
+
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include "BlockDevice.h"
+
+#define BLOCK_CACHE_VALID		0x01
+#define BLOCK_CACHE_DIRTY		0x02
+#define BLOCK_CACHE_LOADING		0x04
+
+namespace digitalcave {
+	struct BlockCacheSlot {
+		uint32_t block;
+		uint32_t used;		// Value of the cache tick when this slot was last used
+		uint8_t flags;
+		uint8_t data[BLOCK_DEVICE_BLOCK_SIZE];
+	};
+
+	class BlockCache : public BlockDevice {
+
+		private:
+			BlockDevice* device;
+			BlockCacheSlot* slots;
+			uint8_t** run;			// Scratch list of buffers for multi block transfers
+			uint8_t slotCount;
+			uint8_t readAhead;
+			uint32_t tick;
+
+			// stream
+			uint32_t block;
+			uint16_t position;
+			BlockCacheSlot* current;	// Slot holding block, or NULL until it is needed
+
+			uint32_t hits;
+			uint32_t misses;
+
+			/* Returns the slot holding the given block, or NULL */
+			BlockCacheSlot* find(uint32_t address);
+			/* Returns an empty slot or the least recently used one, written back first if dirty; NULL on write error */
+			BlockCacheSlot* victim();
+			/* Writes back the given dirty slot, along with any dirty slots holding the blocks following it; returns 1 if all were written */
+			uint8_t writeBack(BlockCacheSlot* first);
+			/* Returns the slot holding the current block, reading it (and the read ahead blocks) on a miss; NULL on read error */
+			BlockCacheSlot* load();
+
+		public:
+			BlockCache(BlockDevice* device, uint8_t slotCount, uint8_t readAhead = 0);
+			~BlockCache();
+
+			void setBlock(uint32_t address);
+			uint16_t skip(uint16_t n);
+			uint8_t read(uint8_t* b);
+			uint16_t read(uint8_t* a, uint16_t len);
+			uint8_t write(uint8_t b);
+			uint16_t write(uint8_t* a, uint16_t len);
+
+			uint8_t readBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+			uint8_t writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+
+			/*
+			 * Writes all dirty blocks back to the device, coalescing runs of consecutive blocks
+			 * into a single writeBlocks() call, then flushes the device (which e.g. ends an open
+			 * multiple block write on an SD card).  Returns 1 if everything was written.
+			 */
+			uint8_t flush();
+
+			/*
+			 * Flushes, then forgets every cached block (e.g. after the card has been changed).
+			 */
+			void invalidate();
+
+			//Block lookups which were / were not satisfied from the cache
+			uint32_t getHits() { return hits; }
+			uint32_t getMisses() { return misses; }
+
+			using BlockDevice::read;
+			using BlockDevice::write;
+	};
+}
+
+#endif
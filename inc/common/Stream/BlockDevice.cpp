@@ -0,0 +1,21 @@
+#include "BlockDevice.h"
+
+using namespace digitalcave;
+
+uint8_t BlockDevice::readBlocks(uint32_t address, uint8_t** buffers, uint8_t count){
+	for (uint8_t i = 0; i < count; i++){
+		setBlock(address + i);
+		for (uint16_t j = 0; j < BLOCK_DEVICE_BLOCK_SIZE; j++){
+			if (!read(buffers[i] + j)) return i;
+		}
+	}
+	return count;
+}
+
+uint8_t BlockDevice::writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count){
+	for (uint8_t i = 0; i < count; i++){
+		setBlock(address + i);
+		if (write(buffers[i], BLOCK_DEVICE_BLOCK_SIZE) != BLOCK_DEVICE_BLOCK_SIZE) return i;
+	}
+	return count;
+}
@@ -3,14 +3,55 @@
 
 #include "Stream.h"
 
+#define BLOCK_DEVICE_BLOCK_SIZE		512
+
 namespace digitalcave {
 	class BlockDevice : Stream {
 
 	public:
+		/*
+		 * Virtual, so that deleting a decorator (e.g. BlockCache) through a BlockDevice pointer
+		 * still runs its destructor and writes back anything it holds.
+		 */
+		virtual ~BlockDevice() {}
+
+		/*
+		 * Selects the block which the stream functions (skip, read, write) operate on, and
+		 * moves to the start of it.  Every driver keeps the Stream contract for these: read(a, len)
+		 * returns at most len - 1 bytes, stopping at the end of the block.
+		 */
 		virtual void setBlock(uint32_t address) = 0;
 
+		/*
+		 * Moves forward n bytes within the current block.  Returns the number of bytes skipped.
+		 */
+		virtual uint16_t skip(uint16_t n) = 0;
+
+		/*
+		 * Reads count consecutive whole blocks starting at address; block i goes into buffers[i].
+		 * Returns the number of blocks read, which is less than count on error.  The default
+		 * implementation goes through setBlock and the stream functions one block at a time;
+		 * drivers which can transfer a whole block (or a run of blocks) in one command should
+		 * override it.
+		 */
+		virtual uint8_t readBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+
+		/*
+		 * Writes count consecutive whole blocks starting at address from buffers[i].  Returns
+		 * the number of blocks written.  Default implementation as for readBlocks.
+		 */
+		virtual uint8_t writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+
+		/*
+		 * Writes anything buffered (e.g. by a cache) through to the device.  Returns 1 if
+		 * successful.  The default implementation has nothing to write.
+		 */
+		virtual uint8_t flush() { return 1; }
+
+		uint8_t readBlock(uint32_t address, uint8_t* buffer) { return readBlocks(address, &buffer, 1); }
+		uint8_t writeBlock(uint32_t address, uint8_t* buffer) { return writeBlocks(address, &buffer, 1); }
+
 		using Stream::reset;
-		using Stream::skip;
 		using Stream::read;
 		using Stream::write;
 	};
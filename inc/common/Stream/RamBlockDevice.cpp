@@ -0,0 +1,86 @@
+#include "RamBlockDevice.h"
+
+#include <string.h>
+
+using namespace digitalcave;
+
+RamBlockDevice::RamBlockDevice(uint8_t* data, uint32_t blockCount) :
+	data(data),
+	blockCount(blockCount),
+	block(0),
+	position(0),
+	commands(0),
+	blocksRead(0),
+	blocksWritten(0)
+{
+}
+
+void RamBlockDevice::setBlock(uint32_t address){
+	this->block = address;
+	this->position = 0;
+}
+
+uint16_t RamBlockDevice::skip(uint16_t n){
+	if (n > BLOCK_DEVICE_BLOCK_SIZE - position) n = BLOCK_DEVICE_BLOCK_SIZE - position;
+	position += n;
+	return n;
+}
+
+uint8_t RamBlockDevice::read(uint8_t* b){
+	if (block >= blockCount || position >= BLOCK_DEVICE_BLOCK_SIZE) return 0;
+	commands++;
+	blocksRead++;
+	*b = data[block * BLOCK_DEVICE_BLOCK_SIZE + position++];
+	return 1;
+}
+
+uint16_t RamBlockDevice::read(uint8_t* a, uint16_t len){
+	if (block >= blockCount || len == 0) return 0;
+	len--;	//Same contract as Stream::read; at most len - 1 bytes
+	if (len > BLOCK_DEVICE_BLOCK_SIZE - position) len = BLOCK_DEVICE_BLOCK_SIZE - position;
+	commands++;
+	blocksRead++;
+	memcpy(a, data + block * BLOCK_DEVICE_BLOCK_SIZE + position, len);
+	position += len;
+	return len;
+}
+
+uint8_t RamBlockDevice::write(uint8_t b){
+	if (block >= blockCount || position >= BLOCK_DEVICE_BLOCK_SIZE) return 0;
+	commands++;
+	blocksWritten++;
+	data[block * BLOCK_DEVICE_BLOCK_SIZE + position++] = b;
+	return 1;
+}
+
+uint16_t RamBlockDevice::write(uint8_t* a, uint16_t len){
+	if (block >= blockCount) return 0;
+	if (len > BLOCK_DEVICE_BLOCK_SIZE - position) len = BLOCK_DEVICE_BLOCK_SIZE - position;
+	commands++;
+	blocksWritten++;
+	memcpy(data + block * BLOCK_DEVICE_BLOCK_SIZE + position, a, len);
+	position += len;
+	return len;
+}
+
+uint8_t RamBlockDevice::readBlocks(uint32_t address, uint8_t** buffers, uint8_t count){
+	if (address >= blockCount) return 0;
+	if (count > blockCount - address) count = blockCount - address;
+	commands++;
+	for (uint8_t i = 0; i < count; i++){
+		memcpy(buffers[i], data + (address + i) * BLOCK_DEVICE_BLOCK_SIZE, BLOCK_DEVICE_BLOCK_SIZE);
+	}
+	blocksRead += count;
+	return count;
+}
+
+uint8_t RamBlockDevice::writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count){
+	if (address >= blockCount) return 0;
+	if (count > blockCount - address) count = blockCount - address;
+	commands++;
+	for (uint8_t i = 0; i < count; i++){
+		memcpy(data + (address + i) * BLOCK_DEVICE_BLOCK_SIZE, buffers[i], BLOCK_DEVICE_BLOCK_SIZE);
+	}
+	blocksWritten += count;
+	return count;
+}
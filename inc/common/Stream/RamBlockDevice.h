@@ -0,0 +1,56 @@
+/*
+ * BlockDevice backed by a caller supplied array of blocks; useful as a RAM disk, and for
+ * testing file systems and caches on the host.
+ *
+ * The device keeps count of the work a real card would have to do.  Every stream read()
+ * or write() call costs a command and a whole block transfer, like the SD drivers which
+ * issue a single block command per call; readBlocks() / writeBlocks() cost one command for
+ * the whole run of blocks, like a multi block command.
+ */
+
+#ifndef RAM_BLOCK_DEVICE_H
+#define RAM_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+namespace digitalcave {
+	class RamBlockDevice : public BlockDevice {
+
+		private:
+			uint8_t* data;
+			uint32_t blockCount;
+			uint32_t block;
+			uint16_t position;
+
+			uint32_t commands;
+			uint32_t blocksRead;
+			uint32_t blocksWritten;
+
+		public:
+			//data must hold blockCount * BLOCK_DEVICE_BLOCK_SIZE bytes
+			RamBlockDevice(uint8_t* data, uint32_t blockCount);
+
+			void setBlock(uint32_t address);
+			uint16_t skip(uint16_t n);
+			uint8_t read(uint8_t* b);
+			uint16_t read(uint8_t* a, uint16_t len);
+			uint8_t write(uint8_t b);
+			uint16_t write(uint8_t* a, uint16_t len);
+
+			uint8_t readBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+			uint8_t writeBlocks(uint32_t address, uint8_t** buffers, uint8_t count);
+
+			uint32_t getBlockCount() { return blockCount; }
+
+			//Work done so far, and resetting it
+			uint32_t getCommands() { return commands; }
+			uint32_t getBlocksRead() { return blocksRead; }
+			uint32_t getBlocksWritten() { return blocksWritten; }
+			void resetCounters() { commands = 0; blocksRead = 0; blocksWritten = 0; }
+
+			using BlockDevice::read;
+			using BlockDevice::write;
+	};
+}
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Stream implementation of a ring buffer with a compile time, power of two capacity of up
+ * to 64KiB.  This is the big brother of ArrayStream: indices are 16 bits wide and wrap with
+ * a mask instead of a compare / modulo, and the storage is part of the object so no malloc
+ * is needed.  As with ArrayStream, one slot is kept empty to tell full from empty, so a
+ * RingStream<256> holds at most 255 bytes.
+ *
+ * Concurrency: the buffer is lock free for exactly one producer and one consumer, e.g. a
+ * receive ISR calling write() and the main loop calling read().  The producer only ever
+ * stores head and the consumer only ever stores tail; each publishes its index after the
+ * data it covers has been copied.  clear() and reset() are NOT safe while the other side
+ * may be running.  On AVR a 16 bit index can not be loaded or stored in one instruction,
+ * so stores are done with interrupts briefly masked and loads are repeated until they
+ * are stable; everywhere else index accesses are single instructions.
+ *
+ * Usage:
+ *		RingStream<1024> rxBuffer;
+ *		ISR(USART1_RX_vect){ rxBuffer.write(UDR1); }
+ *		...
+ *		while (rxBuffer.read(&b)) { ... }
+ */
+
+#ifndef RING_STREAM_H
+#define RING_STREAM_H
+
+#include <string.h>
+
+#include "Stream.h"
+
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#define RING_STREAM_BARRIER()	__asm__ __volatile__ ("" ::: "memory")
+#else
+#define RING_STREAM_BARRIER()	__sync_synchronize()
+#endif
+
+namespace digitalcave {
+	template <uint32_t CAPACITY>
+	class RingStream : public Stream {
+
+		static_assert(CAPACITY >= 2 && CAPACITY <= 65536, "RingStream capacity must be between 2 and 65536");
+		static_assert((CAPACITY & (CAPACITY - 1)) == 0, "RingStream capacity must be a power of two");
+
+		private:
+			static const uint16_t MASK = (uint16_t) (CAPACITY - 1);
+
+			uint8_t data[CAPACITY];
+			volatile uint16_t head;		// Next slot to write; only stored by the producer
+			volatile uint16_t tail;		// Next slot to read; only stored by the consumer
+
+			static uint16_t load(volatile uint16_t* index){
+#if defined(__AVR__)
+				uint16_t value;
+				do {
+					value = *index;
+				} while (value != *index);
+				return value;
+#else
+				return *index;
+#endif
+			}
+
+			static void store(volatile uint16_t* index, uint16_t value){
+				RING_STREAM_BARRIER();	// Publish the data before the index which covers it
+#if defined(__AVR__)
+				uint8_t sreg = SREG;
+				cli();
+				*index = value;
+				SREG = sreg;
+#else
+				*index = value;
+#endif
+			}
+
+		public:
+			RingStream() : head(0), tail(0) {}
+
+			uint8_t read(uint8_t* b){
+				uint16_t t = tail;
+				if (load(&head) == t) return 0;
+				RING_STREAM_BARRIER();
+				*b = data[t];
+				store(&tail, (t + 1) & MASK);
+				return 1;
+			}
+
+			uint8_t write(uint8_t b){
+				uint16_t h = head;
+				uint16_t next = (h + 1) & MASK;
+				if (next == load(&tail)) return 0;
+				data[h] = b;
+				store(&head, next);
+				return 1;
+			}
+
+			// Bulk overrides; these copy at most two spans (before and after the wrap point)
+			uint16_t read(uint8_t* a, uint16_t len){
+				if (len == 0) return 0;
+				len--;	//Same contract as Stream::read; at most len - 1 bytes
+
+				uint16_t count = 0;
+				uint8_t* region;
+				uint16_t available;
+				while (count < len && (available = acquireRead(&region)) > 0){
+					if (available > len - count) available = len - count;
+					memcpy(a + count, region, available);
+					commitRead(available);
+					count += available;
+				}
+				return count;
+			}
+
+			uint16_t write(uint8_t* a, uint16_t len){
+				uint16_t count = 0;
+				uint8_t* region;
+				uint16_t available;
+				while (count < len && (available = acquireWrite(&region)) > 0){
+					if (available > len - count) available = len - count;
+					memcpy(region, a + count, available);
+					commitWrite(available);
+					count += available;
+				}
+				return count;
+			}
+
+			uint8_t peek(uint8_t* b){
+				uint16_t t = tail;
+				if (load(&head) == t) return 0;
+				RING_STREAM_BARRIER();
+				*b = data[t];
+				return 1;
+			}
+
+			/*
+			 * Producer side zero copy access; see ArrayStream::acquireWrite().
+			 */
+			uint16_t acquireWrite(uint8_t** region){
+				uint16_t h = head;
+				uint16_t t = load(&tail);
+				*region = data + h;
+				if (h >= t){
+					//Free space runs to the end of the array, less one slot if the tail is at the start
+					return (uint16_t) (CAPACITY - h - (t == 0 ? 1 : 0));
+				}
+				return t - h - 1;
+			}
+			void commitWrite(uint16_t n){
+				store(&head, (head + n) & MASK);
+			}
+
+			/*
+			 * Consumer side zero copy access; see ArrayStream::acquireRead().
+			 */
+			uint16_t acquireRead(uint8_t** region){
+				uint16_t t = tail;
+				uint16_t h = load(&head);
+				RING_STREAM_BARRIER();
+				*region = data + t;
+				return (h >= t) ? h - t : (uint16_t) (CAPACITY - t);
+			}
+			void commitRead(uint16_t n){
+				store(&tail, (tail + n) & MASK);
+			}
+
+			void clear(){
+				store(&tail, 0);
+				store(&head, 0);
+			}
+
+			uint16_t size(){
+				return (load(&head) - load(&tail)) & MASK;
+			}
+			uint16_t remaining(){
+				return MASK - size();
+			}
+			uint16_t capacity(){
+				return MASK;
+			}
+
+			uint8_t isEmpty(){
+				return load(&head) == load(&tail);
+			}
+			uint8_t isFull(){
+				return ((load(&head) + 1) & MASK) == load(&tail);
+			}
+
+			// Allow other overloaded functions from superclass to show up in subclass.
+			using Stream::skip;
+
+			using Stream::read;
+			using Stream::write;
+			using Stream::reset;
+	};
+}
+
+#endif
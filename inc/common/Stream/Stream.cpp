@@ -6,6 +6,10 @@ uint8_t Stream::reset() {
 	return 0;
 }
 
+uint16_t Stream::writable(){
+	return 0xFFFF;
+}
+
 uint16_t Stream::read(uint8_t* a, uint16_t len){
 	uint16_t count = 0;
 	uint8_t data = 0;
@@ -30,7 +34,7 @@ uint8_t Stream::write(char *data){
 }
 
 uint16_t Stream::write(uint8_t *data, uint16_t len){
-	for (uint8_t i = 0; i < len; i++){
+	for (uint16_t i = 0; i < len; i++){
 		if (!write(data[i])) return i;
 	}
 	return len;
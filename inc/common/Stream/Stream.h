@@ -26,8 +26,10 @@ namespace digitalcave {
 			 * which were read.  Implementations MUST NOT block until the entire buffer is filled.
 			 * The character after the last read character will be null terminated (which is why
 			 * the most you can read is length - 1).
+			 * The default implementation calls read(uint8_t*) once per byte; sub-classes which
+			 * can copy a whole span at once (ring buffers, block devices, DMA) should override it.
 			 */
-			uint16_t read(uint8_t* a, uint16_t len);
+			virtual uint16_t read(uint8_t* a, uint16_t len);
 
 			/*
 			 * Writes a null terminated string to the stream.  Uses write(char) to actually send
@@ -38,11 +40,19 @@ namespace digitalcave {
 			uint8_t write(const char* data);
 
 			/*
-			 * Writes a byte array to the stream.  Uses write(uint8_t) to actually send bytes
-			 * to the stream.
+			 * Writes a byte array to the stream.  The default implementation uses write(uint8_t)
+			 * to actually send bytes to the stream; sub-classes which can send a whole span at
+			 * once should override it.
 			 * Returns the number of bytes which were written successfully.
 			 */
-			uint16_t write(uint8_t* data, uint16_t len);
+			virtual uint16_t write(uint8_t* data, uint16_t len);
+
+			/*
+			 * Returns the number of bytes which can be written right now without blocking, so that a
+			 * caller which must not wait (e.g. a control loop sending telemetry) can drop a message
+			 * instead.  The default returns 0xFFFF, for streams whose writes never wait.
+			 */
+			virtual uint16_t writable();
 
 			/*
 			 * Skip over n bytes in the stream.
@@ -1,10 +1,19 @@
 #ifndef DC_TYPES
 #define DC_TYPES
 
+#include <stdint.h>
+
 typedef struct vector {
 	float x;
 	float y;
 	float z;
 } vector_t;
 
+//One accelerometer (g) and gyroscope (rad / s) sample, as read in bulk from a sensor's FIFO.  Time is in ms.
+typedef struct imu_frame {
+	vector_t accel;
+	vector_t gyro;
+	uint32_t time;
+} imu_frame_t;
+
 #endif
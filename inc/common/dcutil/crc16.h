@@ -0,0 +1,50 @@
+#ifndef DCUTIL_CRC16
+#define DCUTIL_CRC16
+
+#include <stdint.h>
+
+/*
+ * CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF, not reflected, no final XOR; also known as
+ * CRC-16/CCITT-FALSE).  The CRC of "123456789" is 0x29B1.  Appending the CRC to the data, high byte
+ * first, and running the CRC over the whole thing gives 0.
+ *
+ * Two implementations are provided: one with a 256 entry table (512 bytes, one lookup per byte) and
+ * one with a 16 entry table (32 bytes, two lookups per byte).  crc16_update() uses the nibble table on
+ * AVR, where flash is tight, and the full table everywhere else; define CRC16_NIBBLE or CRC16_TABLE
+ * to force one or the other.
+ */
+#define CRC16_INIT	0xFFFF
+
+#if !defined(CRC16_NIBBLE) && !defined(CRC16_TABLE)
+#if defined(__AVR__)
+#define CRC16_NIBBLE
+#else
+#define CRC16_TABLE
+#endif
+#endif
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+uint16_t crc16_update_table(uint16_t crc, uint8_t b);
+
+uint16_t crc16_update_nibble(uint16_t crc, uint8_t b);
+
+//Adds one byte to the running CRC, using the implementation selected above
+static inline uint16_t crc16_update(uint16_t crc, uint8_t b){
+#if defined(CRC16_NIBBLE)
+	return crc16_update_nibble(crc, b);
+#else
+	return crc16_update_table(crc, b);
+#endif
+}
+
+//Returns the CRC of the given data, starting from CRC16_INIT
+uint16_t crc16(uint8_t* data, uint16_t length);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
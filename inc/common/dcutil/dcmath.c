@@ -6,74 +6,237 @@
 int __errno;
 
 //In this library, we pass in / pass out angles in radians.  Internally, we use a custom measurement which maps
-// 90 degrees (PI / 2 radians) into 256 segments (hereafter this unit is called a 'segment', or 'seg').
+// 90 degrees (PI / 2 radians) into 256 segments (hereafter this unit is called a 'segment', or 'seg').  The
+// fixed point functions take angles as a uint16_t fraction of a turn, which is a segment with 6 fraction bits.
+//
+//Each table holds 257 points (the last one being the end of the range), and values in between are linearly
+// interpolated.  The trig functions all share one quarter of a sine wave; asin / acos use a table over [0, 0.5],
+// where it is nearly straight, and get the rest from the half angle identity, and atan2 uses a table over [0, 1]
+// for the first octant.  On AVR the tables are in program memory.
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define DCMATH_PROGMEM					PROGMEM
+#define dcmath_read_float(address)		pgm_read_float_near(address)
+#define dcmath_read_word(address)		((int16_t) pgm_read_word_near(address))
+#else
+#define DCMATH_PROGMEM
+#define dcmath_read_float(address)		(*(address))
+#define dcmath_read_word(address)		(*(address))
+#endif
+
+#define DCMATH_PI						3.14159265f
+#define DCMATH_PI_2						1.57079633f
+#define DCMATH_SEGMENTS_PER_RADIAN		162.97466f		//512 / PI
+
+//Fixed point angles for PI / 2 and PI
+#define DCMATH_Q_PI_2					16384
+#define DCMATH_Q_PI						32768
 
 //Generated with:
-//    for (float i = -1; i <= 1; i+=0.01){ printf("%1.5ff, ", acos(i)); }
-// (add a 0 at the end)
-static float lookup_acos[201] = {
-	3.14159f, 3.00005f, 2.94126f, 2.89603f, 2.85780f, 2.82403f, 2.79343f, 2.76521f, 2.73888f, 2.71408f, 2.69057f, 2.66814f, 2.64666f, 2.62600f, 2.60607f, 2.58678f, 2.56808f, 2.54990f, 2.53221f, 2.51495f, 2.49809f, 2.48161f, 2.46546f, 2.44964f, 2.43411f, 2.41886f, 2.40387f, 2.38912f, 2.37460f, 2.36029f, 2.34619f, 2.33229f, 2.31856f, 2.30501f, 2.29162f, 2.27838f, 2.26529f, 2.25235f, 2.23954f, 2.22686f, 2.21430f, 2.20186f, 2.18953f, 2.17730f, 2.16518f, 2.15316f, 2.14123f, 2.12940f, 2.11765f, 2.10598f, 2.09440f, 2.08289f, 2.07145f, 2.06009f, 2.04879f, 2.03756f, 2.02640f, 2.01529f, 2.00424f, 1.99325f, 1.98231f, 1.97143f, 1.96059f, 1.94981f, 1.93906f, 1.92837f, 1.91771f, 1.90710f, 1.89653f, 1.88599f, 1.87549f, 1.86502f, 1.85459f, 1.84419f, 1.83382f, 1.82348f, 1.81316f, 1.80287f, 1.79261f, 1.78237f, 1.77215f, 1.76196f, 1.75178f, 1.74163f, 1.73149f, 1.72136f, 1.71126f, 1.70117f, 1.69109f, 1.68102f, 1.67096f, 1.66092f, 1.65088f, 1.64085f, 1.63083f, 1.62082f, 1.61081f, 1.60080f, 1.59080f, 1.58080f, 1.57080f, 1.56080f, 1.55079f, 1.54079f, 1.53079f, 1.52078f, 1.51076f, 1.50074f, 1.49071f, 1.48067f, 1.47063f, 1.46057f, 1.45051f, 1.44043f, 1.43033f, 1.42023f, 1.41011f, 1.39997f, 1.38981f, 1.37963f, 1.36944f, 1.35922f, 1.34898f, 1.33872f, 1.32843f, 1.31812f, 1.30777f, 1.29740f, 1.28700f, 1.27657f, 1.26610f, 1.25560f, 1.24507f, 1.23449f, 1.22388f, 1.21323f, 1.20253f, 1.19179f, 1.18100f, 1.17016f, 1.15928f, 1.14834f, 1.13735f, 1.12630f, 1.11520f, 1.10403f, 1.09280f, 1.08151f, 1.07014f, 1.05871f, 1.04720f, 1.03561f, 1.02395f, 1.01220f, 1.00036f, 0.98843f, 0.97641f, 0.96429f, 0.95207f, 0.93974f, 0.92730f, 0.91474f, 0.90205f, 0.88924f, 0.87630f, 0.86321f, 0.84998f, 0.83659f, 0.82303f, 0.80931f, 0.79540f, 0.78130f, 0.76699f, 0.75247f, 0.73773f, 0.72273f, 0.70748f, 0.69196f, 0.67613f, 0.65999f, 0.64350f, 0.62664f, 0.60939f, 0.59169f, 0.57351f, 0.55481f, 0.53553f, 0.51559f, 0.49493f, 0.47345f, 0.45103f, 0.42751f, 0.40272f, 0.37638f, 0.34817f, 0.31756f, 0.28379f, 0.24557f, 0.20033f, 0.14154f, 0.00000f
+//    for (uint16_t i = 0; i <= 256; i++){ printf("%1.8ff, ", sin(i * M_PI / 512)); }
+static const float lookup_sin[257] DCMATH_PROGMEM = {
+	0.00000000f, 0.00613588f, 0.01227154f, 0.01840673f, 0.02454123f, 0.03067480f, 0.03680722f, 0.04293826f, 0.04906767f, 0.05519524f, 0.06132074f, 0.06744392f, 0.07356456f, 0.07968244f, 0.08579731f, 0.09190896f, 0.09801714f, 0.10412163f, 0.11022221f, 0.11631863f, 0.12241068f, 0.12849811f, 0.13458071f, 0.14065824f, 0.14673047f, 0.15279719f, 0.15885814f, 0.16491312f, 0.17096189f, 0.17700422f, 0.18303989f, 0.18906866f, 0.19509032f, 0.20110463f, 0.20711138f, 0.21311032f, 0.21910124f, 0.22508391f, 0.23105811f, 0.23702361f, 0.24298018f, 0.24892761f, 0.25486566f, 0.26079412f, 0.26671276f, 0.27262136f, 0.27851969f, 0.28440754f, 0.29028468f, 0.29615089f, 0.30200595f, 0.30784964f, 0.31368174f, 0.31950203f, 0.32531029f, 0.33110631f, 0.33688985f, 0.34266072f, 0.34841868f, 0.35416353f, 0.35989504f, 0.36561300f, 0.37131719f, 0.37700741f, 0.38268343f, 0.38834505f, 0.39399204f, 0.39962420f, 0.40524131f, 0.41084317f, 0.41642956f, 0.42200027f, 0.42755509f, 0.43309382f, 0.43861624f, 0.44412214f, 0.44961133f, 0.45508359f, 0.46053871f, 0.46597650f, 0.47139674f, 0.47679923f, 0.48218377f, 0.48755016f, 0.49289819f, 0.49822767f, 0.50353838f, 0.50883014f, 0.51410274f, 0.51935599f, 0.52458968f, 0.52980362f, 0.53499762f, 0.54017147f, 0.54532499f, 0.55045797f, 0.55557023f, 0.56066158f, 0.56573181f, 0.57078075f, 0.57580819f, 0.58081396f, 0.58579786f, 0.59075970f, 0.59569930f, 0.60061648f, 0.60551104f, 0.61038281f, 0.61523159f, 0.62005721f, 0.62485949f, 0.62963824f, 0.63439328f, 0.63912444f, 0.64383154f, 0.64851440f, 0.65317284f, 0.65780669f, 0.66241578f, 0.66699992f, 0.67155895f, 0.67609270f, 0.68060100f, 0.68508367f, 0.68954054f, 0.69397146f, 0.69837625f, 0.70275474f, 0.70710678f, 0.71143220f, 0.71573083f, 0.72000251f, 0.72424708f, 0.72846439f, 0.73265427f, 0.73681657f, 0.74095113f, 0.74505779f, 0.74913639f, 0.75318680f, 0.75720885f, 0.76120239f, 0.76516727f, 0.76910334f, 0.77301045f, 0.77688847f, 0.78073723f, 0.78455660f, 0.78834643f, 0.79210658f, 0.79583690f, 0.79953727f, 0.80320753f, 0.80684755f, 0.81045720f, 0.81403633f, 0.81758481f, 0.82110251f, 0.82458930f, 0.82804505f, 0.83146961f, 0.83486287f, 0.83822471f, 0.84155498f, 0.84485357f, 0.84812034f, 0.85135519f, 0.85455799f, 0.85772861f, 0.86086694f, 0.86397286f, 0.86704625f, 0.87008699f, 0.87309498f, 0.87607009f, 0.87901223f, 0.88192126f, 0.88479710f, 0.88763962f, 0.89044872f, 0.89322430f, 0.89596625f, 0.89867447f, 0.90134885f, 0.90398929f, 0.90659570f, 0.90916798f, 0.91170603f, 0.91420976f, 0.91667906f, 0.91911385f, 0.92151404f, 0.92387953f, 0.92621024f, 0.92850608f, 0.93076696f, 0.93299280f, 0.93518351f, 0.93733901f, 0.93945922f, 0.94154407f, 0.94359346f, 0.94560733f, 0.94758559f, 0.94952818f, 0.95143502f, 0.95330604f, 0.95514117f, 0.95694034f, 0.95870347f, 0.96043052f, 0.96212140f, 0.96377607f, 0.96539444f, 0.96697647f, 0.96852209f, 0.97003125f, 0.97150389f, 0.97293995f, 0.97433938f, 0.97570213f, 0.97702814f, 0.97831737f, 0.97956977f, 0.98078528f, 0.98196387f, 0.98310549f, 0.98421009f, 0.98527764f, 0.98630810f, 0.98730142f, 0.98825757f, 0.98917651f, 0.99005821f, 0.99090264f, 0.99170975f, 0.99247953f, 0.99321195f, 0.99390697f, 0.99456457f, 0.99518473f, 0.99576741f, 0.99631261f, 0.99682030f, 0.99729046f, 0.99772307f, 0.99811811f, 0.99847558f, 0.99879546f, 0.99907773f, 0.99932238f, 0.99952942f, 0.99969882f, 0.99983058f, 0.99992470f, 0.99998118f, 1.00000000f
 };
 
 //Generated with:
-//    for (uint16_t i = 0; i <= 255; i++){ printf("%1.5ff, ", cos(i * M_PI / 512)); }
-// (add a 0 at the end)
-static float lookup_cos[257] = {
-	1.00000f, 0.99998f, 0.99992f, 0.99983f, 0.99970f, 0.99953f, 0.99932f, 0.99908f, 0.99880f, 0.99848f, 0.99812f, 0.99772f, 0.99729f, 0.99682f, 0.99631f, 0.99577f, 0.99518f, 0.99456f, 0.99391f, 0.99321f, 0.99248f, 0.99171f, 0.99090f, 0.99006f, 0.98918f, 0.98826f, 0.98730f, 0.98631f, 0.98528f, 0.98421f, 0.98311f, 0.98196f, 0.98079f, 0.97957f, 0.97832f, 0.97703f, 0.97570f, 0.97434f, 0.97294f, 0.97150f, 0.97003f, 0.96852f, 0.96698f, 0.96539f, 0.96378f, 0.96212f, 0.96043f, 0.95870f, 0.95694f, 0.95514f, 0.95331f, 0.95144f, 0.94953f, 0.94759f, 0.94561f, 0.94359f, 0.94154f, 0.93946f, 0.93734f, 0.93518f, 0.93299f, 0.93077f, 0.92851f, 0.92621f, 0.92388f, 0.92151f, 0.91911f, 0.91668f, 0.91421f, 0.91171f, 0.90917f, 0.90660f, 0.90399f, 0.90135f, 0.89867f, 0.89597f, 0.89322f, 0.89045f, 0.88764f, 0.88480f, 0.88192f, 0.87901f, 0.87607f, 0.87309f, 0.87009f, 0.86705f, 0.86397f, 0.86087f, 0.85773f, 0.85456f, 0.85136f, 0.84812f, 0.84485f, 0.84155f, 0.83822f, 0.83486f, 0.83147f, 0.82805f, 0.82459f, 0.82110f, 0.81758f, 0.81404f, 0.81046f, 0.80685f, 0.80321f, 0.79954f, 0.79584f, 0.79211f, 0.78835f, 0.78456f, 0.78074f, 0.77689f, 0.77301f, 0.76910f, 0.76517f, 0.76120f, 0.75721f, 0.75319f, 0.74914f, 0.74506f, 0.74095f, 0.73682f, 0.73265f, 0.72846f, 0.72425f, 0.72000f, 0.71573f, 0.71143f, 0.70711f, 0.70275f, 0.69838f, 0.69397f, 0.68954f, 0.68508f, 0.68060f, 0.67609f, 0.67156f, 0.66700f, 0.66242f, 0.65781f, 0.65317f, 0.64851f, 0.64383f, 0.63912f, 0.63439f, 0.62964f, 0.62486f, 0.62006f, 0.61523f, 0.61038f, 0.60551f, 0.60062f, 0.59570f, 0.59076f, 0.58580f, 0.58081f, 0.57581f, 0.57078f, 0.56573f, 0.56066f, 0.55557f, 0.55046f, 0.54532f, 0.54017f, 0.53500f, 0.52980f, 0.52459f, 0.51936f, 0.51410f, 0.50883f, 0.50354f, 0.49823f, 0.49290f, 0.48755f, 0.48218f, 0.47680f, 0.47140f, 0.46598f, 0.46054f, 0.45508f, 0.44961f, 0.44412f, 0.43862f, 0.43309f, 0.42756f, 0.42200f, 0.41643f, 0.41084f, 0.40524f, 0.39962f, 0.39399f, 0.38835f, 0.38268f, 0.37701f, 0.37132f, 0.36561f, 0.35990f, 0.35416f, 0.34842f, 0.34266f, 0.33689f, 0.33111f, 0.32531f, 0.31950f, 0.31368f, 0.30785f, 0.30201f, 0.29615f, 0.29028f, 0.28441f, 0.27852f, 0.27262f, 0.26671f, 0.26079f, 0.25487f, 0.24893f, 0.24298f, 0.23702f, 0.23106f, 0.22508f, 0.21910f, 0.21311f, 0.20711f, 0.20110f, 0.19509f, 0.18907f, 0.18304f, 0.17700f, 0.17096f, 0.16491f, 0.15886f, 0.15280f, 0.14673f, 0.14066f, 0.13458f, 0.12850f, 0.12241f, 0.11632f, 0.11022f, 0.10412f, 0.09802f, 0.09191f, 0.08580f, 0.07968f, 0.07356f, 0.06744f, 0.06132f, 0.05520f, 0.04907f, 0.04294f, 0.03681f, 0.03067f, 0.02454f, 0.01841f, 0.01227f, 0.00614f, 0.00000f
+//    for (uint16_t i = 0; i <= 256; i++){ printf("%1.8ff, ", asin(i / 512.0)); }
+static const float lookup_asin[257] DCMATH_PROGMEM = {
+	0.00000000f, 0.00195313f, 0.00390626f, 0.00585941f, 0.00781258f, 0.00976578f, 0.01171902f, 0.01367230f, 0.01562564f, 0.01757903f, 0.01953249f, 0.02148603f, 0.02343965f, 0.02539335f, 0.02734716f, 0.02930107f, 0.03125509f, 0.03320923f, 0.03516350f, 0.03711790f, 0.03907244f, 0.04102713f, 0.04298198f, 0.04493700f, 0.04689218f, 0.04884755f, 0.05080310f, 0.05275885f, 0.05471480f, 0.05667095f, 0.05862733f, 0.06058393f, 0.06254076f, 0.06449783f, 0.06645515f, 0.06841273f, 0.07037056f, 0.07232867f, 0.07428706f, 0.07624573f, 0.07820469f, 0.08016396f, 0.08212353f, 0.08408342f, 0.08604363f, 0.08800418f, 0.08996506f, 0.09192629f, 0.09388788f, 0.09584982f, 0.09781214f, 0.09977484f, 0.10173792f, 0.10370139f, 0.10566527f, 0.10762955f, 0.10959426f, 0.11155938f, 0.11352494f, 0.11549094f, 0.11745739f, 0.11942430f, 0.12139167f, 0.12335951f, 0.12532783f, 0.12729664f, 0.12926595f, 0.13123576f, 0.13320608f, 0.13517693f, 0.13714830f, 0.13912021f, 0.14109266f, 0.14306567f, 0.14503923f, 0.14701337f, 0.14898808f, 0.15096338f, 0.15293927f, 0.15491577f, 0.15689287f, 0.15887059f, 0.16084894f, 0.16282793f, 0.16480756f, 0.16678784f, 0.16876878f, 0.17075039f, 0.17273268f, 0.17471565f, 0.17669932f, 0.17868369f, 0.18066877f, 0.18265457f, 0.18464110f, 0.18662837f, 0.18861639f, 0.19060515f, 0.19259469f, 0.19458499f, 0.19657608f, 0.19856795f, 0.20056063f, 0.20255411f, 0.20454840f, 0.20654353f, 0.20853949f, 0.21053629f, 0.21253394f, 0.21453246f, 0.21653184f, 0.21853211f, 0.22053326f, 0.22253531f, 0.22453827f, 0.22654215f, 0.22854695f, 0.23055269f, 0.23255937f, 0.23456701f, 0.23657561f, 0.23858518f, 0.24059574f, 0.24260729f, 0.24461984f, 0.24663340f, 0.24864799f, 0.25066360f, 0.25268026f, 0.25469796f, 0.25671673f, 0.25873656f, 0.26075748f, 0.26277949f, 0.26480260f, 0.26682681f, 0.26885215f, 0.27087862f, 0.27290623f, 0.27493500f, 0.27696492f, 0.27899602f, 0.28102829f, 0.28306177f, 0.28509644f, 0.28713233f, 0.28916944f, 0.29120779f, 0.29324739f, 0.29528824f, 0.29733036f, 0.29937376f, 0.30141844f, 0.30346443f, 0.30551173f, 0.30756035f, 0.30961031f, 0.31166161f, 0.31371427f, 0.31576830f, 0.31782370f, 0.31988050f, 0.32193870f, 0.32399831f, 0.32605935f, 0.32812183f, 0.33018575f, 0.33225114f, 0.33431799f, 0.33638634f, 0.33845618f, 0.34052753f, 0.34260040f, 0.34467480f, 0.34675075f, 0.34882826f, 0.35090734f, 0.35298801f, 0.35507027f, 0.35715414f, 0.35923963f, 0.36132675f, 0.36341552f, 0.36550596f, 0.36759806f, 0.36969186f, 0.37178735f, 0.37388456f, 0.37598349f, 0.37808417f, 0.38018660f, 0.38229080f, 0.38439677f, 0.38650455f, 0.38861413f, 0.39072554f, 0.39283879f, 0.39495389f, 0.39707085f, 0.39918970f, 0.40131044f, 0.40343309f, 0.40555766f, 0.40768418f, 0.40981265f, 0.41194309f, 0.41407552f, 0.41620994f, 0.41834639f, 0.42048486f, 0.42262538f, 0.42476796f, 0.42691262f, 0.42905938f, 0.43120824f, 0.43335924f, 0.43551237f, 0.43766767f, 0.43982514f, 0.44198480f, 0.44414667f, 0.44631077f, 0.44847711f, 0.45064571f, 0.45281659f, 0.45498977f, 0.45716526f, 0.45934308f, 0.46152325f, 0.46370578f, 0.46589070f, 0.46807802f, 0.47026777f, 0.47245995f, 0.47465459f, 0.47685171f, 0.47905133f, 0.48125346f, 0.48345813f, 0.48566535f, 0.48787515f, 0.49008754f, 0.49230255f, 0.49452019f, 0.49674048f, 0.49896345f, 0.50118912f, 0.50341750f, 0.50564863f, 0.50788251f, 0.51011917f, 0.51235864f, 0.51460093f, 0.51684606f, 0.51909407f, 0.52134497f, 0.52359878f
 };
 
 //Generated with:
-//    for (uint16_t i = 0; i <= 255; i++){ printf("%1.5ff, ", sin(i * M_PI / 512)); }
-// (add a 1 at the end)
-static float lookup_sin[257] = {
-	0.00000f, 0.00614f, 0.01227f, 0.01841f, 0.02454f, 0.03067f, 0.03681f, 0.04294f, 0.04907f, 0.05520f, 0.06132f, 0.06744f, 0.07356f, 0.07968f, 0.08580f, 0.09191f, 0.09802f, 0.10412f, 0.11022f, 0.11632f, 0.12241f, 0.12850f, 0.13458f, 0.14066f, 0.14673f, 0.15280f, 0.15886f, 0.16491f, 0.17096f, 0.17700f, 0.18304f, 0.18907f, 0.19509f, 0.20110f, 0.20711f, 0.21311f, 0.21910f, 0.22508f, 0.23106f, 0.23702f, 0.24298f, 0.24893f, 0.25487f, 0.26079f, 0.26671f, 0.27262f, 0.27852f, 0.28441f, 0.29028f, 0.29615f, 0.30201f, 0.30785f, 0.31368f, 0.31950f, 0.32531f, 0.33111f, 0.33689f, 0.34266f, 0.34842f, 0.35416f, 0.35990f, 0.36561f, 0.37132f, 0.37701f, 0.38268f, 0.38835f, 0.39399f, 0.39962f, 0.40524f, 0.41084f, 0.41643f, 0.42200f, 0.42756f, 0.43309f, 0.43862f, 0.44412f, 0.44961f, 0.45508f, 0.46054f, 0.46598f, 0.47140f, 0.47680f, 0.48218f, 0.48755f, 0.49290f, 0.49823f, 0.50354f, 0.50883f, 0.51410f, 0.51936f, 0.52459f, 0.52980f, 0.53500f, 0.54017f, 0.54532f, 0.55046f, 0.55557f, 0.56066f, 0.56573f, 0.57078f, 0.57581f, 0.58081f, 0.58580f, 0.59076f, 0.59570f, 0.60062f, 0.60551f, 0.61038f, 0.61523f, 0.62006f, 0.62486f, 0.62964f, 0.63439f, 0.63912f, 0.64383f, 0.64851f, 0.65317f, 0.65781f, 0.66242f, 0.66700f, 0.67156f, 0.67609f, 0.68060f, 0.68508f, 0.68954f, 0.69397f, 0.69838f, 0.70275f, 0.70711f, 0.71143f, 0.71573f, 0.72000f, 0.72425f, 0.72846f, 0.73265f, 0.73682f, 0.74095f, 0.74506f, 0.74914f, 0.75319f, 0.75721f, 0.76120f, 0.76517f, 0.76910f, 0.77301f, 0.77689f, 0.78074f, 0.78456f, 0.78835f, 0.79211f, 0.79584f, 0.79954f, 0.80321f, 0.80685f, 0.81046f, 0.81404f, 0.81758f, 0.82110f, 0.82459f, 0.82805f, 0.83147f, 0.83486f, 0.83822f, 0.84155f, 0.84485f, 0.84812f, 0.85136f, 0.85456f, 0.85773f, 0.86087f, 0.86397f, 0.86705f, 0.87009f, 0.87309f, 0.87607f, 0.87901f, 0.88192f, 0.88480f, 0.88764f, 0.89045f, 0.89322f, 0.89597f, 0.89867f, 0.90135f, 0.90399f, 0.90660f, 0.90917f, 0.91171f, 0.91421f, 0.91668f, 0.91911f, 0.92151f, 0.92388f, 0.92621f, 0.92851f, 0.93077f, 0.93299f, 0.93518f, 0.93734f, 0.93946f, 0.94154f, 0.94359f, 0.94561f, 0.94759f, 0.94953f, 0.95144f, 0.95331f, 0.95514f, 0.95694f, 0.95870f, 0.96043f, 0.96212f, 0.96378f, 0.96539f, 0.96698f, 0.96852f, 0.97003f, 0.97150f, 0.97294f, 0.97434f, 0.97570f, 0.97703f, 0.97832f, 0.97957f, 0.98079f, 0.98196f, 0.98311f, 0.98421f, 0.98528f, 0.98631f, 0.98730f, 0.98826f, 0.98918f, 0.99006f, 0.99090f, 0.99171f, 0.99248f, 0.99321f, 0.99391f, 0.99456f, 0.99518f, 0.99577f, 0.99631f, 0.99682f, 0.99729f, 0.99772f, 0.99812f, 0.99848f, 0.99880f, 0.99908f, 0.99932f, 0.99953f, 0.99970f, 0.99983f, 0.99992f, 0.99998f, 1.00000f
+//    for (uint16_t i = 0; i <= 256; i++){ printf("%1.8ff, ", atan(i / 256.0)); }
+static const float lookup_atan[257] DCMATH_PROGMEM = {
+	0.00000000f, 0.00390623f, 0.00781234f, 0.01171821f, 0.01562373f, 0.01952877f, 0.02343321f, 0.02733694f, 0.03123983f, 0.03514178f, 0.03904265f, 0.04294233f, 0.04684071f, 0.05073767f, 0.05463308f, 0.05852683f, 0.06241881f, 0.06630889f, 0.07019697f, 0.07408292f, 0.07796663f, 0.08184799f, 0.08572688f, 0.08960318f, 0.09347678f, 0.09734757f, 0.10121544f, 0.10508027f, 0.10894196f, 0.11280038f, 0.11665544f, 0.12050701f, 0.12435499f, 0.12819928f, 0.13203976f, 0.13587633f, 0.13970887f, 0.14353729f, 0.14736148f, 0.15118133f, 0.15499674f, 0.15880761f, 0.16261383f, 0.16641530f, 0.17021193f, 0.17400360f, 0.17779023f, 0.18157171f, 0.18534795f, 0.18911885f, 0.19288431f, 0.19664425f, 0.20039855f, 0.20414715f, 0.20788993f, 0.21162681f, 0.21535770f, 0.21908251f, 0.22280115f, 0.22651354f, 0.23021959f, 0.23391921f, 0.23761231f, 0.24129883f, 0.24497866f, 0.24865174f, 0.25231798f, 0.25597730f, 0.25962963f, 0.26327488f, 0.26691299f, 0.27054387f, 0.27416745f, 0.27778366f, 0.28139243f, 0.28499369f, 0.28858736f, 0.29217338f, 0.29575169f, 0.29932220f, 0.30288487f, 0.30643962f, 0.30998639f, 0.31352512f, 0.31705575f, 0.32057822f, 0.32409247f, 0.32759844f, 0.33109608f, 0.33458532f, 0.33806612f, 0.34153843f, 0.34500218f, 0.34845733f, 0.35190383f, 0.35534162f, 0.35877067f, 0.36219092f, 0.36560233f, 0.36900485f, 0.37239845f, 0.37578307f, 0.37915867f, 0.38252522f, 0.38588267f, 0.38923099f, 0.39257014f, 0.39590007f, 0.39922077f, 0.40253219f, 0.40583429f, 0.40912706f, 0.41241044f, 0.41568442f, 0.41894897f, 0.42220405f, 0.42544964f, 0.42868571f, 0.43191224f, 0.43512919f, 0.43833656f, 0.44153431f, 0.44472242f, 0.44790088f, 0.45106966f, 0.45422874f, 0.45737810f, 0.46051773f, 0.46364761f, 0.46676772f, 0.46987806f, 0.47297860f, 0.47606933f, 0.47915024f, 0.48222132f, 0.48528256f, 0.48833395f, 0.49137548f, 0.49440714f, 0.49742892f, 0.50044081f, 0.50344282f, 0.50643493f, 0.50941715f, 0.51238946f, 0.51535187f, 0.51830436f, 0.52124695f, 0.52417963f, 0.52710240f, 0.53001525f, 0.53291820f, 0.53581124f, 0.53869437f, 0.54156761f, 0.54443094f, 0.54728438f, 0.55012793f, 0.55296160f, 0.55578539f, 0.55859932f, 0.56140337f, 0.56419758f, 0.56698193f, 0.56975645f, 0.57252114f, 0.57527602f, 0.57802108f, 0.58075635f, 0.58348184f, 0.58619755f, 0.58890350f, 0.59159971f, 0.59428618f, 0.59696294f, 0.59962999f, 0.60228735f, 0.60493503f, 0.60757306f, 0.61020144f, 0.61282020f, 0.61542935f, 0.61802891f, 0.62061890f, 0.62319933f, 0.62577022f, 0.62833160f, 0.63088348f, 0.63342588f, 0.63595883f, 0.63848233f, 0.64099642f, 0.64350111f, 0.64599642f, 0.64848239f, 0.65095902f, 0.65342634f, 0.65588438f, 0.65833315f, 0.66077268f, 0.66320299f, 0.66562411f, 0.66803606f, 0.67043887f, 0.67283255f, 0.67521713f, 0.67759265f, 0.67995911f, 0.68231655f, 0.68466500f, 0.68700448f, 0.68933501f, 0.69165662f, 0.69396934f, 0.69627319f, 0.69856821f, 0.70085441f, 0.70313182f, 0.70540048f, 0.70766040f, 0.70991162f, 0.71215416f, 0.71438805f, 0.71661332f, 0.71883000f, 0.72103811f, 0.72323768f, 0.72542875f, 0.72761133f, 0.72978546f, 0.73195117f, 0.73410848f, 0.73625743f, 0.73839804f, 0.74053034f, 0.74265436f, 0.74477013f, 0.74687767f, 0.74897703f, 0.75106822f, 0.75315128f, 0.75522624f, 0.75729312f, 0.75935195f, 0.76140277f, 0.76344560f, 0.76548048f, 0.76750743f, 0.76952648f, 0.77153766f, 0.77354101f, 0.77553655f, 0.77752431f, 0.77950432f, 0.78147661f, 0.78344122f, 0.78539816f
+};
+
+//As lookup_sin, in Q14.  Generated with:
+//    for (uint16_t i = 0; i <= 256; i++){ printf("%d, ", (int16_t) lround(sin(i * M_PI / 512) * 16384)); }
+static const int16_t lookup_sin_q[257] DCMATH_PROGMEM = {
+	0, 101, 201, 302, 402, 503, 603, 704, 804, 904, 1005, 1105, 1205, 1306, 1406, 1506, 1606, 1706, 1806, 1906, 2006, 2105, 2205, 2305, 2404, 2503, 2603, 2702, 2801, 2900, 2999, 3098, 3196, 3295, 3393, 3492, 3590, 3688, 3786, 3883, 3981, 4078, 4176, 4273, 4370, 4467, 4563, 4660, 4756, 4852, 4948, 5044, 5139, 5235, 5330, 5425, 5520, 5614, 5708, 5803, 5897, 5990, 6084, 6177, 6270, 6363, 6455, 6547, 6639, 6731, 6823, 6914, 7005, 7096, 7186, 7276, 7366, 7456, 7545, 7635, 7723, 7812, 7900, 7988, 8076, 8163, 8250, 8337, 8423, 8509, 8595, 8680, 8765, 8850, 8935, 9019, 9102, 9186, 9269, 9352, 9434, 9516, 9598, 9679, 9760, 9841, 9921, 10001, 10080, 10159, 10238, 10316, 10394, 10471, 10549, 10625, 10702, 10778, 10853, 10928, 11003, 11077, 11151, 11224, 11297, 11370, 11442, 11514, 11585, 11656, 11727, 11797, 11866, 11935, 12004, 12072, 12140, 12207, 12274, 12340, 12406, 12472, 12537, 12601, 12665, 12729, 12792, 12854, 12916, 12978, 13039, 13100, 13160, 13219, 13279, 13337, 13395, 13453, 13510, 13567, 13623, 13678, 13733, 13788, 13842, 13896, 13949, 14001, 14053, 14104, 14155, 14206, 14256, 14305, 14354, 14402, 14449, 14497, 14543, 14589, 14635, 14680, 14724, 14768, 14811, 14854, 14896, 14937, 14978, 15019, 15059, 15098, 15137, 15175, 15213, 15250, 15286, 15322, 15357, 15392, 15426, 15460, 15493, 15525, 15557, 15588, 15619, 15649, 15679, 15707, 15736, 15763, 15791, 15817, 15843, 15868, 15893, 15917, 15941, 15964, 15986, 16008, 16029, 16049, 16069, 16088, 16107, 16125, 16143, 16160, 16176, 16192, 16207, 16221, 16235, 16248, 16261, 16273, 16284, 16295, 16305, 16315, 16324, 16332, 16340, 16347, 16353, 16359, 16364, 16369, 16373, 16376, 16379, 16381, 16383, 16384, 16384
+};
+
+//As lookup_asin, in halves of fixed point angles (for the extra bit, which the half angle identity doubles).
+// Generated with:
+//    for (uint16_t i = 0; i <= 256; i++){ printf("%d, ", (int16_t) lround(asin(i / 512.0) * 65536 / M_PI)); }
+static const int16_t lookup_asin_q[257] DCMATH_PROGMEM = {
+	0, 41, 81, 122, 163, 204, 244, 285, 326, 367, 407, 448, 489, 530, 570, 611, 652, 693, 734, 774, 815, 856, 897, 937, 978, 1019, 1060, 1101, 1141, 1182, 1223, 1264, 1305, 1345, 1386, 1427, 1468, 1509, 1550, 1591, 1631, 1672, 1713, 1754, 1795, 1836, 1877, 1918, 1959, 1999, 2040, 2081, 2122, 2163, 2204, 2245, 2286, 2327, 2368, 2409, 2450, 2491, 2532, 2573, 2614, 2656, 2697, 2738, 2779, 2820, 2861, 2902, 2943, 2984, 3026, 3067, 3108, 3149, 3190, 3232, 3273, 3314, 3355, 3397, 3438, 3479, 3521, 3562, 3603, 3645, 3686, 3727, 3769, 3810, 3852, 3893, 3935, 3976, 4018, 4059, 4101, 4142, 4184, 4225, 4267, 4309, 4350, 4392, 4434, 4475, 4517, 4559, 4600, 4642, 4684, 4726, 4768, 4810, 4851, 4893, 4935, 4977, 5019, 5061, 5103, 5145, 5187, 5229, 5271, 5313, 5355, 5397, 5440, 5482, 5524, 5566, 5608, 5651, 5693, 5735, 5778, 5820, 5862, 5905, 5947, 5990, 6032, 6075, 6117, 6160, 6203, 6245, 6288, 6330, 6373, 6416, 6459, 6501, 6544, 6587, 6630, 6673, 6716, 6759, 6802, 6845, 6888, 6931, 6974, 7017, 7060, 7104, 7147, 7190, 7233, 7277, 7320, 7364, 7407, 7451, 7494, 7538, 7581, 7625, 7668, 7712, 7756, 7800, 7843, 7887, 7931, 7975, 8019, 8063, 8107, 8151, 8195, 8239, 8283, 8327, 8372, 8416, 8460, 8505, 8549, 8593, 8638, 8682, 8727, 8772, 8816, 8861, 8906, 8951, 8995, 9040, 9085, 9130, 9175, 9220, 9265, 9310, 9356, 9401, 9446, 9491, 9537, 9582, 9628, 9673, 9719, 9764, 9810, 9856, 9902, 9947, 9993, 10039, 10085, 10131, 10177, 10224, 10270, 10316, 10362, 10409, 10455, 10502, 10548, 10595, 10641, 10688, 10735, 10782, 10829, 10876, 10923
 };
 
-uint8_t constrain_angle(int16_t angle, uint8_t *quadrant){
-	//Get the angle into 0..1024 segments (0..360 degrees)
-	while (angle < 0){
-		angle += 1024;
+//As lookup_atan, in fixed point angles.  Generated with:
+//    for (uint16_t i = 0; i <= 256; i++){ printf("%d, ", (int16_t) lround(atan(i / 256.0) * 32768 / M_PI)); }
+static const int16_t lookup_atan_q[257] DCMATH_PROGMEM = {
+	0, 41, 81, 122, 163, 204, 244, 285, 326, 367, 407, 448, 489, 529, 570, 610, 651, 692, 732, 773, 813, 854, 894, 935, 975, 1015, 1056, 1096, 1136, 1177, 1217, 1257, 1297, 1337, 1377, 1417, 1457, 1497, 1537, 1577, 1617, 1656, 1696, 1736, 1775, 1815, 1854, 1894, 1933, 1973, 2012, 2051, 2090, 2129, 2168, 2207, 2246, 2285, 2324, 2363, 2401, 2440, 2478, 2517, 2555, 2594, 2632, 2670, 2708, 2746, 2784, 2822, 2860, 2897, 2935, 2973, 3010, 3047, 3085, 3122, 3159, 3196, 3233, 3270, 3307, 3344, 3380, 3417, 3453, 3490, 3526, 3562, 3599, 3635, 3670, 3706, 3742, 3778, 3813, 3849, 3884, 3920, 3955, 3990, 4025, 4060, 4095, 4129, 4164, 4199, 4233, 4267, 4302, 4336, 4370, 4404, 4438, 4471, 4505, 4539, 4572, 4605, 4639, 4672, 4705, 4738, 4771, 4803, 4836, 4869, 4901, 4933, 4966, 4998, 5030, 5062, 5094, 5125, 5157, 5188, 5220, 5251, 5282, 5313, 5344, 5375, 5406, 5437, 5467, 5498, 5528, 5559, 5589, 5619, 5649, 5679, 5708, 5738, 5768, 5797, 5826, 5856, 5885, 5914, 5943, 5972, 6000, 6029, 6058, 6086, 6114, 6142, 6171, 6199, 6227, 6254, 6282, 6310, 6337, 6365, 6392, 6419, 6446, 6473, 6500, 6527, 6554, 6580, 6607, 6633, 6660, 6686, 6712, 6738, 6764, 6790, 6815, 6841, 6867, 6892, 6917, 6943, 6968, 6993, 7018, 7043, 7068, 7092, 7117, 7141, 7166, 7190, 7214, 7238, 7262, 7286, 7310, 7334, 7358, 7381, 7405, 7428, 7451, 7475, 7498, 7521, 7544, 7566, 7589, 7612, 7635, 7657, 7679, 7702, 7724, 7746, 7768, 7790, 7812, 7834, 7856, 7877, 7899, 7920, 7942, 7963, 7984, 8005, 8026, 8047, 8068, 8089, 8110, 8131, 8151, 8172, 8192
+};
+
+//Interpolates table at position (0 to 256)
+static inline float lerp_f(const float* table, float position){
+	uint16_t i = (uint16_t) position;
+	if (i > 255) i = 255;
+	float a = dcmath_read_float(&table[i]);
+	return a + (dcmath_read_float(&table[i + 1]) - a) * (position - i);
+}
+
+//Interpolates table at position (0 to 256 << 6, i.e. with 6 fraction bits)
+static inline int16_t lerp_q(const int16_t* table, uint16_t position){
+	uint16_t i = position >> 6;
+	int16_t fraction = position & 0x3F;
+	if (i > 255){
+		i = 255;
+		fraction = 0x40;
 	}
-	while (angle >= 1024){
-		angle -= 1024;
+	int16_t a = dcmath_read_word(&table[i]);
+	return a + (((int32_t) (dcmath_read_word(&table[i + 1]) - a) * fraction + 0x20) >> 6);
+}
+
+//Sine of an angle in segments
+static inline float sin_segments(float angle){
+	int32_t whole = (int32_t) angle;
+	if (angle < whole) whole--;			//Round towards negative infinity
+	float fraction = angle - whole;
+	uint16_t segment = whole & 0x3FF;
+	uint8_t i = segment & 0xFF;
+
+	//Odd quadrants run backwards through the table
+	float result;
+	if (segment & 0x100) result = lerp_f(lookup_sin, 256 - i - fraction);
+	else result = lerp_f(lookup_sin, i + fraction);
+	return segment & 0x200 ? -result : result;
+}
+
+static inline int16_t sin_q_inline(uint16_t angle){
+	uint16_t position = angle & 0x3FFF;
+	if (angle & 0x4000) position = 0x4000 - position;
+	int16_t result = lerp_q(lookup_sin_q, position);
+	return angle & 0x8000 ? -result : result;
+}
+
+static inline float asin_inline(float value){
+	if (value < -1 || value > 1) return NAN;
+	float a = value < 0 ? -value : value;
+	float result;
+	if (a <= 0.5f) result = lerp_f(lookup_asin, a * 512);
+	else result = DCMATH_PI_2 - 2 * lerp_f(lookup_asin, sqrtf((1 - a) / 2) * 512);	//asin(a) = PI / 2 - 2 * asin(sqrt((1 - a) / 2))
+	return value < 0 ? -result : result;
+}
+
+static inline float atan2_inline(float y, float x){
+	float ax = x < 0 ? -x : x;
+	float ay = y < 0 ? -y : y;
+	if (ax == 0 && ay == 0) return 0;
+
+	float result;
+	if (ay <= ax) result = lerp_f(lookup_atan, ay / ax * 256);
+	else result = DCMATH_PI_2 - lerp_f(lookup_atan, ax / ay * 256);
+	if (x < 0) result = DCMATH_PI - result;
+	return y < 0 ? -result : result;
+}
+
+uint16_t sqrt_q(uint32_t value){
+	uint32_t result = 0;
+	uint32_t bit = (uint32_t) 1 << 30;
+	while (bit > value) bit >>= 2;
+	while (bit){
+		if (value >= result + bit){
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else {
+			result >>= 1;
+		}
+		bit >>= 2;
 	}
+	return result;
+}
+
+float acos_f(float value){
+	return DCMATH_PI_2 - asin_inline(value);
+}
+
+float asin_f(float value){
+	return asin_inline(value);
+}
+
+float cos_f(float angle){
+	return sin_segments(angle * DCMATH_SEGMENTS_PER_RADIAN + 256);
+}
+
+float sin_f(float angle){
+	return sin_segments(angle * DCMATH_SEGMENTS_PER_RADIAN);
+}
 
-	if (angle <= 255) {
-		*quadrant = 1;
+float atan2_f(float y, float x){
+	return atan2_inline(y, x);
+}
+
+void sin_f_batch(float* angles, float* results, uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		results[i] = sin_segments(angles[i] * DCMATH_SEGMENTS_PER_RADIAN);
 	}
-	else if (angle <= 512){
-		*quadrant = 2;
-		angle = 512 - angle;
+}
+
+void cos_f_batch(float* angles, float* results, uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		results[i] = sin_segments(angles[i] * DCMATH_SEGMENTS_PER_RADIAN + 256);
 	}
-	else if (angle <= 768){
-		*quadrant = 3;
-		angle = angle - 512;
+}
+
+void acos_f_batch(float* values, float* results, uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		results[i] = DCMATH_PI_2 - asin_inline(values[i]);
 	}
-	else {
-		*quadrant = 4;
-		angle = 1024 - angle;
+}
+
+void atan2_f_batch(float* y, float* x, float* results, uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		results[i] = atan2_inline(y[i], x[i]);
 	}
+}
 
-	return angle;
+int16_t sin_q(uint16_t angle){
+	return sin_q_inline(angle);
 }
 
-float acos_f(float value){
-	if (value < -1 || value > 1) return NAN;
-	return lookup_acos[(uint8_t) ((value * 100) + 100)];
+int16_t cos_q(uint16_t angle){
+	return sin_q_inline(angle + DCMATH_Q_PI_2);
 }
 
-float cos_f(float angle_r){
-	int16_t angle = angle_r * 512 / M_PI;
-	uint8_t quadrant = 0;
-	angle = constrain_angle(angle, &quadrant);
-	return lookup_cos[angle] * (quadrant == 2 || quadrant == 3 ? -1 : 1);
+int16_t asin_q(int16_t value){
+	int32_t a = value < 0 ? -(int32_t) value : value;
+	int16_t result;
+	if (a >= DCMATH_Q_ONE) result = DCMATH_Q_PI_2;
+	else if (a <= DCMATH_Q_ONE / 2) result = (lerp_q(lookup_asin_q, a << 1) + 1) >> 1;
+	else result = DCMATH_Q_PI_2 - lerp_q(lookup_asin_q, (sqrt_q((uint32_t) (DCMATH_Q_ONE - a) << 17) + 1) >> 1);	//sqrt((1 - a) / 2) in Q16
+	return value < 0 ? -result : result;
 }
 
-float sin_f(float angle_r){
-	int16_t angle = angle_r * 512 / M_PI;
-	uint8_t quadrant = 0;
-	angle = constrain_angle(angle, &quadrant);
-	return lookup_sin[angle] * (quadrant >= 3 ? -1 : 1);
+uint16_t acos_q(int16_t value){
+	return DCMATH_Q_PI_2 - asin_q(value);
+}
+
+uint16_t atan2_q(int16_t y, int16_t x){
+	int32_t ax = x < 0 ? -(int32_t) x : x;
+	int32_t ay = y < 0 ? -(int32_t) y : y;
+	if (ax == 0 && ay == 0) return 0;
+
+	uint16_t result;
+	if (ay <= ax) result = lerp_q(lookup_atan_q, (ay << 14) / ax);
+	else result = DCMATH_Q_PI_2 - lerp_q(lookup_atan_q, (ax << 14) / ay);
+	if (x < 0) result = DCMATH_Q_PI - result;
+	return y < 0 ? -result : result;
+}
+
+void sin_q_batch(uint16_t* angles, int16_t* results, uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		results[i] = sin_q_inline(angles[i]);
+	}
+}
+
+void cos_q_batch(uint16_t* angles, int16_t* results, uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		results[i] = sin_q_inline(angles[i] + DCMATH_Q_PI_2);
+	}
 }
 
 uint16_t sqrt_f(uint16_t q){
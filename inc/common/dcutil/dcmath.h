@@ -6,30 +6,74 @@
 #define fabs(x) __builtin_fabs(x)
 #define degToRad(degrees) ((degrees) / 180.0 * M_PI)
 #define radToDeg(radians) ((radians) * (180.0 / M_PI))
+#define radToAngleQ(radians) ((uint16_t) (int32_t) ((radians) * (32768 / M_PI)))
+#define angleQToRad(angle) ((angle) * (M_PI / 32768))
+
+#define DCMATH_Q_ONE		16384
 
 #if defined (__cplusplus)
 extern "C" {
 #endif
 
 /*
- * Lookup-table based acos implementation.
- * Returns an angle (in degrees) given the input value.  If the value is
- * outside of the domain [-1, 1] then it returns 255 to indicate NaN.
+ * Lookup table based trig functions, with linear interpolation between 256 points per quadrant
+ * (or per range of the inverse functions); see the host test (main.test) for their errors against
+ * libm, and how long they take.  Angles are in radians.  The *_batch() functions do the same for
+ * count values at once, which saves the call overhead and keeps the table hot.
+ */
+
+/*
+ * Returns the angle whose cosine is the given value, between 0 and PI.  If the value is
+ * outside of the domain [-1, 1] then it returns NAN.
  */
 float acos_f(float value);
 
 /*
- * Lookup-table based cos implementation.
- * Returns the cosine value of the given angle (in degrees).
+ * Returns the angle whose sine is the given value, between -PI / 2 and PI / 2.  If the value
+ * is outside of the domain [-1, 1] then it returns NAN.
+ */
+float asin_f(float value);
+
+/*
+ * Returns the cosine value of the given angle.
  */
 float cos_f(float angle);
 
 /*
- * Lookup-table based sin implementation.
- * Returns the sine value of the given angle (in degrees).
+ * Returns the sine value of the given angle.
  */
 float sin_f(float angle);
 
+/*
+ * Returns the angle of the point (x, y) from the X axis, between -PI and PI; 0 for (0, 0).
+ */
+float atan2_f(float y, float x);
+
+void sin_f_batch(float* angles, float* results, uint16_t count);
+void cos_f_batch(float* angles, float* results, uint16_t count);
+void acos_f_batch(float* values, float* results, uint16_t count);
+void atan2_f_batch(float* y, float* x, float* results, uint16_t count);
+
+/*
+ * Fixed point versions, for where there is no FPU.  Angles are a uint16_t fraction of a turn
+ * (so 16384 is PI / 2, and they wrap around for free), or an int16_t for the signed results of
+ * asin_q; sines, cosines and the inputs to asin_q and acos_q are Q14 (DCMATH_Q_ONE is 1).  The
+ * inverse functions saturate outside of their domain.  Results are within about a count.
+ */
+int16_t sin_q(uint16_t angle);
+int16_t cos_q(uint16_t angle);
+int16_t asin_q(int16_t value);
+uint16_t acos_q(int16_t value);
+uint16_t atan2_q(int16_t y, int16_t x);
+
+/*
+ * Integer square root, rounded down.
+ */
+uint16_t sqrt_q(uint32_t value);
+
+void sin_q_batch(uint16_t* angles, int16_t* results, uint16_t count);
+void cos_q_batch(uint16_t* angles, int16_t* results, uint16_t count);
+
 /*
  * Fast square root function; from http://www.mikrocontroller.net/articles/AVR_Arithmetik#avr-gcc_Implementierung_.2816_Bit.29
  */
@@ -18,6 +18,22 @@ uint8_t persist_write(uint32_t address, uint8_t* data, uint16_t length);
  */
 uint8_t persist_read(uint32_t address, uint8_t* data, uint16_t length);
 
+/*
+ * Does a bounded amount of background housekeeping (e.g. compacting a log, or erasing flash
+ * ahead of time); call it regularly from the main loop.  Returns non-zero while there is more
+ * to do.  Implementations without housekeeping always return 0.
+ */
+uint8_t persist_poll();
+
+/*
+ * Return non-zero if the next persist_poll() would erase flash, or if persist_write() of
+ * length bytes at address might have to erase (and wait for the erase) before it can write.
+ * Erasing can stall the CPU for a long time; these let a caller put it off until that is
+ * acceptable.  Implementations which never erase always return 0.
+ */
+uint8_t persist_poll_erases();
+uint8_t persist_write_erases(uint32_t address, uint16_t length);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,6 +1,23 @@
 #ifndef FONT_H
 #define FONT_H
 
+#include <stdint.h>
+
+/*
+ * Font data (glyphs, widths and code pages) lives in program memory on AVR, and is ordinary
+ * const data everywhere else.  Declare it with FONT_PROGMEM, and read it with font_read_byte(),
+ * so that the same fonts and text code build on every platform.
+ */
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+// Workaround for http://gcc.gnu.org/bugzilla/show_bug.cgi?id=34734
+#define FONT_PROGMEM					__attribute__((section(".progmem.data")))
+#define font_read_byte(address)			pgm_read_byte_near(address)
+#else
+#define FONT_PROGMEM
+#define font_read_byte(address)			(*(const uint8_t*) (address))
+#endif
+
 #define FONT_FIXED_WIDTH		0
 #define FONT_VARIABLE_WIDTH		1
 
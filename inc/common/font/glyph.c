@@ -0,0 +1,130 @@
+#include "glyph.h"
+
+#include <stddef.h>
+
+//Combines a byte of the buffer with a byte of glyph bits; box has a bit set for every pixel inside the glyph
+static inline void glyph_apply(uint8_t* b, uint8_t bits, uint8_t box, uint8_t overlay){
+	switch (overlay){
+		case GLYPH_REPLACE: *b = (*b & ~box) | bits; break;
+		case GLYPH_NAND: *b &= ~bits; break;
+		case GLYPH_XOR: *b ^= bits; break;
+		default: *b |= bits; break;
+	}
+}
+
+//Floor of x / 8, for negative x too
+static inline int16_t glyph_div8(int16_t x){
+	return x >= 0 ? x >> 3 : -((7 - x) >> 3);
+}
+
+//Reads the rows of a glyph in order, a byte at a time
+typedef struct glyph_reader {
+	uint8_t* next;			//Next byte of the glyph
+	uint32_t bits;			//Bits read but not used yet, in the low `count` bits
+	uint8_t count;
+} glyph_reader_t;
+
+static inline void glyph_reader_init(glyph_reader_t* reader, uint8_t* glyph, uint8_t width, uint8_t height){
+	//Skip the padding at the front of the first byte
+	reader->next = glyph + 1;
+	reader->bits = font_read_byte(glyph);
+	reader->count = 8 - ((8 - (((uint16_t) width * height) & 0x07)) & 0x07);
+}
+
+//Returns the next row, left aligned (bit 15 is the leftmost pixel)
+static inline uint16_t glyph_reader_row(glyph_reader_t* reader, uint8_t width){
+	while (reader->count < width){
+		reader->bits = (reader->bits << 8) | font_read_byte(reader->next++);
+		reader->count += 8;
+	}
+	reader->count -= width;
+	return (reader->bits >> reader->count) << (16 - width);
+}
+
+uint8_t glyph_bytes(uint8_t width, uint8_t height){
+	return ((uint16_t) width * height + 7) >> 3;
+}
+
+uint8_t* glyph_find(font_t* font, char c){
+	uint8_t index = font_read_byte(font->codepage + (uint8_t) c);
+	if (index == 0xFF) return NULL;
+	return font->font_data + (uint16_t) index * glyph_bytes(font->width, font->height);
+}
+
+uint16_t glyph_row(uint8_t* glyph, uint8_t width, uint8_t height, uint8_t row){
+	uint8_t bytes = glyph_bytes(width, height);
+	uint16_t bit = (uint16_t) bytes * 8 - (uint16_t) width * height + (uint16_t) row * width;
+	uint8_t i = bit >> 3;
+
+	//The row is within the (up to) three bytes starting at i
+	uint32_t window = (uint32_t) font_read_byte(glyph + i) << 16;
+	if (i + 1 < bytes) window |= (uint16_t) font_read_byte(glyph + i + 1) << 8;
+	if (i + 2 < bytes) window |= font_read_byte(glyph + i + 2);
+
+	return ((window << (bit & 0x07)) >> 8) & (0xFFFF << (16 - width));
+}
+
+void glyph_blit_rows(uint8_t* buffer, uint16_t stride, uint16_t rows, int16_t x, int16_t y, uint8_t* glyph, uint8_t width, uint8_t height, uint8_t overlay){
+	int16_t first = glyph_div8(x);
+	uint8_t shift = x & 0x07;
+	uint32_t box = ((uint32_t) (0xFFFF << (16 - width)) & 0xFFFF) << (8 - shift);
+
+	//The glyph covers up to three bytes of each row, starting at first; find the ones which are in the buffer
+	uint8_t from = 0, to = 3;
+	while (from < to && (first + from < 0 || !(uint8_t) (box >> (16 - 8 * from)))) from++;
+	while (to > from && (first + to - 1 >= (int16_t) stride || !(uint8_t) (box >> (24 - 8 * to)))) to--;
+	if (from == to) return;
+
+	glyph_reader_t reader;
+	glyph_reader_init(&reader, glyph, width, height);
+	for (uint8_t r = 0; r < height; r++){
+		uint32_t bits = (uint32_t) glyph_reader_row(&reader, width) << (8 - shift);
+		int16_t iy = y + r;
+		if (iy < 0) continue;
+		if (iy >= (int16_t) rows) break;
+
+		uint8_t* line = buffer + (uint16_t) iy * stride + first;
+		for (uint8_t i = from; i < to; i++){
+			uint8_t s = 16 - 8 * i;
+			glyph_apply(line + i, bits >> s, box >> s, overlay);
+		}
+	}
+}
+
+void glyph_blit_columns(uint8_t* buffer, uint16_t columns, uint16_t pages, int16_t x, int16_t y, uint8_t* glyph, uint8_t width, uint8_t height, uint8_t overlay){
+	uint16_t rows[24];
+	glyph_reader_t reader;
+	glyph_reader_init(&reader, glyph, width, height);
+	for (uint8_t r = 0; r < height; r++){
+		rows[r] = glyph_reader_row(&reader, width);
+	}
+
+	int16_t first = glyph_div8(y);
+	uint8_t shift = y & 0x07;
+	uint32_t box = (((uint32_t) 1 << height) - 1) << shift;
+
+	//Pages of the buffer which the glyph covers
+	uint8_t from = 0, to = 4;
+	while (from < to && (first + from < 0 || !(uint8_t) (box >> (8 * from)))) from++;
+	while (to > from && (first + to - 1 >= (int16_t) pages || !(uint8_t) (box >> (8 * (to - 1))))) to--;
+	if (from == to) return;
+
+	for (uint8_t c = 0; c < width; c++){
+		int16_t ix = x + c;
+		if (ix < 0) continue;
+		if (ix >= (int16_t) columns) break;
+
+		//Turn the column on its side, top pixel in bit 0
+		uint16_t mask = 0x8000 >> c;
+		uint32_t bits = 0;
+		for (uint8_t r = height; r > 0; r--){
+			bits = (bits << 1) | ((rows[r - 1] & mask) != 0);
+		}
+		bits <<= shift;
+
+		uint8_t* column = buffer + ix;
+		for (uint8_t i = from; i < to; i++){
+			glyph_apply(column + (uint16_t) (first + i) * columns, bits >> (8 * i), box >> (8 * i), overlay);
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef GLYPH_H
+#define GLYPH_H
+
+#include <stdint.h>
+#include "font.h"
+
+/*
+ * Draws font glyphs straight into packed 1 bit frame buffers, a byte at a time instead of a pixel
+ * at a time.  Glyph data is read through font_read_byte(), so it can be in program memory on AVR.
+ *
+ * A glyph is width x height bits, read across from the top left to the top right, then down to
+ * the next row, and padded with 0 bits at the front of the first byte to a whole number of bytes
+ * (the format of all of the fonts here).  Glyphs can be up to 16 pixels wide and 24 pixels high.
+ *
+ * Two buffer layouts are supported:
+ *  - rows: each byte is 8 pixels across, most significant bit on the left; row y starts at
+ *    buffer + y * stride (LED matrix shift registers, memory LCDs).
+ *  - columns: each byte is 8 pixels down, least significant bit at the top; page p (rows 8p to
+ *    8p + 7) starts at buffer + p * columns (SSD1306, KS0108 and similar controllers).
+ * Pixels outside the buffer are clipped, so glyphs can hang off any edge.
+ */
+
+//Overlay modes; the same values as the DRAW_OVERLAY_ modes
+#define GLYPH_REPLACE			0		//Glyph box is cleared, then set bits drawn
+#define GLYPH_NAND				1		//Set bits are cleared
+#define GLYPH_OR				2		//Set bits are drawn
+#define GLYPH_XOR				3		//Set bits are inverted
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+//Returns the number of bytes in each glyph of the given size
+uint8_t glyph_bytes(uint8_t width, uint8_t height);
+
+//Returns the glyph for the given character in a font, or NULL if the code page does not include it
+uint8_t* glyph_find(font_t* font, char c);
+
+//Returns one row of a glyph, left aligned (bit 15 is the leftmost pixel)
+uint16_t glyph_row(uint8_t* glyph, uint8_t width, uint8_t height, uint8_t row);
+
+void glyph_blit_rows(uint8_t* buffer, uint16_t stride, uint16_t rows, int16_t x, int16_t y, uint8_t* glyph, uint8_t width, uint8_t height, uint8_t overlay);
+
+void glyph_blit_columns(uint8_t* buffer, uint16_t columns, uint16_t pages, int16_t x, int16_t y, uint8_t* glyph, uint8_t width, uint8_t height, uint8_t overlay);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -5,9 +5,16 @@ using namespace digitalcave;
 
 SerialHAL* SerialHAL::instances[SERIAL_HAL_MAX_INSTANCES] = {NULL};
 
-SerialHAL::SerialHAL(UART_HandleTypeDef* huart, uint8_t bufferSize):
+SerialHAL::SerialHAL(UART_HandleTypeDef* huart, uint8_t bufferSize, uint8_t mode):
 	rxBuffer(bufferSize),
-	huart(huart)
+	huart(huart),
+	mode(mode),
+	txBuffer(mode == SERIAL_HAL_MODE_DMA ? bufferSize : 1),
+	txLength(0),
+	dmaBuffer(NULL),
+	dmaSize(0),
+	dmaPosition(0),
+	rxOverruns(0)
 {
 	for (uint8_t i = 0; i < SERIAL_HAL_MAX_INSTANCES; i++){
 		if (instances[i] == NULL){
@@ -16,10 +23,54 @@ SerialHAL::SerialHAL(UART_HandleTypeDef* huart, uint8_t bufferSize):
 		}
 	}
 
-	HAL_UART_Receive_IT(huart, &incomingByte, 1);	//Start listening
+	if (mode == SERIAL_HAL_MODE_DMA){
+		dmaSize = bufferSize;
+		dmaBuffer = (uint8_t*) malloc(dmaSize);
+		__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+		HAL_UART_Receive_DMA(huart, dmaBuffer, dmaSize);	//Start listening; the DMA channel must be in circular mode
+	}
+	else {
+		HAL_UART_Receive_IT(huart, &incomingByte, 1);	//Start listening
+	}
+}
+
+SerialHAL::~SerialHAL(){
+	for (uint8_t i = 0; i < SERIAL_HAL_MAX_INSTANCES; i++){
+		if (instances[i] == this){
+			//Keep the array packed, since the callbacks stop at the first NULL
+			for (; i < SERIAL_HAL_MAX_INSTANCES - 1; i++){
+				instances[i] = instances[i + 1];
+			}
+			instances[SERIAL_HAL_MAX_INSTANCES - 1] = NULL;
+			break;
+		}
+	}
+	if (mode == SERIAL_HAL_MODE_DMA){
+		HAL_UART_DMAStop(huart);
+		free(dmaBuffer);
+	}
+}
+
+SerialHAL* SerialHAL::find(UART_HandleTypeDef* huart){
+	for (uint8_t i = 0; i < SERIAL_HAL_MAX_INSTANCES; i++){
+		if (instances[i] == NULL){
+			return NULL;
+		}
+		else if (instances[i]->getHandleTypeDef() == huart){
+			return instances[i];
+		}
+	}
+	return NULL;
 }
 
 uint8_t SerialHAL::read(uint8_t *c){
+	if (mode == SERIAL_HAL_MODE_DMA && rxBuffer.isEmpty()){
+		//Pick up anything which has arrived since the last half / full / idle interrupt
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		drain();
+		__set_PRIMASK(primask);
+	}
 	if (!rxBuffer.isEmpty()){
 		if (rxBuffer.read(c)){
 			return 1;
@@ -29,12 +80,102 @@ uint8_t SerialHAL::read(uint8_t *c){
 }
 
 uint8_t SerialHAL::write(uint8_t b){
+	if (mode == SERIAL_HAL_MODE_DMA){
+		while (!txBuffer.write(b)){
+			startTransmit();	//Queue is full; wait for the DMA to make room
+		}
+		startTransmit();
+		return 1;
+	}
+
 	HAL_UART_Transmit(huart, &b, 1, 1);
 	HAL_UART_Receive_IT(huart, &incomingByte, 1);	//Restart listening in case something bad happened...
 	return 1;
 }
 
+uint16_t SerialHAL::read(uint8_t* a, uint16_t len){
+	if (mode == SERIAL_HAL_MODE_DMA){
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		drain();
+		__set_PRIMASK(primask);
+	}
+	return rxBuffer.read(a, len);
+}
+
+uint16_t SerialHAL::write(uint8_t* data, uint16_t len){
+	if (len == 0) return 0;
+
+	if (mode == SERIAL_HAL_MODE_DMA){
+		uint16_t count = 0;
+		while (count < len){
+			count += txBuffer.write(data + count, len - count);
+			startTransmit();
+		}
+		return len;
+	}
+
+	//Allow roughly 1ms per byte, the same as the single byte write
+	if (HAL_UART_Transmit(huart, data, len, len) != HAL_OK) return 0;
+	HAL_UART_Receive_IT(huart, &incomingByte, 1);	//Restart listening in case something bad happened...
+	return len;
+}
+
+uint16_t SerialHAL::writable(){
+	if (mode != SERIAL_HAL_MODE_DMA) return 0;
+	return txBuffer.writable();
+}
+
+void SerialHAL::flush(){
+	if (mode != SERIAL_HAL_MODE_DMA) return;
+	while (txLength > 0 || !txBuffer.isEmpty()){
+		startTransmit();
+	}
+}
+
+void SerialHAL::drain(){
+	uint16_t position = dmaSize - __HAL_DMA_GET_COUNTER(huart->hdmarx);	//NDTR counts down from dmaSize
+	if (position == dmaSize) position = 0;
+	if (position == dmaPosition) return;
+
+	uint16_t count;
+	if (position > dmaPosition){
+		count = position - dmaPosition;
+		rxOverruns += count - rxBuffer.write(dmaBuffer + dmaPosition, count);
+	}
+	else {
+		//The DMA has wrapped around; copy the end of the buffer and then the start
+		count = dmaSize - dmaPosition;
+		rxOverruns += count - rxBuffer.write(dmaBuffer + dmaPosition, count);
+		rxOverruns += position - rxBuffer.write(dmaBuffer, position);
+	}
+	dmaPosition = position;
+}
+
+void SerialHAL::startTransmit(){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (txLength == 0){
+		uint8_t* region;
+		uint8_t length = txBuffer.acquireRead(&region);
+		if (length > 0 && HAL_UART_Transmit_DMA(huart, region, length) == HAL_OK){
+			txLength = length;
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+void SerialHAL::txComplete(){
+	txBuffer.commitRead(txLength);
+	txLength = 0;
+	startTransmit();
+}
+
 void SerialHAL::isr(){
+	if (mode == SERIAL_HAL_MODE_DMA){
+		drain();
+		return;
+	}
 	//HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_1);
 	rxBuffer.write(incomingByte);
 	HAL_UART_Receive_IT(huart, &incomingByte, 1);
@@ -67,30 +208,47 @@ void SerialHAL::error(){
 	//
 	// __HAL_UART_DISABLE_IT(huart, UART_IT_ERR);
 
+	if (mode == SERIAL_HAL_MODE_DMA){
+		//The HAL aborts the DMA on errors; restart it from the top of the buffer
+		drain();
+		dmaPosition = 0;
+		HAL_UART_Receive_DMA(huart, dmaBuffer, dmaSize);
+		if (txLength > 0 && huart->gState == HAL_UART_STATE_READY) txComplete();	//Transmit was aborted too; move on
+		return;
+	}
+
 	HAL_UART_Receive_IT(huart, &incomingByte, 1);
 }
 
 
 //Delegate rx events to the correct serial instance
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart){
-	for (uint8_t i = 0; i < SERIAL_HAL_MAX_INSTANCES; i++){
-		if (SerialHAL::instances[i] == NULL){
-			return;
-		}
-		else if (SerialHAL::instances[i]->getHandleTypeDef() == huart){
-			SerialHAL::instances[i]->isr();
-		}
-	}
+	SerialHAL* serial = SerialHAL::find(huart);
+	if (serial != NULL) serial->isr();
+}
+
+//Receive DMA is half way through the circular buffer (DMA mode only)
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart){
+	SerialHAL* serial = SerialHAL::find(huart);
+	if (serial != NULL) serial->isr();
+}
+
+//Transmit DMA has finished (DMA mode only)
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+	SerialHAL* serial = SerialHAL::find(huart);
+	if (serial != NULL) serial->txComplete();
 }
 
 //Delegate error events to the correct serial instance
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart){
-	for (uint8_t i = 0; i < SERIAL_HAL_MAX_INSTANCES; i++){
-		if (SerialHAL::instances[i] == NULL){
-			return;
-		}
-		else if (SerialHAL::instances[i]->getHandleTypeDef() == huart){
-			SerialHAL::instances[i]->error();
-		}
+	SerialHAL* serial = SerialHAL::find(huart);
+	if (serial != NULL) serial->error();
+}
+
+void SerialHAL_IdleIRQHandler(UART_HandleTypeDef* huart){
+	if (__HAL_UART_GET_FLAG(huart, UART_FLAG_IDLE)){
+		__HAL_UART_CLEAR_IDLEFLAG(huart);
+		SerialHAL* serial = SerialHAL::find(huart);
+		if (serial != NULL) serial->isr();
 	}
 }
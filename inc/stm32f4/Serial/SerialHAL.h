@@ -5,9 +5,22 @@
  * You need to enable the USART interrupt in CubeMX, under NVIC Settings for the USART.  Without this, Tx will
  * work but you will never receive anything.
  *
- * Note that this library currently uses blocking mode for writing, and non blocking (1 byte at a time) interrupt mode
- * for reading.  Some people have reported issues with reading one byte at a time when using a fast baud rate and with
- * a busy CPU; if this is encountered, we may need to look at DMA mode to a ring buffer or something.
+ * There are two modes, selected in the constructor:
+ *
+ * SERIAL_HAL_MODE_INTERRUPT (default) uses blocking mode for writing, and non blocking (1 byte at a time) interrupt
+ * mode for reading.  Some people have reported issues with reading one byte at a time when using a fast baud rate
+ * and with a busy CPU; if this is encountered, use DMA mode.
+ *
+ * SERIAL_HAL_MODE_DMA receives into a circular DMA buffer, which is drained into the read buffer on the DMA half
+ * transfer, transfer complete and UART idle line interrupts; one interrupt per half buffer (or burst) instead of one
+ * per byte.  Writes are queued and sent by DMA straight out of the write buffer, so write() only blocks if the queue
+ * is full.  For this mode you additionally need to:
+ *	1) Add DMA requests for both USART_RX (mode Circular) and USART_TX (mode Normal) in CubeMX, with their interrupts.
+ *	2) Call SerialHAL_IdleIRQHandler() from the USART IRQ handler, before HAL_UART_IRQHandler(), e.g. in stm32f4xx_it.c:
+ *		void USART6_IRQHandler(void) {
+ *			SerialHAL_IdleIRQHandler(&huart6);
+ *			HAL_UART_IRQHandler(&huart6);
+ *		}
  */
 
 #ifndef SERIAL_HAL_H
@@ -20,6 +33,9 @@
 
 #define SERIAL_HAL_MAX_INSTANCES			8
 
+#define SERIAL_HAL_MODE_INTERRUPT			0
+#define SERIAL_HAL_MODE_DMA					1
+
 namespace digitalcave {
 
 	class SerialHAL : public Stream {
@@ -27,13 +43,33 @@ namespace digitalcave {
 			ArrayStream rxBuffer;
 			uint8_t incomingByte;
 			UART_HandleTypeDef* huart;
+			uint8_t mode;
+
+			//DMA mode state
+			ArrayStream txBuffer;				// Queued outgoing bytes; DMA reads directly from here
+			volatile uint8_t txLength;			// Length of the DMA transfer in progress, 0 when idle
+			uint8_t* dmaBuffer;					// Circular DMA receive buffer
+			uint16_t dmaSize;
+			uint16_t dmaPosition;				// Next byte in dmaBuffer to be drained into rxBuffer
+			volatile uint32_t rxOverruns;		// Bytes dropped because rxBuffer was full
+
+			//Copy anything the DMA has received since the last call into rxBuffer
+			void drain();
+
+			//Start a DMA transfer of the next contiguous region of txBuffer, if one is not already running
+			void startTransmit();
 
 		public:
 			//Keep track of instantiated instances, to delegate isr() and error() calls
 			static SerialHAL* instances[SERIAL_HAL_MAX_INSTANCES];
 
-			//Initialize specifying baud rate and all other optional parameters
-			SerialHAL(UART_HandleTypeDef* huart, uint8_t bufferSize);
+			//Return the instance which owns the given UART, or NULL
+			static SerialHAL* find(UART_HandleTypeDef* huart);
+
+			//Initialize specifying baud rate and all other optional parameters.  In DMA mode, bufferSize is used for each of the
+			// circular DMA buffer, the read buffer and the write queue.
+			SerialHAL(UART_HandleTypeDef* huart, uint8_t bufferSize, uint8_t mode = SERIAL_HAL_MODE_INTERRUPT);
+			~SerialHAL();
 
 			//Return the pointer to the UART; can be used to verify that the ISR only fires on this serial port
 			UART_HandleTypeDef* getHandleTypeDef() { return huart; }
@@ -42,13 +78,41 @@ namespace digitalcave {
 			uint8_t read(uint8_t *b);
 			uint8_t write(uint8_t data);
 
-			//Notify serial library that there is a byte ready for reading.  This MUST be called by the serial read ISR.
+			// Bulk overrides; drain the receive buffer with memcpy and transmit the whole span in one HAL call
+			uint16_t read(uint8_t* a, uint16_t len);
+			uint16_t write(uint8_t* data, uint16_t len);
+
+			//Space in the write queue (DMA mode); 0 in interrupt mode, where every write blocks
+			uint16_t writable();
+
+			//Block until all queued bytes have been sent (DMA mode); returns immediately in interrupt mode
+			void flush();
+
+			//Number of received bytes dropped because the read buffer was full (DMA mode only)
+			uint32_t getRxOverruns() { return rxOverruns; }
+
+			//Notify serial library that there is a byte ready for reading (interrupt mode), or that the receive DMA has
+			// reached half / full / idle (DMA mode).  This is called by the HAL callbacks in SerialHAL.cpp.
 			void isr();
 			void error();
 
+			//Notify serial library that a DMA transmit has completed.  This is called by HAL_UART_TxCpltCallback.
+			void txComplete();
+
 			using Stream::read; // Allow other overloaded functions from superclass to show up in subclass.
 			using Stream::write; // Allow other overloaded functions from superclass to show up in subclass.
 	};
 }
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Checks and clears the UART idle line flag, and drains the receive DMA if it was set.  Call this from the USART IRQ handler.
+void SerialHAL_IdleIRQHandler(UART_HandleTypeDef* huart);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -30,6 +30,20 @@ uint32_t timer_millis(){
 	return millis;
 }
 
+uint32_t timer_micros(){
+	uint32_t ms;
+	uint32_t ticks;
+
+	//SysTick counts down from LOAD once per millisecond; if it wraps (and millis is incremented)
+	// between the two reads, read them again
+	do {
+		ms = millis;
+		ticks = SysTick->VAL;
+	} while (ms != (uint32_t) millis);
+
+	return ms * 1000 + (SysTick->LOAD - ticks) * 1000 / (SysTick->LOAD + 1);
+}
+
 
 /* 
  * The ISR callback (from HAL).  Increment millis here
@@ -27,6 +27,13 @@ uint64_t timer_millis();
 uint32_t timer_millis();
 #endif
 
+/*
+ * Returns the number of microseconds which have elapsed since the last time
+ * timer_init() was called, from the millisecond count and the SysTick counter.
+ * Overflows after about 71 minutes; use differences to compare times.
+ */
+uint32_t timer_micros();
+
 #if defined (__cplusplus)
 }
 #endif
@@ -1,178 +1,429 @@
 /*
  * WARNING:
- * This persistence layer implementation just writes bytes at the end of the flash section
- * for the currently selected chip.  This means that if your program takes up the
- * full space, PARTS OF IT WILL BE OVERWRITTEN WITH RANDOM DATA.  THIS IS A BAD THING!
+ * This persistence layer implementation writes to two flash sectors of the currently selected
+ * chip (see PERSIST_SECTOR_A / B below).  This means that if your program takes up that space,
+ * PARTS OF IT WILL BE OVERWRITTEN WITH RANDOM DATA.  THIS IS A BAD THING!
  * You MUST BE SURE that you are safe to write to this area before writing.
  * The easiest / best way to ensure that you don't overwrite program data is to modify
- * the .ld script to reduce the FLASH memory areas to not include the entire last sector.
- * For instance, on the STM32F410, the last flash sector is SECTOR_4, which is 64k in length,
- * starting at address 0x8010000.  The other sectors 0 - 3 are each 16k in length, starting
- * at address 0x8000000.  This means that if you change the FLASH length to 64k, you will
- * prevent the linker from writing any data to the last sector.
+ * the .ld script so that the FLASH memory areas do not include those sectors.
+ * On the STM32F411 these are the last two sectors, 6 and 7 (128k each, from 0x8040000), so
+ * changing the FLASH length to 256k is enough.
+ * The STM32F410 only has 128k: sectors 0 - 3 are 16k each, starting at address 0x8000000, and
+ * sector 4 is 64k, starting at 0x8010000.  Leaving just sectors 0 - 2 for the program is too
+ * tight, so the log uses sectors 1 and 2 (0x8004000 - 0x800BFFF) and the .ld script splits the
+ * flash in two: sector 0 for the vector table (which must be at 0x8000000), and sectors 3 and 4
+ * (80k from 0x800C000) for everything else.  Flash such an image from its .hex file, not a .bin,
+ * so that the programmer does not erase the log sectors in the gap.
  *
- * To prevent us from doing too much erasing / writing, we perform basic wear leveling
- * by using pages.  The first page is dedicated to pointing to the current page.  After that,
- * the pages are incremented in order.  Once all pages are filled, the next write will erase
- * the chip and start again.  Note that we use a maximum of 256 pages (with the first one
- * being dedicated to the index), since we use 8 bit page addressing.
+ * The persisted address space (FLASH_PAGE_SIZE bytes) is split into chunks of PERSIST_CHUNK_SIZE
+ * bytes.  Each persist_write() appends one record per changed chunk to a log in the active
+ * sector; a record holds the chunk number, a sequence number, the chunk data and a CRC, and
+ * supersedes any earlier record for the same chunk.  A table in RAM holds the address of the
+ * newest record of each chunk, so reads never search the flash.  The table is rebuilt from both
+ * sectors on the first call after a reset; records with a bad CRC (a write cut short by a reset)
+ * are skipped, and where a chunk is in both sectors the newest sequence number wins.  Changing
+ * PERSIST_CHUNK_SIZE or FLASH_PAGE_SIZE loses the saved data.
+ *
+ * When the active sector is full, writing switches to the other (already erased) sector, which
+ * only costs its three word header.  The chunks still living in the old sector are then copied
+ * across by persist_poll(), one per call, after which the old sector is erased so that it is
+ * ready for the next switch.  persist_write() therefore never erases (and never takes longer
+ * than programming its records), as long as persist_poll() is called often enough to finish
+ * compacting before the new sector fills up; if it is not, persist_write() finishes the job
+ * itself.  Each sector is erased once per (sector size / record size) writes, instead of once
+ * per 255 writes.
+ *
+ * Note that on single bank parts (all of the STM32F4xx) the CPU stalls on any flash access while
+ * a sector is being erased, which includes fetching code; unless the program runs from RAM,
+ * the persist_poll() call which starts an erase takes as long as the erase (hundreds of
+ * milliseconds to a second).  Call it where that is acceptable, e.g. before starting a watchdog;
+ * persist_poll_erases() and persist_write_erases() tell whether a call would erase, so that the
+ * erase can be put off until then.
  */
 
-#include <math.h>
 #include <dcutil/persist.h>
+#include <dcutil/crc16.h>
 #include "stm32f4xx_hal.h"
 
-//extern UART_HandleTypeDef huart6;
-
-//This is the total amount of space allowed for persistence.  This MUST be less than 1/2 the size of the FLASH_SECTOR_SIZE
-// (and if you want any sort of wear leveling, it should be less than 1/3 the size).  Furthermore, the flash page size
-// must be small enough to fully fit into ram, since we need to load it when doing updates / erases.
-// We default the size to 256 bytes, but you can override this from the CDEFS in the makefile.
-// If you make it any less than 256 bytes, you limit the total number of pages to that value.
+//This is the total amount of space allowed for persistence.  We default the size to 256 bytes, but you can
+// override this from the CDEFS in the makefile.  Together with the chunk size, it sets the size of the index
+// kept in RAM (4 bytes per chunk).
 #ifndef FLASH_PAGE_SIZE
 	#define FLASH_PAGE_SIZE 		(256)
 #endif
 
+//Smallest unit which is rewritten when anything in it changes; must be a multiple of 4.
+#ifndef PERSIST_CHUNK_SIZE
+	#define PERSIST_CHUNK_SIZE		(32)
+#endif
+
 #if defined(STM32F410Rx)
-	#define FLASH_SECTOR_INDEX		(FLASH_SECTOR_4)
-	#define FLASH_SECTOR_SIZE		(65536)
-	#define FLASH_BASE_ADDRESS		(0x8010000)
+	#define PERSIST_SECTOR_A		(FLASH_SECTOR_1)
+	#define PERSIST_SECTOR_A_SIZE	(16384)
+	#define PERSIST_SECTOR_A_ADDRESS	(0x8004000)
+	#define PERSIST_SECTOR_B		(FLASH_SECTOR_2)
+	#define PERSIST_SECTOR_B_SIZE	(16384)
+	#define PERSIST_SECTOR_B_ADDRESS	(0x8008000)
 #elif defined (STM32F411xE)
-	#define FLASH_SECTOR_INDEX		(FLASH_SECTOR_7)
-	#define FLASH_SECTOR_SIZE		(131072)
-	#define FLASH_BASE_ADDRESS		(0x8060000)
+	#define PERSIST_SECTOR_A		(FLASH_SECTOR_6)
+	#define PERSIST_SECTOR_A_SIZE	(131072)
+	#define PERSIST_SECTOR_A_ADDRESS	(0x8040000)
+	#define PERSIST_SECTOR_B		(FLASH_SECTOR_7)
+	#define PERSIST_SECTOR_B_SIZE	(131072)
+	#define PERSIST_SECTOR_B_ADDRESS	(0x8060000)
 #else
-	#warning Chip not defined for persistence library.  Please add flash sector size and base address.
+	#warning Chip not defined for persistence library.  Please add flash sector sizes and base addresses.
 #endif
 
-#define FLASH_PAGE_COUNT			(FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
-#define FLASH_MAGIC_BYTE			(0x42)
+//Flash is read through this; the host tests replace it with their flash simulator.
+#ifndef PERSIST_READ_WORD
+	#define PERSIST_READ_WORD(address)	(*(__IO uint32_t*) (address))
+#endif
 
-static void persist_erase(){
-	//HAL_UART_Transmit(&huart6, (uint8_t*) "Erasing...", 10, 1);
-	HAL_FLASH_Unlock();
-	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR);
-	FLASH_Erase_Sector(FLASH_SECTOR_INDEX, VOLTAGE_RANGE_3);
-	HAL_FLASH_Program(TYPEPROGRAM_BYTE, (uint32_t) FLASH_BASE_ADDRESS, FLASH_MAGIC_BYTE);	//Write the magic byte
-	HAL_FLASH_Lock();
-	//HAL_UART_Transmit(&huart6, (uint8_t*) " Finished\n", 10, 1);
+#define PERSIST_CHUNK_COUNT			((FLASH_PAGE_SIZE + PERSIST_CHUNK_SIZE - 1) / PERSIST_CHUNK_SIZE)
+
+//Sector header: magic, generation, ~generation.  The sector with the highest generation is the active one.
+#define PERSIST_MAGIC				(0x474F4C42)
+#define PERSIST_HEADER_SIZE			(12)
+
+//Record: chunk number (low 16 bits) and data length (high 16 bits), sequence number, data, CRC (high 16 bits 0).
+#define PERSIST_RECORD_SIZE			(8 + PERSIST_CHUNK_SIZE + 4)
+
+#if PERSIST_CHUNK_SIZE % 4
+	#error PERSIST_CHUNK_SIZE must be a multiple of 4
+#endif
+#if PERSIST_SECTOR_A_SIZE < PERSIST_HEADER_SIZE + 2 * PERSIST_CHUNK_COUNT * PERSIST_RECORD_SIZE || PERSIST_SECTOR_B_SIZE < PERSIST_HEADER_SIZE + 2 * PERSIST_CHUNK_COUNT * PERSIST_RECORD_SIZE
+	#error Persistence sectors must hold at least two records for every chunk
+#endif
+
+//What the spare (not active) sector is doing
+#define PERSIST_STATE_CLEAN			0	//Erased, ready to switch to
+#define PERSIST_STATE_COPYING		1	//Holds chunks which have not been copied to the active sector yet
+#define PERSIST_STATE_DIRTY			2	//Needs erasing
+#define PERSIST_STATE_ERASING		3	//Erase started
+
+static const uint32_t persist_sector_index[2] = { PERSIST_SECTOR_A, PERSIST_SECTOR_B };
+static const uint32_t persist_sector_address[2] = { PERSIST_SECTOR_A_ADDRESS, PERSIST_SECTOR_B_ADDRESS };
+static const uint32_t persist_sector_size[2] = { PERSIST_SECTOR_A_SIZE, PERSIST_SECTOR_B_SIZE };
+
+static uint8_t persist_loaded = 0;
+static uint32_t persist_index[PERSIST_CHUNK_COUNT];	//Address of the newest record of each chunk, 0 if it has never been written
+static uint32_t persist_index_sequence[PERSIST_CHUNK_COUNT];
+static uint32_t persist_sequence;		//Sequence number of the next record
+static uint32_t persist_generation;		//Generation of the active sector
+static uint8_t persist_active;			//Sector being written
+static uint32_t persist_free;			//Address of the next record in the active sector
+static uint8_t persist_state;			//PERSIST_STATE_* of the spare sector
+static uint8_t persist_moving;			//Chunks still in the spare sector while copying
+static uint8_t persist_cursor;			//Next chunk to look at while copying
+
+static uint8_t persist_in_sector(uint32_t address, uint8_t sector){
+	return address >= persist_sector_address[sector] && address < persist_sector_address[sector] + persist_sector_size[sector];
 }
 
-uint8_t persist_write(uint32_t address, uint8_t* data, uint16_t length){
-	//Bounds checking
-	if ((address + length) > FLASH_PAGE_SIZE) return 1;
+static uint32_t persist_end(uint8_t sector){
+	return persist_sector_address[sector] + persist_sector_size[sector];
+}
 
-	uint8_t oldData[FLASH_PAGE_SIZE];
-	if (persist_read(0, oldData, FLASH_PAGE_SIZE)){
-		//We can't read the old data; this means that we probably need to erase.
-		persist_erase();
-		//Reset the oldData to zeros since we can't read it.
-		for (uint16_t i = 0; i < FLASH_PAGE_SIZE; i++){
-			oldData[i] = 0x00;
+static uint16_t persist_crc(uint32_t address, uint16_t length){
+	uint16_t crc = CRC16_INIT;
+	for (uint16_t i = 0; i < length; i += 4){
+		uint32_t word = PERSIST_READ_WORD(address + i);
+		for (uint8_t j = 0; j < 4; j++){
+			crc = crc16_update(crc, word >> (j * 8));
 		}
-		//HAL_UART_Transmit(&huart6, (uint8_t*) "Zero data\n", 10, 1);
 	}
+	return crc;
+}
 
-	//Compare the old data with the new data to see if there are changes.
-	uint8_t changed = 0;
-	for (uint16_t i = 0; i < length; i++){
-		if (oldData[address + i] != data[i]){
-			oldData[address + i] = data[i];
-			changed = 1;
-		}
+//Returns 1 if the sector starts with a valid header, and sets the generation.
+static uint8_t persist_header(uint8_t sector, uint32_t* generation){
+	uint32_t address = persist_sector_address[sector];
+	*generation = PERSIST_READ_WORD(address + 4);
+	return PERSIST_READ_WORD(address) == PERSIST_MAGIC && PERSIST_READ_WORD(address + 8) == ~*generation;
+}
+
+static uint8_t persist_blank(uint8_t sector){
+	for (uint32_t address = persist_sector_address[sector]; address < persist_end(sector); address += 4){
+		if (PERSIST_READ_WORD(address) != 0xFFFFFFFF) return 0;
 	}
-	if (!changed){
-		//HAL_UART_Transmit(&huart6, (uint8_t*) "No Change...\n", 13, 1);
-		return 0;		//Even though we have not written anything, we consider this a success.
-	}
-
-	//Find the next available page by looking through the index page.
-	uint8_t nextIndex = 0x00;
-	uint8_t lastPage = 0x00;
-	uint8_t nextPage = 0x00;
-	for (uint16_t i = 1; i < fmin(FLASH_PAGE_SIZE, fmin(FLASH_PAGE_COUNT, 255)); i++){
-		nextIndex = i;
-		lastPage = nextPage;
-		nextPage = *(__IO uint8_t*) (FLASH_BASE_ADDRESS + i);
-		if (nextPage == 0xFF){
-			nextPage = lastPage + 1;
-			break;
+	return 1;
+}
+
+//Adds the records of a sector to the index, and returns the address of the first free record slot.
+static uint32_t persist_scan(uint8_t sector){
+	uint32_t address = persist_sector_address[sector] + PERSIST_HEADER_SIZE;
+	uint32_t end = persist_end(sector);
+	for (; address + PERSIST_RECORD_SIZE <= end; address += PERSIST_RECORD_SIZE){
+		uint32_t head = PERSIST_READ_WORD(address);
+		uint16_t chunk = head & 0xFFFF;
+		if ((head >> 16) != PERSIST_CHUNK_SIZE || chunk >= PERSIST_CHUNK_COUNT || PERSIST_READ_WORD(address + 8 + PERSIST_CHUNK_SIZE) != persist_crc(address, 8 + PERSIST_CHUNK_SIZE)){
+			//Either the end of the log, or a record which was cut short (which is skipped)
+			uint8_t blank = 1;
+			for (uint16_t i = 0; i < PERSIST_RECORD_SIZE; i += 4){
+				if (PERSIST_READ_WORD(address + i) != 0xFFFFFFFF) blank = 0;
+			}
+			if (blank) break;
+			continue;
+		}
+
+		uint32_t sequence = PERSIST_READ_WORD(address + 4);
+		if (sequence >= persist_sequence) persist_sequence = sequence + 1;
+		if (persist_index[chunk] == 0 || sequence >= persist_index_sequence[chunk]){
+			persist_index[chunk] = address;
+			persist_index_sequence[chunk] = sequence;
 		}
 	}
+	return address;
+}
 
-	// char buffer[64];
-	// uint8_t size = snprintf(buffer, sizeof(buffer), "lastPage = %02x, nextPage = %02x, nextIndex = %02x\n", lastPage, nextPage, nextIndex);
-	// HAL_UART_Transmit(&huart6, (uint8_t*) buffer, size, 1);
+static void persist_load(){
+	uint32_t generation[2];
+	uint8_t valid[2];
 
-	if (nextPage == 0xFF){
-		//We are completely full; erase the sector and start over again.
-		persist_erase();
-		nextIndex = 0x00;
-		nextPage = 0x01;
+	for (uint8_t i = 0; i < PERSIST_CHUNK_COUNT; i++){
+		persist_index[i] = 0;
 	}
+	persist_sequence = 0;
+	persist_moving = 0;
+	persist_cursor = 0;
+
+	valid[0] = persist_header(0, &generation[0]);
+	valid[1] = persist_header(1, &generation[1]);
+	persist_active = valid[1] && (!valid[0] || generation[1] > generation[0]);
+
+	if (!valid[persist_active]){
+		//Nothing written yet; treat sector B as active and full, so that the first write switches to sector A
+		persist_active = 1;
+		persist_generation = 0;
+		persist_free = persist_end(1);
+		persist_state = persist_blank(0) ? PERSIST_STATE_CLEAN : PERSIST_STATE_DIRTY;
+		persist_loaded = 1;
+		return;
+	}
+
+	uint8_t spare = !persist_active;
+	persist_generation = generation[persist_active];
+	if (valid[spare]){
+		persist_scan(spare);
+	}
+	persist_free = persist_scan(persist_active);
+
+	if (valid[spare]){
+		for (uint8_t i = 0; i < PERSIST_CHUNK_COUNT; i++){
+			if (persist_index[i] && persist_in_sector(persist_index[i], spare)) persist_moving++;
+		}
+		persist_state = PERSIST_STATE_COPYING;
+	}
+	else {
+		persist_state = persist_blank(spare) ? PERSIST_STATE_CLEAN : PERSIST_STATE_DIRTY;
+	}
+	persist_loaded = 1;
+}
+
+static void persist_program(uint32_t address, uint32_t word){
+	HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address, word);
+}
 
-	//Write the next page's data
+static void persist_unlock(){
 	HAL_FLASH_Unlock();
 	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR);
-	for (uint16_t i = 0; i < FLASH_PAGE_SIZE; i++){
-		HAL_FLASH_Program(
-				TYPEPROGRAM_BYTE,
-				(uint32_t) FLASH_BASE_ADDRESS + (FLASH_PAGE_SIZE * nextPage) + i,
-				oldData[i]
-		);
-	}
-	// HAL_UART_Transmit(&huart6, (uint8_t*) "Wrote page\n", 11, 1);
-
-	//Update the index with the currently written page
-	HAL_FLASH_Program(
-			TYPEPROGRAM_BYTE,
-			(uint32_t) FLASH_BASE_ADDRESS + nextIndex,
-			nextPage
-	);
-	// HAL_UART_Transmit(&huart6, (uint8_t*) "Wrote index\n", 12, 1);
+}
+
+//Makes the (clean) spare sector the active one.  Flash must be unlocked.
+static void persist_switch(){
+	uint8_t sector = !persist_active;
+	uint32_t address = persist_sector_address[sector];
+	persist_generation++;
+	persist_program(address + 4, persist_generation);
+	persist_program(address + 8, ~persist_generation);
+	persist_program(address, PERSIST_MAGIC);		//Last, so that a header cut short is not valid
+
+	persist_active = sector;
+	persist_free = address + PERSIST_HEADER_SIZE;
+	persist_moving = 0;
+	for (uint8_t i = 0; i < PERSIST_CHUNK_COUNT; i++){
+		if (persist_index[i]) persist_moving++;		//All of them are in the old sector now
+	}
+	persist_cursor = 0;
+	persist_state = PERSIST_STATE_COPYING;
+}
+
+//Does one step of compacting the spare sector; returns 1 if there is more to do.  Flash must be unlocked.
+static uint8_t persist_step(){
+	uint8_t spare = !persist_active;
+	switch (persist_state){
+		case PERSIST_STATE_COPYING:
+			while (persist_moving){
+				if (persist_free + PERSIST_RECORD_SIZE > persist_end(persist_active)) return 0;
+				uint8_t chunk = persist_cursor;
+				persist_cursor = (persist_cursor + 1) % PERSIST_CHUNK_COUNT;
+				uint32_t from = persist_index[chunk];
+				if (from == 0 || !persist_in_sector(from, spare)) continue;
 
+				//Copy the record as it is; it keeps its sequence number, so it is not newer than it was
+				for (uint16_t i = 0; i < PERSIST_RECORD_SIZE; i += 4){
+					persist_program(persist_free + i, PERSIST_READ_WORD(from + i));
+				}
+				persist_index[chunk] = persist_free;
+				persist_free += PERSIST_RECORD_SIZE;
+				persist_moving--;
+				return 1;
+			}
+			persist_state = PERSIST_STATE_DIRTY;
+			return 1;
+		case PERSIST_STATE_DIRTY:
+			FLASH_Erase_Sector(persist_sector_index[spare], VOLTAGE_RANGE_3);
+			persist_state = PERSIST_STATE_ERASING;
+			return 1;
+		case PERSIST_STATE_ERASING:
+			if (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY)) return 1;
+			persist_state = PERSIST_STATE_CLEAN;
+			return 0;
+		default:
+			return 0;
+	}
+}
+
+uint8_t persist_poll(){
+	if (!persist_loaded) persist_load();
+	if (persist_state == PERSIST_STATE_CLEAN) return 0;
+
+	persist_unlock();
+	uint8_t result = persist_step();
 	HAL_FLASH_Lock();
+	return result;
+}
 
-	return 0;
+uint8_t persist_poll_erases(){
+	if (!persist_loaded) persist_load();
+	return persist_state == PERSIST_STATE_DIRTY || persist_state == PERSIST_STATE_ERASING;
 }
 
-uint8_t persist_read(uint32_t address, uint8_t* data, uint16_t length){
-	//Check the magic byte
-	if ((*(__IO uint8_t*) FLASH_BASE_ADDRESS) != FLASH_MAGIC_BYTE){
-		// HAL_UART_Transmit(&huart6, (uint8_t*) "Missing Magic...\n", 17, 1);
-		return 1;
-	}
-
-	//Find the current page by looking through the first (index) page.
-	uint8_t currentPage = 0x00;
-	uint8_t nextPage = 0x01;
-	uint8_t full = 1;	//Assume full until proven otherwise
-	for (uint16_t i = 1; i < fmin(FLASH_PAGE_SIZE, fmin(FLASH_PAGE_COUNT, 255)); i++){
-		currentPage = nextPage;
-		nextPage = *(__IO uint8_t*) (FLASH_BASE_ADDRESS + i);
-		if (nextPage == 0xFF){
-			full = 0;
-			break;
+uint8_t persist_write_erases(uint32_t address, uint16_t length){
+	if ((address + length) > FLASH_PAGE_SIZE || length == 0) return 0;
+	if (!persist_loaded) persist_load();
+	if (persist_state == PERSIST_STATE_CLEAN) return 0;		//Switching sectors does not erase
+
+	//Worst case, every chunk changes.  Each record appended (or copied by persist_poll()) uses one slot and
+	// leaves at most one fewer to copy, so if there is room for these and everything still to be copied,
+	// persist_append() never has to finish compacting.
+	uint32_t chunks = (address + length - 1) / PERSIST_CHUNK_SIZE - address / PERSIST_CHUNK_SIZE + 1;
+	return persist_free + (persist_moving + chunks) * PERSIST_RECORD_SIZE > persist_end(persist_active) || persist_state == PERSIST_STATE_ERASING;
+}
+
+//Appends a record for the given chunk; returns 0 on success.  Flash must be unlocked.
+static uint8_t persist_append(uint8_t chunk, uint8_t* data){
+	//Make sure that the chunks still to be copied will fit after this record; if not, finish compacting
+	// (waiting for the erase if needed) and switch sectors.
+	if (persist_free + (uint32_t) (persist_moving + 1) * PERSIST_RECORD_SIZE > persist_end(persist_active)){
+		while (persist_step()){
+			FLASH_WaitForLastOperation(50000);
 		}
+		//Only if resets during compaction left too little room to copy everything
+		if (persist_state != PERSIST_STATE_CLEAN) return 1;
+		if (persist_free + PERSIST_RECORD_SIZE > persist_end(persist_active)) persist_switch();
 	}
 
-	// char buffer[64];
-	// uint8_t size = snprintf(buffer, sizeof(buffer), "currentPage = %02x, nextPage = %02x\n", currentPage, nextPage);
-	// HAL_UART_Transmit(&huart6, (uint8_t*) buffer, size, 1);
-
-	if (full){
-		// HAL_UART_Transmit(&huart6, (uint8_t*) "Index Full...\n", 14, 1);
-		return 2;	//There is no more space left in the first page
+	uint32_t address = persist_free;
+	uint32_t sequence = persist_sequence++;
+	uint16_t crc = CRC16_INIT;
+	uint32_t words[2] = { chunk | ((uint32_t) PERSIST_CHUNK_SIZE << 16), sequence };
+	for (uint8_t i = 0; i < 2; i++){
+		for (uint8_t j = 0; j < 4; j++){
+			crc = crc16_update(crc, words[i] >> (j * 8));
+		}
 	}
-	if (currentPage == 0){
-		// HAL_UART_Transmit(&huart6, (uint8_t*) "FLASH_PAGE_SIZE invalid...\n", 27, 1);
-		return 3;	//Either FLASH_PAGE_SIZE or FLASH_PAGE_COUNT is invalid (less than 2)
+	for (uint16_t i = 0; i < PERSIST_CHUNK_SIZE; i++){
+		crc = crc16_update(crc, data[i]);
 	}
 
-	//Look at currentPage to find the actual data
-	for (uint16_t i = 0; i < length; i++){
-		data[i] = *(__IO uint8_t*) (FLASH_BASE_ADDRESS + (FLASH_PAGE_SIZE * currentPage) + address + i);
+	persist_program(address, words[0]);
+	persist_program(address + 4, sequence);
+	for (uint16_t i = 0; i < PERSIST_CHUNK_SIZE; i += 4){
+		persist_program(address + 8 + i, data[i] | ((uint32_t) data[i + 1] << 8) | ((uint32_t) data[i + 2] << 16) | ((uint32_t) data[i + 3] << 24));
 	}
+	persist_program(address + 8 + PERSIST_CHUNK_SIZE, crc);
 
+	if (persist_index[chunk] && persist_state == PERSIST_STATE_COPYING && persist_in_sector(persist_index[chunk], !persist_active)){
+		persist_moving--;
+	}
+	persist_index[chunk] = address;
+	persist_index_sequence[chunk] = sequence;
+	persist_free += PERSIST_RECORD_SIZE;
 	return 0;
 }
+
+//Reads the current contents of a chunk; returns 0 if it has never been written (and fills it with 0xFF).
+static uint8_t persist_chunk(uint8_t chunk, uint8_t* data){
+	uint32_t address = persist_index[chunk];
+	for (uint16_t i = 0; i < PERSIST_CHUNK_SIZE; i += 4){
+		uint32_t word = address ? PERSIST_READ_WORD(address + 8 + i) : 0xFFFFFFFF;
+		data[i] = word;
+		data[i + 1] = word >> 8;
+		data[i + 2] = word >> 16;
+		data[i + 3] = word >> 24;
+	}
+	return address != 0;
+}
+
+uint8_t persist_write(uint32_t address, uint8_t* data, uint16_t length){
+	//Bounds checking
+	if ((address + length) > FLASH_PAGE_SIZE) return 1;
+	if (!persist_loaded) persist_load();
+
+	uint8_t result = 0;
+	uint8_t unlocked = 0;
+	uint8_t buffer[PERSIST_CHUNK_SIZE];
+	uint16_t offset = address % PERSIST_CHUNK_SIZE;
+	for (uint8_t chunk = address / PERSIST_CHUNK_SIZE; length; chunk++){
+		uint16_t count = PERSIST_CHUNK_SIZE - offset;
+		if (count > length) count = length;
+
+		//Only chunks which actually change are written
+		uint8_t changed = !persist_chunk(chunk, buffer);
+		for (uint16_t i = 0; i < count; i++){
+			if (buffer[offset + i] != data[i]){
+				buffer[offset + i] = data[i];
+				changed = 1;
+			}
+		}
+		if (changed){
+			if (!unlocked){
+				persist_unlock();
+				unlocked = 1;
+			}
+			if (persist_append(chunk, buffer)) result = 2;
+		}
+
+		data += count;
+		length -= count;
+		offset = 0;
+	}
+	if (unlocked) HAL_FLASH_Lock();
+
+	return result;
+}
+
+uint8_t persist_read(uint32_t address, uint8_t* data, uint16_t length){
+	//Bounds checking
+	if ((address + length) > FLASH_PAGE_SIZE) return 1;
+	if (!persist_loaded) persist_load();
+
+	uint8_t missing = 0;
+	uint8_t buffer[PERSIST_CHUNK_SIZE];
+	uint16_t offset = address % PERSIST_CHUNK_SIZE;
+	for (uint8_t chunk = address / PERSIST_CHUNK_SIZE; length; chunk++){
+		uint16_t count = PERSIST_CHUNK_SIZE - offset;
+		if (count > length) count = length;
+		if (!persist_chunk(chunk, buffer)) missing = 1;
+		for (uint16_t i = 0; i < count; i++){
+			data[i] = buffer[offset + i];
+		}
+		data += count;
+		length -= count;
+		offset = 0;
+	}
+
+	return missing;
+}
@@ -210,6 +210,8 @@ static  uint8_t spiRec(void) {
 uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   // end read if in partialBlockRead mode
   readEnd();
+  // and stop a multiple block read
+  readStop();
 
   // select card
   chipSelectLow();
@@ -344,7 +346,7 @@ uint8_t Sd2Card::eraseSingleBlockEnable(void) {
  * can be determined by calling errorCode() and errorData().
  */
 uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
-  errorCode_ = inBlock_ = partialBlockRead_ = type_ = 0;
+  errorCode_ = inBlock_ = partialBlockRead_ = type_ = inMultiBlock_ = 0;
   chipSelectPin_ = chipSelectPin;
   // 16-bit init start time allows over a minute
   uint16_t t0 = (uint16_t)millis();
@@ -451,6 +453,25 @@ void Sd2Card::partialBlockRead(uint8_t value) {
   partialBlockRead_ = value;
 }
 //------------------------------------------------------------------------------
+/**
+ * Enable or disable multiple block reads.
+ *
+ * With multiple block reads enabled, blocks are read with READ_MULTIPLE_BLOCK,
+ * and the read is left open after each block.  If the next block read is the
+ * one after it, as when a file is read from start to end, it is already on its
+ * way, and no command or wait for the card to find the block is needed.  Any
+ * other read or command stops the open read first.
+ *
+ * The SPI SS line is held low while a multiple block read is open; call
+ * readStop() before using other devices on the same SPI bus.
+ *
+ * \param[in] value The value TRUE (non-zero) or FALSE (zero).)
+ */
+void Sd2Card::multiBlockRead(uint8_t value) {
+  readStop();
+  multiBlockRead_ = value;
+}
+//------------------------------------------------------------------------------
 /**
  * Read a 512 byte block from an SD card device.
  *
@@ -484,12 +505,18 @@ uint8_t Sd2Card::readData(uint32_t block,
     goto fail;
   }
   if (!inBlock_ || block != block_ || offset < offset_) {
-    block_ = block;
-    // use address if not SDHC card
-    if (type()!= SD_CARD_TYPE_SDHC) block <<= 9;
-    if (cardCommand(CMD17, block)) {
-      error(SD_CARD_ERROR_CMD17);
-      goto fail;
+    if (inMultiBlock_ && !inBlock_ && block == block_ + 1) {
+      // the card is already sending the next block
+      block_ = block;
+    } else {
+      block_ = block;
+      // use address if not SDHC card
+      if (type()!= SD_CARD_TYPE_SDHC) block <<= 9;
+      if (cardCommand(multiBlockRead_ ? CMD18 : CMD17, block)) {
+        error(multiBlockRead_ ? SD_CARD_ERROR_CMD18 : SD_CARD_ERROR_CMD17);
+        goto fail;
+      }
+      inMultiBlock_ = multiBlockRead_;
     }
     if (!waitStartBlock()) {
       goto fail;
@@ -547,6 +574,7 @@ uint8_t Sd2Card::readData(uint32_t block,
   return true;
 
  fail:
+  readStop();
   chipSelectHigh();
   return false;
 }
@@ -572,11 +600,32 @@ void Sd2Card::readEnd(void) {
 #else  // OPTIMIZE_HARDWARE_SPI
     while (offset_++ < 514) spiRec();
 #endif  // OPTIMIZE_HARDWARE_SPI
-    chipSelectHigh();
+    // a multiple block read carries on with the next block, so the card stays selected
+    if (!inMultiBlock_) chipSelectHigh();
     inBlock_ = 0;
   }
 }
 //------------------------------------------------------------------------------
+/**
+ * End a multiple block read, if one is open.  This is done before any other
+ * command; call it before using other devices on the same SPI bus.
+ */
+void Sd2Card::readStop(void) {
+  if (inMultiBlock_) {
+    inMultiBlock_ = 0;
+    readEnd();
+    chipSelectLow();
+    spiSend(CMD12 | 0x40);
+    for (uint8_t i = 0; i < 4; i++) spiSend(0);
+    spiSend(0XFF);
+    // skip the stuff byte, left over from the data being read
+    spiRec();
+    for (uint8_t i = 0; ((status_ = spiRec()) & 0X80) && i != 0XFF; i++);
+    waitNotBusy(300);
+    chipSelectHigh();
+  }
+}
+//------------------------------------------------------------------------------
 /** read CID or CSR register */
 uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
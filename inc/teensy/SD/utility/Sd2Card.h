@@ -111,6 +111,8 @@ uint8_t const SD_CARD_ERROR_WRITE_PROGRAMMING = 0X14;
 uint8_t const SD_CARD_ERROR_WRITE_TIMEOUT = 0X15;
 /** incorrect rate selected */
 uint8_t const SD_CARD_ERROR_SCK_RATE = 0X16;
+/** card returned an error response for CMD18 (read multiple blocks) */
+uint8_t const SD_CARD_ERROR_CMD18 = 0X17;
 //------------------------------------------------------------------------------
 // card types
 /** Standard capacity V1 SD card */
@@ -127,7 +129,8 @@ uint8_t const SD_CARD_TYPE_SDHC = 3;
 class Sd2Card {
  public:
   /** Construct an instance of Sd2Card. */
-  Sd2Card(void) : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0) {}
+  Sd2Card(void) : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0),
+    multiBlockRead_(0), inMultiBlock_(0) {}
   uint32_t cardSize(void);
   uint8_t erase(uint32_t firstBlock, uint32_t lastBlock);
   uint8_t eraseSingleBlockEnable(void);
@@ -153,6 +156,9 @@ class Sd2Card {
     return init(sckRateID, SD_CHIP_SELECT_PIN);
   }
   uint8_t init(uint8_t sckRateID, uint8_t chipSelectPin);
+  void multiBlockRead(uint8_t value);
+  /** Returns the current value, true or false, for multiple block read. */
+  uint8_t multiBlockRead(void) const {return multiBlockRead_;}
   void partialBlockRead(uint8_t value);
   /** Returns the current value, true or false, for partial block read. */
   uint8_t partialBlockRead(void) const {return partialBlockRead_;}
@@ -173,6 +179,7 @@ class Sd2Card {
     return readRegister(CMD9, csd);
   }
   void readEnd(void);
+  void readStop(void);
   uint8_t setSckRate(uint8_t sckRateID);
   /** Return the card type: SD V1, SD V2 or SDHC */
   uint8_t type(void) const {return type_;}
@@ -189,6 +196,8 @@ class Sd2Card {
   uint8_t partialBlockRead_;
   uint8_t status_;
   uint8_t type_;
+  uint8_t multiBlockRead_;
+  uint8_t inMultiBlock_;
   // private functions
   uint8_t cardAcmd(uint8_t cmd, uint32_t arg) {
     cardCommand(CMD55, 0);
@@ -8,6 +8,7 @@
 #include <avr/pgmspace.h>
 
 #include <font/font.h>
+#include <font/glyph.h>
 
 namespace digitalcave {
 
@@ -10,7 +10,7 @@
  *
  * In general, this is mapped by 'ascii value - 0x20'.
  */
-uint8_t codepage_ascii_caps[] PROGMEM = {
+uint8_t codepage_ascii_caps[] FONT_PROGMEM = {
 	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, //0x00-0x0F
 	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, //0x10-0x1F
 	0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F, //0x20-0x2F
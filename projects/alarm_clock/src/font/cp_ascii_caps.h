@@ -1,14 +1,7 @@
 #ifndef CODEPAGE_ASCII_CAPS_H
 #define CODEPAGE_ASCII_CAPS_H
 
-#include <avr/io.h>
-#include <avr/pgmspace.h> 
-
-// Workaround for http://gcc.gnu.org/bugzilla/show_bug.cgi?id=34734
-#ifdef PROGMEM
-#undef PROGMEM
-#define PROGMEM __attribute__((section(".progmem.data")))
-#endif
+#include <font/font.h>
 
 extern uint8_t codepage_ascii_caps[];
 
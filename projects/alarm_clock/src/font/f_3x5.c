@@ -6,7 +6,7 @@
  * to the next line.  Each character is represented by two 8bit unsigned integers, with
  * bit 8 of the first ignored.
  */
-uint8_t font_data_3x5[] PROGMEM = {
+uint8_t font_data_3x5[] FONT_PROGMEM = {
 	0x00,0x00,	//Space
 	0x24,0x82,	//!
 	0x5a,0x00,	//"
@@ -79,7 +79,7 @@ uint8_t font_data_3x5[] PROGMEM = {
 	0x05,0x40,	//~
 };
 
-static uint8_t font_width_3x5[] PROGMEM = {
+static uint8_t font_width_3x5[] FONT_PROGMEM = {
 	0x01,	//Space
 	0xFF,	//!
 	0xFF,	//"
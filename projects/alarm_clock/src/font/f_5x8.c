@@ -4,7 +4,7 @@
  * A 5x8 pixel font.  The bits are read across from top left to top right, then down
  * to the next line.  Each character is represented by five 8bit unsigned integers.
  */
-static uint8_t font_data_5x8[] PROGMEM = {
+static uint8_t font_data_5x8[] FONT_PROGMEM = {
 	0x74, 0x63, 0x18, 0xc6, 0x2e,	//0				(0x00)
 	0x23, 0x28, 0x42, 0x10, 0x9f,	//1
 	0x74, 0x42, 0x26, 0x42, 0x1f,	//2
@@ -21,7 +21,7 @@ static uint8_t font_data_5x8[] PROGMEM = {
 	0x00, 0x01, 0xc0, 0x00, 0x00	//-				(0x0D)
 };
 
-static uint8_t font_widths_5x8[] PROGMEM = {
+static uint8_t font_widths_5x8[] FONT_PROGMEM = {
 	0xFF,
 	0xFF,
 	0xFF,
@@ -38,7 +38,7 @@ static uint8_t font_widths_5x8[] PROGMEM = {
 	0x03
 };
 
-uint8_t codepage_5x8[] PROGMEM = {
+uint8_t codepage_5x8[] FONT_PROGMEM = {
 //	0    1    2    3    4    5    6    7    8    9    A    B    C    D    E    F
 	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, //0x00-0x0F
 	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, //0x10-0x1F
@@ -4,7 +4,7 @@
  * A 8x8 pixel icon font.  The bits are read across from top left to top right, then down
  * to the next line.  Each character is represented by 8 8bit unsigned integers.
  */
-static uint8_t font_data_icon[] PROGMEM = {
+static uint8_t font_data_icon[] FONT_PROGMEM = {
 	0x60, 0x80, 0x54, 0x34, 0x34, 0xdc, 0x00, 0x00,	//A, Sunday				(0x00)
 	0xa0, 0xe0, 0xe8, 0xb4, 0xb4, 0xa8, 0x00, 0x00,	//B, Monday				(0x01)
 	0xe0, 0x40, 0x54, 0x54, 0x54, 0x4c, 0x00, 0x00,	//C, Tuesday			(0x02)
@@ -30,7 +30,7 @@ static uint8_t font_data_icon[] PROGMEM = {
 
 static uint8_t font_widths_icon[1];
 
-uint8_t codepage_icon[] PROGMEM = {
+uint8_t codepage_icon[] FONT_PROGMEM = {
 //	0    1    2    3    4    5    6    7    8    9    A    B    C    D    E    F
 	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, //0x00-0x0F
 	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, //0x10-0x1F
@@ -0,0 +1,149 @@
+#!/usr/bin/python
+#
+# Decoder for Chiindii's binary telemetry (see src/Telemetry.h).  Prints one CSV line per
+# record to stdout, and the number of records lost (from gaps in the sequence) to stderr.
+#
+# Stream from the craft, selecting the fields (a TELEMETRY_* mask, default all) and sending
+# a record every decimation rate tasks (default 20, which is 25Hz):
+#	telemetry.py /dev/ttyUSB0 38400 [fields] [decimation]
+# Or decode a capture of the serial output, e.g. from the simulator (make CAPTURE=serial.bin):
+#	telemetry.py serial.bin
+#
+###################
+
+import struct, sys
+
+START = 0x7e
+ESCAPE = 0x7d
+
+MESSAGE_TELEMETRY = 0x05
+
+# Fields in record order: mask, name, struct format, scale (the value is the integer / scale)
+FIELDS = [
+	(0x0001, ['roll', 'pitch', 'yaw'], '<3h', 10000.0),
+	(0x0002, ['roll_sp', 'pitch_sp', 'yaw_sp'], '<3h', 10000.0),
+	(0x0004, ['gyro_x', 'gyro_y', 'gyro_z'], '<3h', 1000.0),
+	(0x0008, ['rate_sp_x', 'rate_sp_y', 'rate_sp_z'], '<3h', 1000.0),
+	(0x0010, ['rate_pv_x', 'rate_pv_y', 'rate_pv_z'], '<3h', 10000.0),
+	(0x0020, ['accel_x', 'accel_y', 'accel_z'], '<3h', 1000.0),
+	(0x0040, ['m1', 'm2', 'm3', 'm4', 'm5', 'm6', 'm7', 'm8'], '<8H', 10000.0),
+	(0x0080, ['throttle', 'battery', 'mode'], '<HBB', None),
+]
+HEADER = '<HHI'
+
+def frames(read):
+	'''Yields (command, data) for each valid frame (additive checksum) from read(), which returns a byte or None at the end.'''
+	pos = 0
+	esc = False
+	err = False
+	length = 0
+	cmd = 0
+	chk = 0
+	data = bytearray()
+	while True:
+		b = read()
+		if b is None:
+			return
+		if err and b != START:
+			continue
+		err = False
+		if b == START:
+			pos = 1
+			esc = False
+			chk = 0
+			data = bytearray()
+			continue
+		if pos == 0:
+			continue
+		if b == ESCAPE:
+			esc = True
+			continue
+		if esc:
+			b ^= 0x20
+			esc = False
+
+		if pos == 1:
+			length = b
+			pos = 2 if length > 0 else 0
+			continue
+		chk = (chk + b) & 0xFF
+		if pos == 2:
+			cmd = b
+		elif pos < length + 2:
+			data.append(b)
+		else:
+			if chk == 0xFF:
+				yield cmd, bytes(data)
+			pos = 0
+			continue
+		pos += 1
+
+def columns(fields):
+	names = ['sequence', 'time']
+	for mask, labels, fmt, scale in FIELDS:
+		if fields & mask:
+			names += labels
+	return names
+
+def decode(data):
+	'''Returns (sequence, fields, values) for a record'''
+	sequence, fields, time = struct.unpack_from(HEADER, data, 0)
+	offset = struct.calcsize(HEADER)
+	values = [time]
+	for mask, labels, fmt, scale in FIELDS:
+		if fields & mask:
+			raw = struct.unpack_from(fmt, data, offset)
+			offset += struct.calcsize(fmt)
+			if scale is None:
+				values += [raw[0] / 10000.0, raw[1], raw[2]]
+			else:
+				values += [v / scale for v in raw]
+	return sequence, fields, values
+
+def main():
+	if len(sys.argv) > 2:
+		import serial
+		ser = serial.Serial(sys.argv[1], int(sys.argv[2]))
+		fields = int(sys.argv[3], 0) if len(sys.argv) > 3 else 0xFF
+		decimation = int(sys.argv[4]) if len(sys.argv) > 4 else 20
+		request = [fields & 0xFF, fields >> 8, decimation]
+		payload = [MESSAGE_TELEMETRY] + request
+		frame = bytearray([START])
+		for b in [len(payload)] + payload + [0xFF - (sum(payload) & 0xFF)]:
+			frame += bytearray([ESCAPE, b ^ 0x20]) if b in (START, ESCAPE) else bytearray([b])
+		ser.write(bytes(frame))
+		def read():
+			c = ser.read(1)
+			return c[0] if c else None
+	elif len(sys.argv) == 2:
+		capture = open(sys.argv[1], 'rb').read()
+		iterator = iter(bytearray(capture))
+		def read():
+			return next(iterator, None)
+	else:
+		sys.stderr.write('Usage: telemetry.py <port> <baud> [fields] [decimation] | telemetry.py <capture>\n')
+		sys.exit(1)
+
+	last = None
+	lost = 0
+	records = 0
+	header = None
+	try:
+		for cmd, data in frames(read):
+			if cmd != MESSAGE_TELEMETRY:
+				continue
+			sequence, fields, values = decode(data)
+			if header != fields:
+				header = fields
+				print(','.join(columns(fields)))
+			if last is not None:
+				lost += (sequence - last - 1) & 0xFFFF
+			last = sequence
+			records += 1
+			print(','.join([str(sequence)] + ['%g' % v for v in values]))
+	except KeyboardInterrupt:
+		pass
+	sys.stderr.write('%d records, %d lost\n' % (records, lost))
+
+if __name__ == '__main__':
+	main()
@@ -4,6 +4,7 @@
 //How many motors.  Check doc/motor_arrangement.txt for how the motors are arranged in various configurations.
 #define MOTOR_COUNT			8
 
+#include <math.h>
 #include <dcutil/delay.h>
 #include <dcutil/dcmath.h>
 #include <dctypes.h>
@@ -15,12 +16,30 @@
 #include <HMC5883L.h>
 #include <SerialHAL.h>
 #include <PID.h>
+#include <Scheduler.h>
 
+#include "Config.h"
 #include "Status.h"
+#include "Telemetry.h"
 #include "battery/battery.h"
 #include "controllers/General.h"
 #include "controllers/UniversalController.h"
 
+//The rate groups which run() schedules, in priority order, with their periods in µs.  Rate fuses the IMU
+// samples and runs the rate PID and motors; attitude reads the magnetometer and runs the angle PID; comms
+// handles one incoming message; housekeeping reads the battery and updates the status lights.  Telemetry
+// records are sent from the rate task, every so many as configured with MESSAGE_TELEMETRY.
+#define TASK_RATE					0
+#define TASK_ATTITUDE				1
+#define TASK_COMMS					2
+#define TASK_HOUSEKEEPING			3
+#define TASK_RATE_PERIOD			2000
+#define TASK_ATTITUDE_PERIOD		10000
+#define TASK_COMMS_PERIOD			4000
+#define TASK_HOUSEKEEPING_PERIOD	50000
+
+//The most MPU6050 FIFO frames to fuse in one rate task; any more are left for the next one
+#define IMU_FRAME_COUNT				MPU6050_FIFO_BURST
 
 enum chiindii_mode_t {
 	MODE_UNARMED		=	0x00,
@@ -61,6 +80,9 @@ namespace digitalcave {
 			MS5611* getMs5611() { return &ms5611; }
 			HMC5883L* getHmc5883l() { return &hmc5883l; }
 
+			Scheduler* getScheduler() { return &scheduler; }
+			Telemetry* getTelemetry() { return &telemetry; }
+
 			Status* getStatus();
 
 			uint8_t getBatteryLevel() { return battery_level; }
@@ -69,8 +91,13 @@ namespace digitalcave {
 			chiindii_mode_t getMode() { return mode; }
 			void setMode(chiindii_mode_t mode) { this->mode = mode; }
 
+			//The config is saved a block at a time from the housekeeping task, so that saving never holds up
+			// the rate task; a status message is sent when it is done.  Loading applies the saved config if
+			// it is valid, and otherwise leaves everything as it is.
 			void saveConfig();
 			void loadConfig();
+			void getConfig(config_t* config);
+			void setConfig(config_t* config);
 			void sendDebug(char* message, uint8_t length) { FramedSerialMessage response(MESSAGE_DEBUG, (uint8_t*) message, length); sendMessage(&response); }
 			void sendDebug(const char* message, uint8_t length) { sendDebug((char*) message, length); }
 			void sendStatus(char* message, uint8_t length) { FramedSerialMessage response(MESSAGE_STATUS, (uint8_t*) message, length); sendMessage(&response); }
@@ -87,6 +114,7 @@ namespace digitalcave {
 			HMC5883L hmc5883l;
 
 			FramedSerialProtocol protocol;
+			FramedSerialMessage request;
 
 			chiindii_mode_t mode;
 			uint8_t battery_level;
@@ -94,6 +122,22 @@ namespace digitalcave {
 			vector_t angle_sp;
 			vector_t rate_sp;
 
+			//State shared between the rate groups
+			vector_t accel;
+			vector_t gyro;
+			vector_t mag;
+			imu_frame_t frames[IMU_FRAME_COUNT];
+			float gyro_z_average;
+			uint32_t lastReceiveMessageTime;
+			uint32_t lastLowBatteryTime;
+			float lowBatteryThrottle;
+
+			Scheduler scheduler;
+			Telemetry telemetry;
+			Config config;
+
+			//How much of the throttle and of each rate PID output goes to each motor
+			float mixing[8][4];
 
 			PID rate_x;
 			PID rate_y;
@@ -109,6 +153,12 @@ namespace digitalcave {
 			UniversalController universalController;
 
 			Status status;
+
+			//The rate groups; time is in ms
+			void rate(uint32_t time);
+			void attitude(uint32_t time);
+			void comms(uint32_t time);
+			void housekeeping(uint32_t time);
 	};
 
 }
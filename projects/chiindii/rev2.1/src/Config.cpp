@@ -0,0 +1,61 @@
+#include <stddef.h>
+#include <string.h>
+#include <dcutil/crc16.h>
+#include <dcutil/persist.h>
+
+#include "Config.h"
+
+using namespace digitalcave;
+
+//Any change to the layout must come with a new CONFIG_VERSION
+static_assert(sizeof(config_t) == 208, "config_t has changed; update this and CONFIG_VERSION");
+
+static uint16_t crc(config_t* config){
+	return crc16((uint8_t*) config, offsetof(config_t, crc));
+}
+
+Config::Config() :
+	written(sizeof(config_t))
+{
+	;
+}
+
+uint8_t Config::load(config_t* config){
+	//Missing data reads as erased, which is not a valid magic
+	persist_read(CONFIG_ADDRESS, (uint8_t*) config, sizeof(config_t));
+
+	if (config->magic != CONFIG_MAGIC) return CONFIG_BLANK;
+	if (config->version != CONFIG_VERSION || config->length != sizeof(config_t)) return CONFIG_WRONG_VERSION;
+	if (config->crc != crc(config)) return CONFIG_CORRUPT;
+	return CONFIG_OK;
+}
+
+void Config::save(config_t* config){
+	config->magic = CONFIG_MAGIC;
+	config->version = CONFIG_VERSION;
+	config->length = sizeof(config_t);
+	config->reserved = 0;
+	config->crc = crc(config);
+
+	memcpy(&pending, config, sizeof(config_t));
+	written = 0;
+}
+
+uint8_t Config::poll(){
+	if (!isSaving()) return CONFIG_OK;
+
+	//Checked for the whole config up front, so that a save is never cut short part way through
+	if (written == 0 && persist_write_erases(CONFIG_ADDRESS, sizeof(config_t))){
+		written = sizeof(config_t);
+		return CONFIG_ERASE_NEEDED;
+	}
+
+	uint8_t length = sizeof(config_t) - written;
+	if (length > CONFIG_SAVE_BLOCK) length = CONFIG_SAVE_BLOCK;
+	if (persist_write(CONFIG_ADDRESS + written, ((uint8_t*) &pending) + written, length)){
+		written = sizeof(config_t);
+		return CONFIG_FAILED;
+	}
+	written += length;
+	return isSaving() ? CONFIG_SAVING : CONFIG_OK;
+}
@@ -0,0 +1,78 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include <dctypes.h>
+
+//Where the config lives in the persisted address space; it must fit in FLASH_PAGE_SIZE (see persist.c)
+#define CONFIG_ADDRESS				0
+#define CONFIG_MAGIC				0x4343
+//Change the version whenever config_t changes; a saved config of another version is ignored (and the
+// defaults used) rather than misread.
+#define CONFIG_VERSION				1
+
+//Bytes written per poll() while saving.  Matching the persist layer's chunk size means each poll programs
+// at most one record, which keeps it to a couple of hundred µs on the STM32F4.
+#define CONFIG_SAVE_BLOCK			32
+
+//The PIDs, in the order they are held in config_t
+#define CONFIG_PID_RATE_X			0
+#define CONFIG_PID_RATE_Y			1
+#define CONFIG_PID_RATE_Z			2
+#define CONFIG_PID_ANGLE_X			3
+#define CONFIG_PID_ANGLE_Y			4
+#define CONFIG_PID_ANGLE_Z			5
+#define CONFIG_PID_GFORCE			6
+#define CONFIG_PID_COUNT			7
+
+//Results of load() and poll()
+#define CONFIG_OK					0
+#define CONFIG_BLANK				1	//Nothing saved (or not a config)
+#define CONFIG_WRONG_VERSION		2	//Saved by firmware with another layout
+#define CONFIG_CORRUPT				3	//Bad CRC, e.g. a save cut short by a reset
+#define CONFIG_SAVING				4	//More blocks to write
+#define CONFIG_FAILED				5	//The persist layer refused a write
+#define CONFIG_ERASE_NEEDED			6	//Saving would erase flash first, which is left for the next reset
+
+namespace digitalcave {
+
+	//Everything which is tuned or calibrated on the bench.  The struct is the saved format: it is read and
+	// written whole, in the MCU's own byte order and alignment (the fields are ordered so that there is no
+	// padding), and the CRC covers everything before it.
+	typedef struct config {
+		uint16_t magic;
+		uint8_t version;
+		uint8_t length;						//sizeof(config_t)
+		float tunings[CONFIG_PID_COUNT][3];	//kp, ki, kd
+		float limits[CONFIG_PID_COUNT][2];	//Output min, max; for the angle PIDs these are the rate limits (rad / s)
+		float beta;							//Madgwick filter gain
+		int16_t mpuCalibration[6];			//Accel X, Y, Z, gyro X, Y, Z; see MPU6050::setCalibration()
+		vector_t magCalibration;
+		int8_t mixing[8][4];				//Percent of throttle and rate PID output X, Y, Z for each motor
+		uint16_t reserved;
+		uint16_t crc;
+	} config_t;
+
+	class Config {
+		private:
+			config_t pending;
+			uint8_t written;				//Bytes of pending saved so far
+
+		public:
+			Config();
+
+			//Reads the saved config into config, and returns CONFIG_OK if it can be used, or why not
+			static uint8_t load(config_t* config);
+
+			//Fills in the header and CRC of config and starts saving it, replacing any save in progress
+			void save(config_t* config);
+
+			//Writes the next block of a save.  Returns CONFIG_SAVING while there is more to write, and
+			// CONFIG_OK or CONFIG_FAILED once the save is over (CONFIG_OK when there is nothing to save).
+			// A save which could not be written without erasing flash (which stalls the CPU for longer
+			// than the watchdog allows) is dropped before its first block, with CONFIG_ERASE_NEEDED.
+			uint8_t poll();
+			uint8_t isSaving() { return written < sizeof(config_t); }
+	};
+}
+#endif
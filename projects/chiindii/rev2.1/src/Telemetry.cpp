@@ -0,0 +1,80 @@
+#include "Telemetry.h"
+
+using namespace digitalcave;
+
+static uint8_t put16(uint8_t* buffer, uint8_t n, uint16_t value){
+	buffer[n++] = value & 0xFF;
+	buffer[n++] = value >> 8;
+	return n;
+}
+
+//Scales to fixed point, rounding to nearest and clamping to the int16 range
+static int16_t fixed(float value, float scale){
+	float scaled = value * scale;
+	if (scaled >= 32767) return 32767;
+	if (scaled <= -32768) return -32768;
+	return (int16_t) (scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+static uint16_t fraction(float value){
+	if (value <= 0) return 0;
+	if (value >= 6.5535f) return 65535;
+	return (uint16_t) (value * 10000 + 0.5f);
+}
+
+static uint8_t putVector(uint8_t* buffer, uint8_t n, vector_t* v, float scale){
+	n = put16(buffer, n, fixed(v->x, scale));
+	n = put16(buffer, n, fixed(v->y, scale));
+	return put16(buffer, n, fixed(v->z, scale));
+}
+
+Telemetry::Telemetry() :
+	fields(0),
+	decimation(1),
+	countdown(0),
+	sequence(0)
+{
+	;
+}
+
+void Telemetry::configure(uint16_t fields, uint8_t decimation){
+	this->fields = fields & TELEMETRY_ALL;
+	this->decimation = decimation ? decimation : 1;
+	this->countdown = 0;
+}
+
+uint8_t Telemetry::poll(){
+	if (fields == 0) return 0;
+	if (countdown > 0){
+		countdown--;
+		return 0;
+	}
+	countdown = decimation - 1;
+	return 1;
+}
+
+uint8_t Telemetry::encode(telemetry_t* t, uint8_t* buffer){
+	uint8_t n = 0;
+	n = put16(buffer, n, sequence++);
+	n = put16(buffer, n, fields);
+	n = put16(buffer, n, t->time & 0xFFFF);
+	n = put16(buffer, n, t->time >> 16);
+
+	if (fields & TELEMETRY_ANGLE) n = putVector(buffer, n, &t->angle, 10000);
+	if (fields & TELEMETRY_ANGLE_SP) n = putVector(buffer, n, &t->angle_sp, 10000);
+	if (fields & TELEMETRY_GYRO) n = putVector(buffer, n, &t->gyro, 1000);
+	if (fields & TELEMETRY_RATE_SP) n = putVector(buffer, n, &t->rate_sp, 1000);
+	if (fields & TELEMETRY_RATE_PV) n = putVector(buffer, n, &t->rate_pv, 10000);
+	if (fields & TELEMETRY_ACCEL) n = putVector(buffer, n, &t->accel, 1000);
+	if (fields & TELEMETRY_MOTORS){
+		for (uint8_t i = 0; i < 8; i++){
+			n = put16(buffer, n, fraction(t->motors[i]));
+		}
+	}
+	if (fields & TELEMETRY_STATE){
+		n = put16(buffer, n, fraction(t->throttle));
+		buffer[n++] = t->battery;
+		buffer[n++] = t->mode;
+	}
+	return n;
+}
@@ -0,0 +1,63 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <dctypes.h>
+
+//Telemetry fields, selected with a bit mask.  A record has the header (sequence as uint16, fields as uint16 and
+// time in ms as uint32), then each selected field in this order, all little endian fixed point.  Values out of
+// range are clamped.  See python/telemetry.py for a decoder.
+#define TELEMETRY_ANGLE				0x0001	//Estimated roll, pitch, yaw: 3 x int16, 1/10000 rad
+#define TELEMETRY_ANGLE_SP			0x0002	//Angle set point: 3 x int16, 1/10000 rad
+#define TELEMETRY_GYRO				0x0004	//Gyro: 3 x int16, 1/1000 rad/s
+#define TELEMETRY_RATE_SP			0x0008	//Rate set point (angle PID output): 3 x int16, 1/1000 rad/s
+#define TELEMETRY_RATE_PV			0x0010	//Rate PID output: 3 x int16, 1/10000
+#define TELEMETRY_ACCEL				0x0020	//Accel: 3 x int16, 1/1000 g
+#define TELEMETRY_MOTORS			0x0040	//Motor outputs 1 - 8: 8 x uint16, 1/10000
+#define TELEMETRY_STATE				0x0080	//Throttle: uint16, 1/10000; battery level: uint8; mode: uint8
+#define TELEMETRY_ALL				0x00FF
+
+#define TELEMETRY_HEADER_SIZE		8
+#define TELEMETRY_MAX_SIZE			(TELEMETRY_HEADER_SIZE + 6 * 6 + 16 + 4)
+
+namespace digitalcave {
+
+	//A snapshot of the flight state, from which records are encoded
+	typedef struct telemetry {
+		uint32_t time;
+		vector_t angle;
+		vector_t angle_sp;
+		vector_t gyro;
+		vector_t rate_sp;
+		vector_t rate_pv;
+		vector_t accel;
+		float motors[8];
+		float throttle;
+		uint8_t battery;
+		uint8_t mode;
+	} telemetry_t;
+
+	class Telemetry {
+		private:
+			uint16_t fields;
+			uint8_t decimation;
+			uint8_t countdown;
+			uint16_t sequence;
+
+		public:
+			Telemetry();
+
+			//Sends the given fields (0 to stop) every decimation rate tasks
+			void configure(uint16_t fields, uint8_t decimation);
+			uint16_t getFields() { return fields; }
+
+			//Called once per rate task; returns 1 when a record is due
+			uint8_t poll();
+
+			//Writes a record of the selected fields into buffer (of at least TELEMETRY_MAX_SIZE bytes), and
+			// returns its length.  Each record takes the next sequence number, so that the receiver can count
+			// lost records.
+			uint8_t encode(telemetry_t* t, uint8_t* buffer);
+	};
+}
+#endif
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "General.h"
 
 #include "../Chiindii.h"
@@ -15,5 +17,22 @@ void General::dispatch(FramedSerialMessage* request) {
 		FramedSerialMessage response(MESSAGE_BATTERY, data, 1);
 		chiindii->sendMessage(&response);
 	}
+	else if (cmd == MESSAGE_SCHEDULE){
+		Scheduler* scheduler = chiindii->getScheduler();
+		uint8_t data[sizeof(scheduler_stats_t) * SCHEDULER_MAX_TASKS];
+		uint8_t length = 0;
+		for (uint8_t i = 0; i < scheduler->getCount(); i++){
+			memcpy(data + length, scheduler->getStats(i), sizeof(scheduler_stats_t));
+			length += sizeof(scheduler_stats_t);
+		}
+		FramedSerialMessage response(MESSAGE_SCHEDULE, data, length);
+		chiindii->sendMessage(&response);
 
+		if (request->getLength() && request->getData()[0]) scheduler->resetStats();
+	}
+	else if (cmd == MESSAGE_TELEMETRY){
+		uint8_t* data = request->getData();
+		if (request->getLength() >= 3) chiindii->getTelemetry()->configure(data[0] | (data[1] << 8), data[2]);
+		else chiindii->getTelemetry()->configure(0, 1);
+	}
 }
@@ -8,6 +8,13 @@
 #define MESSAGE_BATTERY							0x01
 #define MESSAGE_STATUS							0x02
 #define MESSAGE_DEBUG							0x03
+//Scheduler statistics for each rate group (see Chiindii.h), as scheduler_stats_t in task order (little
+// endian).  If the request has a non-zero data byte, the statistics are cleared after being sent.
+#define MESSAGE_SCHEDULE						0x04
+//Binary telemetry.  The request is the fields to send (uint16, little endian; TELEMETRY_* in Telemetry.h, or 0
+// to stop) and the decimation (uint8, one record every so many rate tasks).  Records are sent back with the
+// same command.
+#define MESSAGE_TELEMETRY						0x05
 
 namespace digitalcave {
 	class Chiindii; // forward declaration
@@ -1,3 +1,5 @@
+#include <stdio.h>
+
 #include "UniversalController.h"
 
 #include "../Chiindii.h"
@@ -46,7 +46,9 @@
 /* Exported functions ------------------------------------------------------- */
 
 void SysTick_Handler(void);
+void DMA2_Stream1_IRQHandler(void);
 void USART6_IRQHandler(void);
+void DMA2_Stream6_IRQHandler(void);
 
 #ifdef __cplusplus
 }
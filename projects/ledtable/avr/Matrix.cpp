@@ -52,14 +52,16 @@ void Matrix::setPixel(int16_t x, int16_t y) {
 		buffer[i].blue  ^= color.blue;
 	}
 	
-	if (buffer[i].red != current.red || buffer[i].green != current.green || buffer[i].blue != current.blue) changed = 1;
+	if (buffer[i].red != current.red || buffer[i].green != current.green || buffer[i].blue != current.blue) markDirty(x, y, x, y);
 	
 //	buffer[x*12+y].red = 0xff;
 }
 
 void Matrix::flush(){
-	if (changed) {
+	//The strand can only be sent whole; the dirty region just says whether anything changed
+	int16_t x0, y0, x1, y1;
+	if (getDirty(&x0, &y0, &x1, &y1)) {
 		ws281x_set(buffer);
-		changed = 0;
+		clearDirty();
 	}
 }
\ No newline at end of file
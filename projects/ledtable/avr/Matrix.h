@@ -11,7 +11,6 @@
 namespace digitalcave {
 	class Matrix : public Draw {
 	private:
-		uint8_t changed;
 		ws2812_t buffer[MATRIX_WIDTH * MATRIX_HEIGHT];
 		ws2812_t color;
 		
@@ -1,5 +0,0 @@
-#include "debug.h"
-
-void pwm_set_phase_batch(uint8_t index, uint16_t phase){
-	printf(" index: %d, Phase: %d\n", index, phase);
-}
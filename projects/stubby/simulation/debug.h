@@ -1,9 +0,0 @@
-#ifndef DEBUG_H
-#define DEBUG_H
-#include <stdio.h>
-#include <stdlib.h>
-#include <stdint.h>
-
-void pwm_set_phase_batch(uint8_t index, uint16_t phase);
-#endif
-
@@ -3,22 +3,7 @@
 #include <dcutil/dcmath.h>
 
 #include "Stubby.h"
-
-/*
- * Returns the angle which the servo needs to move from neutral.  Used for both tibia and femur.
- */
-double solveServoTrapezoid(double desired_angle, double length_a, double length_b, double length_c, double length_d, double angle_E_offset, double angle_E_offset2, double angle_N){
-	//See diagrams in doc/diagrams.pdf for description of sides and angles
-	//Use law of cosines to find the length of the line between the control rod connection point and the servo shaft
-	double length_e = sqrt(length_d * length_d + length_a * length_a - 2 * length_d * length_a * cos_f(desired_angle + angle_E_offset));
-
-	//Use law of cosines to find the angle between the line we just calculated (e) and the line between the servo shaft and servo horn / control rod connection (b)
-	double angle_C = acos_f((length_e * length_e + length_b * length_b - length_c * length_c) / (2 * length_e * length_b));
-	//Use law of cosines to find the angle between the line we just calculated (e) and the line between the joint and the servo shaft (d)
-	double angle_D = acos_f((length_e * length_e + length_a * length_a - length_d * length_d) / (2 * length_e * length_a));
-
-	return (angle_C + angle_D + angle_E_offset2) - angle_N;
-}
+#include "ik/ik.h"
 
 Leg::Leg(uint8_t index, volatile uint8_t *tibia_port, uint8_t tibia_pin, volatile uint8_t *femur_port, uint8_t femur_pin, volatile uint8_t *coxa_port, uint8_t coxa_pin, double mounting_angle, Point neutralP){
 	this->index = index;
@@ -29,40 +14,27 @@ Leg::Leg(uint8_t index, volatile uint8_t *tibia_port, uint8_t tibia_pin, volatil
 	this->pin[FEMUR] = femur_pin;
 	this->pin[COXA] = coxa_pin;
 	this->mounting_angle = mounting_angle;
+	this->mounting_cos = cos_q(radToAngleQ(mounting_angle));
+	this->mounting_sin = sin_q(radToAngleQ(mounting_angle));
 	this->neutralP = neutralP;
 }
 
 void Leg::setPosition(Point p){
 	this->p = p;
 
-	//Rotate leg around 0, 0 such that the leg is pointing straight out at angle 0 (straight right).
-	p.rotateXY(this->mounting_angle * -1);
-	//Translate the leg according to the leg offset, to put the coxa joint at co-ordinates 0,0.
-	p.x -= LEG_OFFSET;
-
-	//Find the angle of the leg, used to set the coxa joint.  See figure 2.1, 'coxa angle'.
-	double coxa_angle = atan2(p.y, p.x);
-
-	//Find the length of the leg, from coxa joint to end of tibia, on the x,y plane (to be later
-	// used for X,Z inverse kinematics).  See figure 2.1, 'leg length', 'p.x', and 'p.y'.
-	double leg_length = sqrt((p.x * p.x) + (p.y * p.y));
-
-	//Find the distance between the femur joint and the end of the tibia.  Do this using the
-	// right triangle of (FEMUR_HEIGHT + COXA_HEIGHT - z), (leg_length - COXA_LENGTH).  See figure
-	// 2.2, 'leg extension'
-	double leg_extension = sqrt((FEMUR_HEIGHT + COXA_HEIGHT - p.z) * (FEMUR_HEIGHT + COXA_HEIGHT - p.z) + (leg_length - COXA_LENGTH) * (leg_length - COXA_LENGTH));
-	//Find the first part of the femur angle using law of cosines.  See figure 2.2 for a diagram of this.
-	double femur_angle_a = acos_f((((FEMUR_HEIGHT + COXA_HEIGHT - p.z) * (FEMUR_HEIGHT + COXA_HEIGHT - p.z)) + (leg_extension * leg_extension) - ((leg_length - COXA_LENGTH) * (leg_length - COXA_LENGTH))) / (2 * (FEMUR_HEIGHT + COXA_HEIGHT - p.z) * leg_extension));
-	//Find the second part of the femur angle using law of cosines.  See figure 2.3 for a diagram of this.
-	double femur_angle_b = acos_f(((FEMUR_LENGTH * FEMUR_LENGTH) + (leg_extension * leg_extension) - (TIBIA_LENGTH * TIBIA_LENGTH)) / (2 * FEMUR_LENGTH * leg_extension));
-	double femur_angle = femur_angle_a + femur_angle_b;
+	//Rotate leg around 0, 0 such that the leg is pointing straight out at angle 0 (straight right), and translate
+	// it according to the leg offset, to put the coxa joint at co-ordinates 0,0.  This keeps IK_SHIFT bits of
+	// fraction (the rotation is Q14), as the IK works in 1/IK_SCALE mm.
+	int16_t x = (((int32_t) p.x * this->mounting_cos + (int32_t) p.y * this->mounting_sin + (1 << (13 - IK_SHIFT))) >> (14 - IK_SHIFT)) - LEG_OFFSET * IK_SCALE;
+	int16_t y = ((int32_t) p.y * this->mounting_cos - (int32_t) p.x * this->mounting_sin + (1 << (13 - IK_SHIFT))) >> (14 - IK_SHIFT);
+	int16_t z = p.z * IK_SCALE;
 
-	//Find the desired tibia angle using law of cosines.  See figure 2.4 for a diagram of this.
-	double tibia_angle = acos_f(((FEMUR_LENGTH * FEMUR_LENGTH) + (TIBIA_LENGTH * TIBIA_LENGTH) - (leg_extension * leg_extension)) / (2 * FEMUR_LENGTH * TIBIA_LENGTH));
+	int16_t phase[JOINT_COUNT];
+	ik_solve(x, y, z, phase);
 
-	this->setTibiaAngle(tibia_angle);
-	this->setFemurAngle(femur_angle);
-	this->setCoxaAngle(coxa_angle);
+	for (uint8_t j = 0; j < JOINT_COUNT; j++){
+		pwm_set_phase_batch((this->index * JOINT_COUNT) + j, PHASE_NEUTRAL + (this->calibration[j] * 10) + phase[j], PWM_SERVO_TIMEOUT_COUNTER);
+	}
 
 	//TODO If the servo angles are out of bounds (either NaN or an integer outside of the valid PWM range), then re-calculate
 	// the x,y,z co-ordinates based on valid numbers.  This will be quite doable for out of bounds angles, but will be very
@@ -128,19 +100,3 @@ int8_t Leg::getCalibration(uint8_t i){
 void Leg::setCalibration(uint8_t i, int8_t calibration){
 	if (i < CALIBRATION_COUNT) this->calibration[i] = calibration;
 }
-
-void Leg::setTibiaAngle(double desired_angle){
-	//See diagrams in doc/diagrams.pdf for description of sides and angles
-	double angle_S = solveServoTrapezoid(desired_angle, TIBIA_A, TIBIA_B, TIBIA_C, TIBIA_D, TIBIA_E_OFFSET_ANGLE, TIBIA_E_OFFSET_ANGLE, TIBIA_NEUTRAL_SERVO_ANGLE);
-	pwm_set_phase_batch((this->index * JOINT_COUNT) + TIBIA, (uint16_t) PHASE_NEUTRAL + (this->calibration[TIBIA] * 10) + angle_S * ((PHASE_MAX - PHASE_MIN) / SERVO_TRAVEL), PWM_SERVO_TIMEOUT_COUNTER);
-}
-
-void Leg::setFemurAngle(double desired_angle){
-	//See diagrams in doc/diagrams.pdf for description of sides and angles
-	double angle_S = solveServoTrapezoid(desired_angle, FEMUR_A, FEMUR_B, FEMUR_C, FEMUR_D, FEMUR_E_OFFSET_ANGLE, FEMUR_E_OFFSET_ANGLE, FEMUR_NEUTRAL_SERVO_ANGLE);
-	pwm_set_phase_batch((this->index * JOINT_COUNT) + FEMUR, (uint16_t) PHASE_NEUTRAL + (this->calibration[FEMUR] * 10) + angle_S * ((PHASE_MAX - PHASE_MIN) / SERVO_TRAVEL), PWM_SERVO_TIMEOUT_COUNTER);
-}
-
-void Leg::setCoxaAngle(double desired_angle){
-	pwm_set_phase_batch((this->index * JOINT_COUNT) + COXA, (uint16_t) PHASE_NEUTRAL + (this->calibration[COXA] * 10) + desired_angle * COXA_PHASE_MULTIPLIER, PWM_SERVO_TIMEOUT_COUNTER);
-}
@@ -89,13 +89,10 @@ class Leg {
 		Point p;										//Foot co-ordinates
 		Point neutralP;									//Neutral foot co-ordinates
 		double mounting_angle;							//The angle at which the leg is mounted, in degrees, relative to the X axis of a standard cartesian plane.
+		int16_t mounting_cos;							//Cosine and sine of the mounting angle, in Q14, for rotating into the leg's frame
+		int16_t mounting_sin;
 		int8_t calibration[CALIBRATION_COUNT];			//Calibration offset (in degrees for 0..2, and in mm for 3..5)
 
-		//Set the angle for each servo.  This includes the servo abstraction code.
-		void setTibiaAngle(double angle);
-		void setFemurAngle(double angle);
-		void setCoxaAngle(double angle);
-
 	public:
 		/*
 		 * Initializes the leg, given the specified mounting angle describing it's radial position in degrees.
@@ -119,7 +116,7 @@ class Leg {
 
 		/*
 		 * Sets the foot position, in absolute x, y, z co-ordinates.  Performs the IK calculations, the absolute angle to servo angle calculations, and
-		 * sets the servo position for each of the three joints.
+		 * sets the servo position for each of the three joints.  The IK engine is chosen at build time; see ik/ik.h.
 		 */
 		void setPosition(Point point);
 
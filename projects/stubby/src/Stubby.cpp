@@ -5,6 +5,7 @@
 #include "controllers/General.h"
 #include "controllers/UniversalController.h"
 #include "gait/gait.h"
+#include "ik/ik.h"
 
 #define COMM_TIMEOUT_PERIOD			5000
 
@@ -33,6 +34,7 @@ void stubby_main(){
 	PORTC |= _BV(PORTC5) | _BV(PORTC6) | _BV(PORTC7);
 	
 	wdt_enable(WDTO_2S);
+	ik_init();
 	servo_init(stubby.getLegs());
 	battery_init();
 	// magnetometer_init();
@@ -108,6 +110,7 @@ Stubby::Stubby(Stream* serial) :
 	protocol(64),
 	serial(serial),
 	mode(MODE_RESETTING),
+	gait(GAIT_TRIPOD),
 	linearAngle(0),
 	linearVelocity(0),
 	rotationalVelocity(0)
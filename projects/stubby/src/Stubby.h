@@ -16,6 +16,7 @@
 #include <dcutil/delay.h>
 
 #include "hardware.h"
+#include "gait/gait_generator.h"
 #include "hardware/battery.h"
 #include "hardware/servo.h"
 #include "hardware/status.h"
@@ -41,12 +42,14 @@ namespace digitalcave {
 			Leg** getLegs() { return legs; }
 
 			uint8_t getMode() {return mode;}
+			uint8_t getGait() {return gait;}
 			float getLinearAngle() { return linearAngle; }
 			float getLinearVelocity() { return linearVelocity; }
 			float getRotationalVelocity() { return rotationalVelocity; }
 			uint8_t getBatteryPercent() { return battery_get_percent(); }
 
 			void setMode(uint8_t mode) { this->mode = mode;}
+			void setGait(uint8_t gait) { this->gait = gait;}
 			void setLinearAngle(float linearAngle) { this->linearAngle = linearAngle;}
 			void setLinearVelocity(float linearVelocity) { this->linearVelocity = linearVelocity;}
 			void setRotationalVelocity(float rotationalVelocity) { this->rotationalVelocity = rotationalVelocity;}
@@ -65,6 +68,7 @@ namespace digitalcave {
 			Stream* serial;
 
 			uint8_t mode;
+			uint8_t gait;				//GAIT_TRIPOD, GAIT_RIPPLE or GAIT_WAVE; see gait/gait_generator.h
 			float linearAngle;			//Which direction to move.  Expressed as angle in rad
 			float linearVelocity;		//How fast to move in direction linearAngle.  Expressed as float from 0..1
 			float rotationalVelocity;	//How fast to turn in place.  Expressed as float from 0..1
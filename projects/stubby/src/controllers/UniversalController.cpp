@@ -118,6 +118,14 @@ void UniversalController::dispatch(FramedSerialMessage* message){
 			stubby->setMode(MODE_WALKING);
 			pwm_start();
 		}
+		//Triangle (top discrete) button cycles through the gaits; the change happens next time Stubby stands still
+		else if (button == CONTROLLER_BUTTON_VALUE_TRIANGLE){
+			uint8_t gait = (stubby->getGait() + 1) % GAIT_TYPE_COUNT;
+			stubby->setGait(gait);
+			if (gait == GAIT_TRIPOD) stubby->sendStatus("Tripod gait   ", 14);
+			else if (gait == GAIT_RIPPLE) stubby->sendStatus("Ripple gait   ", 14);
+			else stubby->sendStatus("Wave gait     ", 14);
+		}
 	}
 }
 
@@ -0,0 +1,116 @@
+#include "gait.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <dcutil/dcmath.h>
+
+#include "../types/Point.h"
+#include "gait_generator.h"
+
+using namespace digitalcave;
+
+static gait_t gait;
+
+void gait_step(Stubby* stubby){
+	static uint8_t initialized = 0;
+	static uint32_t last_time = 0;
+	static float linear_velocity = 0, linear_angle = 0, rotational_velocity = 0;
+
+	if (!initialized){
+		uint16_t mounting[LEG_COUNT];
+		for (uint8_t i = 0; i < LEG_COUNT; i++){
+			mounting[i] = radToAngleQ(stubby->getLegs()[i]->getMountingAngle());
+		}
+		gait_init(&gait, mounting);
+		gait_set_type(&gait, stubby->getGait(), GAIT_STRIDE, GAIT_LIFT, GAIT_SWING_TIME, GAIT_STEP_INTERVAL);
+		initialized = 1;
+	}
+
+	uint32_t time = timer_millis();
+
+	if (time - last_time >= GAIT_STEP_INTERVAL){
+		Leg** legs = stubby->getLegs();
+
+		//Below the threshold we stop; the gait slows down to neutral rather than stopping dead
+		float lv = 0, la = 0, rv = 0;
+		if (stubby->getRotationalVelocity() >= 0.3 || stubby->getRotationalVelocity() <= -0.3 || stubby->getLinearVelocity() >= 0.3){
+			lv = stubby->getLinearVelocity();
+			la = stubby->getLinearAngle();
+			rv = stubby->getRotationalVelocity();
+		}
+
+		//Only convert the velocities to per leg stride vectors when they change
+		if (lv != linear_velocity || la != linear_angle || rv != rotational_velocity){
+			linear_velocity = lv;
+			linear_angle = la;
+			rotational_velocity = rv;
+			gait_set_velocity(&gait, linear_velocity * 256, radToAngleQ(linear_angle), rotational_velocity * 256);
+		}
+
+		if (!gait_stopped(&gait)){
+			Point offset[LEG_COUNT];
+			gait_next(&gait, offset);
+			for (uint8_t i = 0; i < LEG_COUNT; i++){
+				legs[i]->setOffset(offset[i]);
+			}
+		}
+		else {
+			Point result(0,0,0);
+			for (uint8_t i = 0; i < LEG_COUNT; i++){
+				legs[i]->setOffset(result);
+			}
+
+			//The gait type can only change while standing still
+			if (stubby->getGait() != gait.type){
+				gait_set_type(&gait, stubby->getGait(), GAIT_STRIDE, GAIT_LIFT, GAIT_SWING_TIME, GAIT_STEP_INTERVAL);
+			}
+			gait_restart(&gait);
+		}
+
+		pwm_apply_batch();
+		last_time = time;
+	}
+}
+
+void gait_reset(Stubby* stubby){
+// 	for (uint8_t i = 0; i < 10; i++){
+// 		PORTC ^= _BV(PORTC5) | _BV(PORTC6) | _BV(PORTC7);
+// 		delay_ms(100);
+// 	}
+	stubby->sendStatus("gait_reset    ", 14);
+	
+	pwm_start();
+	
+	//TODO change this to be non blocking
+	Leg** legs = stubby->getLegs();
+	
+	for (uint8_t l = 0; l < LEG_COUNT; l+=2){
+		legs[l]->setOffset(Point(0,0,30));
+	}
+	pwm_apply_batch();
+	delay_ms(200);
+
+	for (uint8_t l = 0; l < LEG_COUNT; l+=2){
+		legs[l]->setOffset(Point(0,0,0));
+	}
+	pwm_apply_batch();
+	delay_ms(200);
+	
+	wdt_reset();
+
+	for (uint8_t l = 1; l < LEG_COUNT; l+=2){
+		legs[l]->setOffset(Point(0,0,30));
+	}
+	pwm_apply_batch();
+	delay_ms(200);
+
+	for (uint8_t l = 1; l < LEG_COUNT; l+=2){
+		legs[l]->setOffset(Point(0,0,0));
+	}
+	pwm_apply_batch();
+	delay_ms(200);
+	
+	stubby->setMode(MODE_UNARMED);
+	
+	pwm_stop();
+}
@@ -0,0 +1,117 @@
+#include "gait_generator.h"
+
+#include <dcutil/dcmath.h>
+
+//For each gait, the part of the cycle a foot is on the ground, followed by the phase offset of each leg (in leg
+// index order: FRONT_LEFT, MIDDLE_LEFT, REAR_LEFT, REAR_RIGHT, MIDDLE_RIGHT, FRONT_RIGHT).  A leg with a larger
+// offset is further through its cycle, so steps earlier.
+static const uint16_t gaits[GAIT_TYPE_COUNT][LEG_COUNT + 1] = {
+	//Tripod: front left, rear left and middle right together, then the other three
+	{ 32768,	0, 32768, 0, 32768, 0, 32768 },
+	//Ripple: each side rear, middle, front a third of a cycle apart, with the right side half a cycle behind the left
+	{ 43691,	0, 21845, 43691, 10923, 54613, 32768 },
+	//Wave: rear right, middle right, front right, rear left, middle left, front left, a sixth of a cycle apart
+	{ 54613,	0, 10923, 21845, 54613, 43691, 32768 },
+};
+
+void gait_init(gait_t* gait, const uint16_t* mounting){
+	for (uint8_t l = 0; l < LEG_COUNT; l++){
+		gait->mounting_cos[l] = cos_q(mounting[l]);
+		gait->mounting_sin[l] = sin_q(mounting[l]);
+	}
+	gait_set_type(gait, GAIT_TRIPOD, GAIT_STRIDE, GAIT_LIFT, GAIT_SWING_TIME, 5);
+	gait_set_velocity(gait, 0, 0, 0);
+	gait_restart(gait);
+}
+
+void gait_set_type(gait_t* gait, uint8_t type, uint8_t stride, uint8_t lift, uint16_t swing_time, uint8_t interval){
+	if (type >= GAIT_TYPE_COUNT) type = GAIT_TRIPOD;
+	gait->type = type;
+	gait->stride = stride;
+	gait->lift = lift;
+	gait->duty = gaits[type][0];
+	gait->offset = &gaits[type][1];
+
+	uint16_t swing = (uint16_t) (0 - gait->duty);
+	gait->rate = ((uint32_t) swing * interval + (swing_time >> 1)) / swing_time;
+	gait->stance_scale = ((uint32_t) 1 << 24) / (gait->duty >> 4);
+	gait->swing_scale = ((uint32_t) 1 << 24) / (swing >> 4);
+}
+
+void gait_set_velocity(gait_t* gait, int16_t linear, uint16_t angle, int16_t rotational){
+	//Stride (mm) * velocity (Q8) * cos / sin (Q14) is Q22; we want 1/16 mm
+	int32_t linear_x = (int32_t) gait->stride * linear * cos_q(angle);
+	int32_t linear_y = (int32_t) gait->stride * linear * sin_q(angle);
+	for (uint8_t l = 0; l < LEG_COUNT; l++){
+		//Turning moves each foot along the tangent to its leg, (-sin, cos) of the mounting angle.  The stance
+		// goes against the stride vector, so for clockwise rotation the feet push counter clockwise.
+		int32_t rotational_x = (int32_t) gait->stride * rotational * gait->mounting_sin[l];
+		int32_t rotational_y = -(int32_t) gait->stride * rotational * gait->mounting_cos[l];
+		gait->target_x[l] = (linear_x + rotational_x + ((int32_t) 1 << 17)) >> 18;
+		gait->target_y[l] = (linear_y + rotational_y + ((int32_t) 1 << 17)) >> 18;
+	}
+}
+
+//Moves value towards target by at most GAIT_SLEW
+static int16_t slew(int16_t value, int16_t target){
+	if (target > value + GAIT_SLEW) return value + GAIT_SLEW;
+	else if (target < value - GAIT_SLEW) return value - GAIT_SLEW;
+	else return target;
+}
+
+void gait_next(gait_t* gait, Point* offset){
+	gait->phase += gait->rate;
+
+	uint8_t moving = 0;
+	for (uint8_t l = 0; l < LEG_COUNT; l++){
+		if (gait->target_x[l] || gait->target_y[l]) moving = 1;
+	}
+	gait->height = slew(gait->height, moving ? (gait->lift << 4) : 0);
+
+	for (uint8_t l = 0; l < LEG_COUNT; l++){
+		gait->stride_x[l] = slew(gait->stride_x[l], gait->target_x[l]);
+		gait->stride_y[l] = slew(gait->stride_y[l], gait->target_y[l]);
+
+		uint16_t phase = gait->phase + gait->offset[l];
+		int16_t along;			//Position along the stride, Q12 from -2048 (back) to 2048 (front)
+		int16_t z;
+
+		if (phase < gait->duty){
+			//Stance: the foot is on the ground, moving back at a constant speed
+			uint16_t fraction = ((uint32_t) (phase >> 4) * gait->stance_scale) >> 12;
+			along = 2048 - fraction;
+			z = 0;
+		}
+		else {
+			//Swing: the foot lifts and moves forward, easing in and out so it is not moving along the ground at
+			// either end.  Fraction is Q12, so << 3 makes it half a turn.
+			uint16_t fraction = ((uint32_t) ((uint16_t) (phase - gait->duty) >> 4) * gait->swing_scale) >> 12;
+			along = -(cos_q(fraction << 3) >> 3);
+			z = ((int32_t) gait->height * sin_q(fraction << 3) + ((int32_t) 1 << 17)) >> 18;
+		}
+
+		//1/16 mm * Q12 is Q16
+		offset[l].x = ((int32_t) gait->stride_x[l] * along + ((int32_t) 1 << 15)) >> 16;
+		offset[l].y = ((int32_t) gait->stride_y[l] * along + ((int32_t) 1 << 15)) >> 16;
+		offset[l].z = z;
+	}
+}
+
+uint8_t gait_stopped(gait_t* gait){
+	if (gait->height) return 0;
+	for (uint8_t l = 0; l < LEG_COUNT; l++){
+		if (gait->stride_x[l] || gait->stride_y[l] || gait->target_x[l] || gait->target_y[l]) return 0;
+	}
+	return 1;
+}
+
+void gait_restart(gait_t* gait){
+	//Start with the legs at phase 0 in the middle of their stance, where the foot is at neutral; for the tripod
+	// gait the other three are then in the middle of their swing, and start lifting as the height slews up.
+	gait->phase = gait->duty >> 1;
+	gait->height = 0;
+	for (uint8_t l = 0; l < LEG_COUNT; l++){
+		gait->stride_x[l] = 0;
+		gait->stride_y[l] = 0;
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef GAIT_GENERATOR_H
+#define GAIT_GENERATOR_H
+
+#include <avr/io.h>
+
+#include "../hardware.h"
+#include "../types/Point.h"
+
+/*
+ * Parametric gait generator.  Rather than stepping through a table of foot positions, each foot follows a
+ * trajectory worked out from a few parameters: the stride (how far the foot moves while it is on the ground,
+ * at full velocity), the lift height, and the time a foot takes to swing forward.  The gait type decides
+ * which part of the cycle each foot spends on the ground (the duty) and the phase offset of each leg:
+ *  GAIT_TRIPOD: two groups of three legs, alternating.  Fastest, with three feet down at all times.
+ *  GAIT_RIPPLE: each side steps rear to front, the sides half a cycle apart.  Four or more feet down.
+ *  GAIT_WAVE: one leg at a time, rear to front on each side.  Slowest, with five feet down.
+ *
+ * All the work is in fixed point: the cycle is a 16 bit phase (65536 is a full cycle), and gait_next() is a
+ * constant amount of work for each leg (a sin_q / cos_q lookup and a few multiplies).  Linear and rotational
+ * velocity are combined into a single stride vector for each foot whenever they change, in gait_set_velocity(),
+ * so moving and turning at the same time costs no more per tick than either on its own.  The stride vectors and
+ * the lift height move towards their targets by at most GAIT_SLEW each tick, so that the feet do not jump when
+ * the velocity changes, and stopping (a velocity of zero) brings the feet smoothly back to neutral.
+ */
+
+#define GAIT_TRIPOD				0
+#define GAIT_RIPPLE				1
+#define GAIT_WAVE				2
+#define GAIT_TYPE_COUNT			3
+
+//The distance in mm a foot moves while on the ground at full velocity; the foot goes from half this ahead of
+// neutral to half this behind.
+#ifndef GAIT_STRIDE
+#define GAIT_STRIDE				50
+#endif
+//How high in mm to lift the feet.  Leg::setOffset() will not go more than 15mm from neutral.
+#ifndef GAIT_LIFT
+#define GAIT_LIFT				15
+#endif
+//How long a foot takes to swing forward, in ms.  The whole cycle is longer for gaits with a higher duty.
+#ifndef GAIT_SWING_TIME
+#define GAIT_SWING_TIME			300
+#endif
+//The most the stride vectors and lift height change in a tick, in 1/16 mm
+#ifndef GAIT_SLEW
+#define GAIT_SLEW				16
+#endif
+
+typedef struct gait {
+	uint16_t phase;						//Position in the cycle; 65536 is a full cycle
+	uint16_t rate;						//Phase added each tick
+	uint16_t duty;						//Part of the cycle each foot is on the ground
+	uint32_t stance_scale;				//Reciprocals of the stance and swing lengths (Q24 / (length >> 4))
+	uint32_t swing_scale;
+	const uint16_t* offset;				//Phase offset of each leg
+	uint8_t type;
+	uint8_t stride;
+	uint8_t lift;
+	int16_t mounting_cos[LEG_COUNT];	//Q14
+	int16_t mounting_sin[LEG_COUNT];
+	int16_t height;						//Lift height now, in 1/16 mm
+	int16_t stride_x[LEG_COUNT];		//Foot travel during the swing now, in 1/16 mm
+	int16_t stride_y[LEG_COUNT];
+	int16_t target_x[LEG_COUNT];		//Foot travel for the last velocity set
+	int16_t target_y[LEG_COUNT];
+} gait_t;
+
+/*
+ * Sets up the gait with each leg's mounting angle (as dcmath fractions of a turn, in leg index order).  Starts
+ * as a tripod gait with the default parameters, standing still.
+ */
+void gait_init(gait_t* gait, const uint16_t* mounting);
+
+/*
+ * Changes the gait type and parameters; the tick interval is in ms.  The phase offsets jump to the new gait's,
+ * so only change this while standing still.
+ */
+void gait_set_type(gait_t* gait, uint8_t type, uint8_t stride, uint8_t lift, uint16_t swing_time, uint8_t interval);
+
+/*
+ * Sets the velocity: linear and rotational are Q8 (256 is full speed, rotational is positive for clockwise),
+ * and the direction of linear movement is a dcmath fraction of a turn.  The feet stop lifting when both are 0.
+ */
+void gait_set_velocity(gait_t* gait, int16_t linear, uint16_t angle, int16_t rotational);
+
+/*
+ * Advances the gait by one tick, and puts each foot's offset from neutral (in mm, for Leg::setOffset()) into
+ * offset[0..LEG_COUNT-1].
+ */
+void gait_next(gait_t* gait, Point* offset);
+
+/*
+ * Returns 1 once the gait has come to a stop after a velocity of zero, with every foot at neutral.
+ */
+uint8_t gait_stopped(gait_t* gait);
+
+/*
+ * Puts the gait back to the start of its cycle, with the first legs mid stance, and from a standstill.
+ */
+void gait_restart(gait_t* gait);
+
+#endif
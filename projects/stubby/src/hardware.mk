@@ -30,6 +30,11 @@
 #Defaults to 400000L
 #TWI_FREQ=400000L
 
+#Which inverse kinematics engine to use: 0 for the floating point solver, 1 for the fixed point solver, or 2 for
+# tables of the servo linkages precomputed at startup (uses about 500 bytes of SRAM).  See ik/ik.h.
+#Defaults to 1
+#IK_ENGINE=1
+
 #Change the AVR programmer if needed.  Defaults to usbtiny
 #AVRDUDE_PROGRAMMER=stk500v2
 
@@ -1,15 +1,17 @@
 #include "pwm.h"
 
+#include <stddef.h>
+
 typedef struct pwm_pin_t {
-	volatile uint8_t *port;
-	uint8_t pin;
 	uint16_t compare_value;
+	uint8_t mask;			//_BV(pin)
+	uint8_t offset;			//Offset of this pin's port mask in pwm_event_t, or 0 if the port is not used for PWM
 } pwm_pin_t;
 
 typedef struct pwm_event_t {
-	//Only used in OCR1B; ignored for high event in OCR1A.  This is the value which TCNT1 is firing 
-	// on *now*; you need to reference the next element in the array to get the value which is 
-	// to be reset for next time.
+	//Only used in OCR1B; ignored for high event in OCR1A.  This is the value which TCNT1 is firing
+	// on *now*; you need to reference the next element in the array to get the value which is
+	// to be reset for next time.  The layout of this struct is used by pwm_fast.S.
 	uint16_t compare_value;
 
 	//Port masks
@@ -27,13 +29,20 @@ typedef struct pwm_event_t {
 #endif
 } pwm_event_t;
 
+//The events for one period: the high event for OCR1A, and the low events in order of compare value for OCR1B,
+// ending with one at 0xFFFF (which never fires).
+typedef struct pwm_events_t {
+	pwm_event_t high;
+	pwm_event_t low[PWM_MAX_PINS + 1];
+} pwm_events_t;
+
 
-volatile void* _pwm_events_low_ptr;								//Pointer to current value in _pwm_events_low.  Reset in OCR1A, incremented in OCR1B.
+volatile void* _pwm_events_low_ptr;								//Pointer to current value in the active low events.  Reset in OCR1A, incremented in OCR1B.
 
 
 static uint8_t _set_phase_batch = 0;							//Set to 1 when set_phase_batch is called with a changed value.
-static volatile uint8_t _set_phase = 0;							//Set to 1 when phase is re-calculated; signals that the ISR COMPA needs to re-load phase values.
-static volatile uint8_t _set_phase_lock = 0; 					//Set to 1 when we are in set_phase function.  Prevents OCR1A from copying the double buffered pwm_events when this is 0.
+static volatile uint8_t _set_phase = 0;							//Set to 1 when phase is re-calculated; signals that the ISR COMPA needs to switch to the new events.
+static volatile uint8_t _set_phase_lock = 0; 					//Set to 1 when we are in set_phase function.  Prevents OCR1A from switching events while this is 1.
 static volatile uint8_t _set_stop = 0;							//Set to 1 when stop is requested.  ISR COMPA will turn off timer.
 
 static uint16_t _set_period = 0; 								//New period defined; set in set_period, and updated to OCR1A in changed in COMPA interrupt
@@ -42,35 +51,29 @@ static uint16_t _set_period = 0; 								//New period defined; set in set_period
 static pwm_pin_t _pwm_pins[PWM_MAX_PINS];						//Array of pins.  Index is important here, as that is how we refer to the pins from the outside world.
 static uint8_t _count;											//How many pins should be used
 
-static pwm_event_t _pwm_event_high;								//PWM event to set all pins high at start of period.  Calculated on a non-zero set_phase.
-static pwm_event_t _pwm_event_high_new;							//Double buffer of pwm high event; copied to pwm_events in OCR1A when _set_phase is non-zero.
+static uint8_t _pwm_order[PWM_MAX_PINS];						//Pin indices in order of compare value.  Kept between calls to pwm_apply_batch(), so that re-sorting after small changes is cheap.
 
-static pwm_event_t _pwm_events_low[PWM_MAX_PINS + 1];			//Array of pwm events.  Each event will set one or more pins low.
-static pwm_event_t _pwm_events_low_new[PWM_MAX_PINS + 1];		//Double buffer of pwm events.  Calculated in each set_phase call; copied to pwm_events in OCR1A when _set_phase is non-zero.
+static pwm_events_t _pwm_events[2];								//Double buffered events; the ISRs use _pwm_events[_active], and pwm_apply_batch() builds the other one.
+static volatile uint8_t _active = 0;
 
 static uint16_t _prescaler = 0x0;								//Numeric prescaler (1, 8, etc).  Required for _pwm_micros_to_clicks calls.
 static uint8_t _prescaler_mask = 0x0;							//Prescaler mask corresponding to _prescaler
+static uint16_t _event_gap = 0;									//Closest two low events can be, in clicks, so that COMPB is done with one before the next
+static uint16_t _first_event = 0;								//Earliest a low event can be, in clicks, so that COMPA is done first
 
 
 static uint16_t _pwm_micros_to_clicks(uint32_t micros){
 	//There is a potential for an overflow here if micros * (F_CPU in MHz) does not fit into
 	// a 32 bit variable.  If this happens, we can divide micros by prescaler before multiplying
 	// with F_CPU, although this will give a loss of precision.  Leave as-is for now.
-	return (((F_CPU / 1000000) * micros) / _prescaler) & 0xFFF0;
-	
-	//TODO Rounding, based on 10MHz clock and various prescalers:
-	//Prescaler: 1, AND with 0xFF80
-	//Prescaler: 8, AND with 0xFFF0
-	//Prescaler: 64, AND with 0xFFFE
-	//Other prescalers should be fine as-is...
-	//More testing at different F_CPU values and prescalers are still required.
+	return (((F_CPU / 1000000) * micros) + (_prescaler >> 1)) / _prescaler;
 }
 
 /*
- * Note: We extrapolate the DDR registers based off of the associated PORT 
+ * Note: We extrapolate the DDR registers based off of the associated PORT
  * register.  This assumes that the DDR registers come directly after the PORT
- * equivalents, with DDRX at the next address after PORTX.  This is valid for 
- * all the chips I have looked at; however, it is highly recommended that you 
+ * equivalents, with DDRX at the next address after PORTX.  This is valid for
+ * all the chips I have looked at; however, it is highly recommended that you
  * check any new chips which you want to use this library with.
  */
 void pwm_init(volatile uint8_t *ports[],
@@ -79,14 +82,37 @@ void pwm_init(volatile uint8_t *ports[],
 				uint32_t period) {
 
 	_count = (count <= PWM_MAX_PINS ? count : PWM_MAX_PINS);
-	
-	//Store values
+
+	//Store values.  Each pin's port is looked up here once, as the offset of its mask in pwm_event_t, so that
+	// pwm_apply_batch() does not need to compare port addresses.
 	for (uint8_t i = 0; i < _count; i++){
-		_pwm_pins[i].port = ports[i];
-		_pwm_pins[i].pin = pins[i];
-		*(_pwm_pins[i].port - 0x1) |= _BV(_pwm_pins[i].pin);
+		volatile uint8_t* port = ports[i];
+		_pwm_pins[i].compare_value = 0;
+		_pwm_pins[i].mask = _BV(pins[i]);
+		_pwm_pins[i].offset = 0;
+#ifndef PWM_PORTA_UNUSED
+		if (port == &PORTA) _pwm_pins[i].offset = offsetof(pwm_event_t, porta_mask);
+#endif
+#ifndef PWM_PORTB_UNUSED
+		if (port == &PORTB) _pwm_pins[i].offset = offsetof(pwm_event_t, portb_mask);
+#endif
+#ifndef PWM_PORTC_UNUSED
+		if (port == &PORTC) _pwm_pins[i].offset = offsetof(pwm_event_t, portc_mask);
+#endif
+#ifndef PWM_PORTD_UNUSED
+		if (port == &PORTD) _pwm_pins[i].offset = offsetof(pwm_event_t, portd_mask);
+#endif
+		_pwm_order[i] = i;
+		*(port - 0x1) |= _BV(pins[i]);
 	}
-	
+
+	//Nothing is high until the first pwm_apply_batch()
+	for (uint8_t b = 0; b < 2; b++){
+		uint8_t* high = (uint8_t*) &_pwm_events[b].high;
+		for (uint8_t i = offsetof(pwm_event_t, compare_value) + 2; i < sizeof(pwm_event_t); i++) high[i] = 0x00;
+		_pwm_events[b].low[0].compare_value = 0xFFFF;
+	}
+
 	//This is calculated by the focumula:
 	// CUTOFF_VALUE = PRESCALER * MAX_VALUE / (F_CPU / 1000000)
 	// where CUTOFF_VALUE is the period comparison for each if block,
@@ -98,14 +124,14 @@ void pwm_init(volatile uint8_t *ports[],
 #else
 	uint32_t max_value = 65535;
 #endif
-	
+
 	if (period < (1 * max_value / (F_CPU / 1000000))){
 		_prescaler = 1;
 		_prescaler_mask = _BV(CS10);
 	}
 	else if (period < (8 * max_value / (F_CPU / 1000000))){
 		_prescaler = 8;
-		_prescaler_mask = _BV(CS11);	
+		_prescaler_mask = _BV(CS11);
 	}
 	else if (period < (64 * max_value / (F_CPU / 1000000))){
 		_prescaler = 64;
@@ -124,22 +150,27 @@ void pwm_init(volatile uint8_t *ports[],
 		_prescaler = 1024;
 		_prescaler_mask = _BV(CS12) | _BV(CS10);
 	}
-				
+
+	//Round the ISR times (see pwm.h) up to whole clicks, plus one for the compare match to be seen
+	_event_gap = (PWM_COMPB_CYCLES + PWM_OTHER_ISR_CYCLES + _prescaler - 1) / _prescaler + 1;
+	_first_event = (PWM_COMPA_CYCLES + PWM_OTHER_ISR_CYCLES + _prescaler - 1) / _prescaler + 1;
+
+	//CTC mode, so that the timer restarts at OCR1A in hardware, and the period does not depend on COMPA
 	TCCR1A = 0x00;
-	TCCR1B |= _prescaler_mask;
-	
+	TCCR1B |= _BV(WGM12) | _prescaler_mask;
+
 	//OCR1A controls the PWM period
 	OCR1A = _pwm_micros_to_clicks(period);
 	//OCR1B controls the PWM phase.  It is initialized later.
-	
+
 	//Enable compare interrupt on both channels
 	TIMSK1 = _BV(OCIE1A) | _BV(OCIE1B);
-	
+
 	//Enable interrupts if the NO_INTERRUPT_ENABLE define is not set.  If it is, you need to call sei() elsewhere.
 #ifndef NO_INTERRUPT_ENABLE
 	sei();
 #endif
-	
+
 	//Force interrupt on compare A initially
 	TCCR1C |= _BV(FOC1A);
 }
@@ -147,22 +178,13 @@ void pwm_init(volatile uint8_t *ports[],
 void pwm_start(){
 	TCNT1 = 0x00;	//Restart timer counter
 	TIMSK1 = _BV(OCIE1A) | _BV(OCIE1B);	//Enable output compare match interrupt enable
-	TCCR1B |= _prescaler_mask;	//Enable
+	TCCR1B |= _BV(WGM12) | _prescaler_mask;	//Enable
 }
 
 void pwm_stop(){
 	_set_stop = 1;
 }
 
-//The comparison method used to sort pwm_pin variables
-static int16_t _compare_values(const void *pin1, const void *pin2){
-	 const pwm_pin_t *pwm1 = (const pwm_pin_t*) pin1;
-	 const pwm_pin_t *pwm2 = (const pwm_pin_t*) pin2;
-	 if (pwm1->compare_value < pwm2->compare_value) return -1;
-	 else if (pwm1->compare_value > pwm2->compare_value) return 1;
-	 else return 0;
-}
-
 void pwm_set_phase(uint8_t index, uint32_t phase, uint8_t counter){
 	pwm_set_phase_batch(index, phase, counter);
 	pwm_apply_batch();
@@ -173,9 +195,10 @@ void pwm_set_phase_batch(uint8_t index, uint32_t phase, uint8_t counter){
 	if (index >= _count) {
 		return;
 	}
-	
-	//The new compare value, in clock ticks
+
+	//The new compare value, in clock ticks.  Anything but 0 (never high) has to leave time for COMPA.
 	uint16_t new_clicks = _pwm_micros_to_clicks(phase);
+	if (new_clicks > 0 && new_clicks < _first_event) new_clicks = _first_event;
 	pwm_pin_t *p = &(_pwm_pins[index]);
 
 	if (p->compare_value != new_clicks){
@@ -189,107 +212,66 @@ void pwm_apply_batch(){
 	if (_set_phase_batch == 0){
 		return;	//No need to re-calculate if there was no changed phases.
 	}
-	
+
 	_set_phase_lock = 1;
 
-	//Copy _pwm_pins to _pwm_pins_sorted, and then sort it by value
-	pwm_pin_t _pwm_pins_sorted[PWM_MAX_PINS];
-	for (uint8_t i = 0; i < _count; i++){
-		_pwm_pins_sorted[i] = _pwm_pins[i];
+	//Bring _pwm_order back into order with an insertion sort.  Between batches the phases usually only move a
+	// little, so the order is nearly right already, and this is close to a single pass.
+	for (uint8_t i = 1; i < _count; i++){
+		uint8_t pin = _pwm_order[i];
+		uint16_t compare_value = _pwm_pins[pin].compare_value;
+		uint8_t j = i;
+		while (j > 0 && _pwm_pins[_pwm_order[j - 1]].compare_value > compare_value){
+			_pwm_order[j] = _pwm_order[j - 1];
+			j--;
+		}
+		_pwm_order[j] = pin;
 	}
-	qsort(_pwm_pins_sorted, _count, sizeof _pwm_pins_sorted[0], _compare_values);
 
-	//Populate the _pwm_events_high variable and _pwm_events_low_new array, used in 
-	// OCR1A and OCR1B respectively to turn pins on / off.
-	//First we reset everything in this array...
-#ifndef PWM_PORTA_UNUSED
-	_pwm_event_high_new.porta_mask = 0x00;
-#endif
-#ifndef PWM_PORTB_UNUSED
-	_pwm_event_high_new.portb_mask = 0x00;
-#endif
-#ifndef PWM_PORTC_UNUSED
-	_pwm_event_high_new.portc_mask = 0x00;
-#endif
-#ifndef PWM_PORTD_UNUSED
-	_pwm_event_high_new.portd_mask = 0x00;
-#endif
-	for (uint8_t i = 0; i < _count + 1; i++){
-		_pwm_events_low_new[i].compare_value = 0xFFFF;
-#ifndef PWM_PORTA_UNUSED
-		_pwm_events_low_new[i].porta_mask = 0xFF;
-#endif
-#ifndef PWM_PORTB_UNUSED
-		_pwm_events_low_new[i].portb_mask = 0xFF;
-#endif
-#ifndef PWM_PORTC_UNUSED
-		_pwm_events_low_new[i].portc_mask = 0xFF;
-#endif
-#ifndef PWM_PORTD_UNUSED
-		_pwm_events_low_new[i].portd_mask = 0xFF;
-#endif
+	//Build the events for the next period into the buffer which the ISRs are not using.  Pins are set low
+	// together in a single event when they are within _event_gap of the first of them, so that each COMPB is
+	// always finished before the next one is due.
+	pwm_events_t* events = &(_pwm_events[_active ^ 0x01]);
+	uint8_t* high = (uint8_t*) &(events->high);
+	for (uint8_t i = offsetof(pwm_event_t, compare_value) + 2; i < sizeof(pwm_event_t); i++){
+		high[i] = 0x00;
 	}
-	//... then we look through the sorted _pwm_pins list, and collect all of the ports / pins which are
-	// set at the same compare values into a single event.
-	uint16_t last_compare_value = _pwm_pins_sorted[0].compare_value;
-	uint8_t last_index = 0;
-	
+
+	pwm_event_t* e = events->low;
+	uint8_t* low = (uint8_t*) e;
+	uint8_t used = 0;
 	for (uint8_t i = 0; i < _count; i++){
-		pwm_pin_t *p = &(_pwm_pins_sorted[i]);
-		if (p->compare_value > last_compare_value){
-			//We don't want an empty pwm_event at the beginning of the array, so verify whether last_compare_value was zero before incrementing
-			if (last_compare_value > 0) {
-				last_index++;
+		pwm_pin_t *p = &(_pwm_pins[_pwm_order[i]]);
+		if (p->compare_value == 0 || p->offset == 0){
+			continue;	//Never set high
+		}
+
+		if (!used || p->compare_value >= e->compare_value + _event_gap){
+			if (used) e++;
+			used = 1;
+			e->compare_value = p->compare_value;
+			low = (uint8_t*) e;
+			for (uint8_t m = offsetof(pwm_event_t, compare_value) + 2; m < sizeof(pwm_event_t); m++){
+				low[m] = 0xFF;
 			}
-			last_compare_value = p->compare_value;
 		}
 
-		if (p->compare_value > 0){
-			//Set pins to high
-#ifndef PWM_PORTA_UNUSED
-			if (p->port == &PORTA) _pwm_event_high_new.porta_mask |= _BV(p->pin);
-			else
-#endif
-#ifndef PWM_PORTB_UNUSED
-			if (p->port == &PORTB) _pwm_event_high_new.portb_mask |= _BV(p->pin);
-			else
-#endif
-#ifndef PWM_PORTC_UNUSED
-			if (p->port == &PORTC) _pwm_event_high_new.portc_mask |= _BV(p->pin);
-			else
-#endif
-#ifndef PWM_PORTD_UNUSED
-			if (p->port == &PORTD) _pwm_event_high_new.portd_mask |= _BV(p->pin);
-			else
-#endif
-			if (0);	//Nop so that ignored ports dont break things
+		//Set pins to high in COMPA, and to low in this event
+		high[p->offset] |= p->mask;
+		low[p->offset] &= ~p->mask;
+	}
 
-			//Set pins to low
-			pwm_event_t *e = &(_pwm_events_low_new[last_index]);
-			e->compare_value = last_compare_value;
-#ifndef PWM_PORTA_UNUSED
-			if (p->port == &PORTA) e->porta_mask &= ~_BV(p->pin);
-			else
-#endif
-#ifndef PWM_PORTB_UNUSED
-			if (p->port == &PORTB) e->portb_mask &= ~_BV(p->pin);
-			else
-#endif
-#ifndef PWM_PORTC_UNUSED
-			if (p->port == &PORTC) e->portc_mask &= ~_BV(p->pin);
-			else
-#endif
-#ifndef PWM_PORTD_UNUSED
-			if (p->port == &PORTD) e->portd_mask &= ~_BV(p->pin);
-			else
-#endif
-			if (0);	//Nop so that ignored ports dont break things
-		}
+	//End with an event which never fires
+	if (used) e++;
+	e->compare_value = 0xFFFF;
+	low = (uint8_t*) e;
+	for (uint8_t m = offsetof(pwm_event_t, compare_value) + 2; m < sizeof(pwm_event_t); m++){
+		low[m] = 0xFF;
 	}
 
 	_set_phase_batch = 0;
 
-	//Signal OCR1A that we are ready to load new values
+	//Signal OCR1A that we are ready to switch to the new events
 	_set_phase = 1;
 	_set_phase_lock = 0;
 }
@@ -300,8 +282,9 @@ void pwm_set_period(uint32_t period){
 
 
 
-/* 
- * The frequency comparison.  When it overflows, we reset the timer to 0.
+/*
+ * The frequency comparison.  The timer restarts at 0 in hardware (CTC mode).  This takes the same time
+ * whether or not there are new events, as switching to them is just a change of buffer.
  */
 #ifdef PWM_8_BIT
 EMPTY_INTERRUPT(TIM0_OVF_vect)
@@ -310,71 +293,68 @@ ISR(TIM0_COMPA_vect){
 EMPTY_INTERRUPT(TIMER1_OVF_vect)
 ISR(TIMER1_COMPA_vect){
 #endif
-	//Update values if needed
+	//Switch to the new events if needed
 	if (_set_phase && !_set_phase_lock){
-		for (uint8_t i = 0; i < _count; i++){
-			_pwm_events_low[i] = _pwm_events_low_new[i];
-		}
-		_pwm_event_high = _pwm_event_high_new;
+		_active ^= 0x01;
 		_set_phase = 0;
 	}
-	if (_set_period){
-		OCR1A = _set_period;
-		_set_period = 0;
-	}
+	pwm_events_t* events = &(_pwm_events[_active]);
+
 	if (_set_stop){
 		TCCR1B = 0x00;
-		
+
 #ifndef PWM_PORTA_UNUSED
-		PORTA &= ~_pwm_event_high.porta_mask;
+		PORTA &= ~events->high.porta_mask;
 #endif
 #ifndef PWM_PORTB_UNUSED
-		PORTB &= ~_pwm_event_high.portb_mask;
+		PORTB &= ~events->high.portb_mask;
 #endif
 #ifndef PWM_PORTC_UNUSED
-		PORTC &= ~_pwm_event_high.portc_mask;
+		PORTC &= ~events->high.portc_mask;
 #endif
 #ifndef PWM_PORTD_UNUSED
-		PORTD &= ~_pwm_event_high.portd_mask;
+		PORTD &= ~events->high.portd_mask;
 #endif
-		
+
 		_set_stop = 0;
 		return;
 	}
-	//Reset counter after the new compare values are updated (otherwise it affects the phase 
-	// of the next execution, causing jitter).
-	TCNT1 = 0;	
-	
-	//Set to the first (sorted) compare value in the pwm_events_low array.  This is calculated 
-	// in pwm_apply_batch(), and updated above in this ISR.
-	_pwm_events_low_ptr = (void*) _pwm_events_low;
-	OCR1B = _pwm_events_low[0].compare_value;
-	
-	//Set pins high.  We do this after re-enabling the clock so that we do not artificially increase 
-	// the phase.  We turn off the ports (in COMPB) in the same order that we turn them on here,
+
+	//Set pins high.  We turn off the ports (in COMPB) in the same order that we turn them on here,
 	// so that the delta of any delay between PORTA and PORTD should be reduced or eliminated.
 #ifndef PWM_PORTA_UNUSED
-	PORTA |= _pwm_event_high.porta_mask;
+	PORTA |= events->high.porta_mask;
 #endif
 #ifndef PWM_PORTB_UNUSED
-	PORTB |= _pwm_event_high.portb_mask;
+	PORTB |= events->high.portb_mask;
 #endif
 #ifndef PWM_PORTC_UNUSED
-	PORTC |= _pwm_event_high.portc_mask;
+	PORTC |= events->high.portc_mask;
 #endif
 #ifndef PWM_PORTD_UNUSED
-	PORTD |= _pwm_event_high.portd_mask;
+	PORTD |= events->high.portd_mask;
 #endif
+
+	//Set to the first (sorted) compare value in the low events.  This is calculated in pwm_apply_batch().
+	_pwm_events_low_ptr = (void*) events->low;
+	OCR1B = events->low[0].compare_value;
+
+	if (_set_period){
+		OCR1A = _set_period;
+		_set_period = 0;
+	}
 }
 
-/* 
+/*
  * The phase comparison, implemented in C.  When it overflows, we find the next highest value.
- * For a faster alternative, comment this out and use the ASM version in pwm.S
- *
+ * The firmware uses the faster ASM version in pwm_fast.S; define PWM_COMPB_C to build this one instead
+ * (the host simulation does).
+ */
+#ifdef PWM_COMPB_C
 ISR(TIMER1_COMPB_vect){
 	pwm_event_t* e = (pwm_event_t*) _pwm_events_low_ptr;
 	_pwm_events_low_ptr = (uint8_t*) _pwm_events_low_ptr + sizeof(pwm_event_t);
-	
+
 #ifndef PWM_PORTA_UNUSED
 	PORTA &= e->porta_mask;
 #endif
@@ -387,8 +367,8 @@ ISR(TIMER1_COMPB_vect){
 #ifndef PWM_PORTD_UNUSED
 	PORTD &= e->portd_mask;
 #endif
-	
+
 	//Set the timer for the next lowest value.
 	OCR1B = ((pwm_event_t*) _pwm_events_low_ptr)->compare_value;
 }
-*/
+#endif
@@ -25,15 +25,46 @@
 
 //The absolute maximum number of pins defined.  The actual 'used' count is passed
 // into pwm_init, and there is no problem with having a larger number here than is
-// actually used (other than a bit of wasted SRAM space for pre-defined arrays).
-// By default we set this to 4 as that is a decently large number, but not so huge
-// that tons of excess SRAM is wasted.  If you are low on memory, or need more
-// outputs, feel free to redefine this in your makefile (in the CDEFS variable,
+// actually used (other than a bit of wasted SRAM space for pre-defined arrays; each
+// pin costs 17 bytes with all four ports in use).  By default we set this to 24, which
+// is enough for a hexapod with a few spare outputs.  If you are low on memory, or need
+// more outputs, feel free to redefine this in your makefile (in the CDEFS variable,
 // beside where F_CPU is defined).
 #ifndef PWM_MAX_PINS
-#define PWM_MAX_PINS 4
+#define PWM_MAX_PINS 24
 #endif
 
+//Worst case length of the ISRs, in CPU cycles, from the compare match to the RETI, including
+// the interrupt response and the jump from the vector table.  PWM_COMPB_CYCLES is counted
+// from pwm_fast.S with all four ports in use; PWM_COMPA_CYCLES is an estimate for the C ISR
+// at -Os, and should be re-checked against the listing if the compiler changes.
+#ifndef PWM_COMPA_CYCLES
+#define PWM_COMPA_CYCLES 120
+#endif
+#ifndef PWM_COMPB_CYCLES
+#define PWM_COMPB_CYCLES 71
+#endif
+
+//Cycles from the compare match to the last port write in COMPB, and in COMPA.
+#define PWM_COMPB_EDGE 44
+#define PWM_COMPA_EDGE 64
+
+//The longest that any other ISR (or code running with interrupts disabled) can hold off the
+// PWM ISRs, in CPU cycles.  On Stubby this is USART0_RX, which calls SerialAVR::isr() and so
+// saves all the call clobbered registers.
+#ifndef PWM_OTHER_ISR_CYCLES
+#define PWM_OTHER_ISR_CYCLES 128
+#endif
+
+//Low events which are closer together than PWM_COMPB_CYCLES + PWM_OTHER_ISR_CYCLES are merged
+// into a single event (so those pins go low together, early by up to that much), and no event
+// is set sooner than PWM_COMPA_CYCLES + PWM_OTHER_ISR_CYCLES after the start of the period.  This
+// way each ISR has set OCR1B before the next compare value comes around, even when it was held
+// off, and so no event is ever missed.  Each pin goes low PWM_COMPB_EDGE cycles after its compare
+// match (PWM_COMPA_EDGE after it for going high), and the only jitter is the time other ISRs
+// hold off the PWM ISRs: each edge is late by at most PWM_OTHER_ISR_CYCLES, plus 4 cycles to
+// finish the instruction which was running.  At 20MHz, that is 6.6us.
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -87,6 +118,9 @@ void pwm_set_phase_batch(uint8_t index, uint32_t phase, uint8_t counter);
 
 /*
  * Recalculates all pin / timer values.  Required after calling pwm_set_phase_batch().
+ * The pins are kept in order of phase between calls, so when only a few phases have changed
+ * by a small amount this is a single pass over the pins.  The new values are built into a
+ * second buffer, which the timer switches to at the start of the next period.
  */
 void pwm_apply_batch();
 
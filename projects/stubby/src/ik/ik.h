@@ -0,0 +1,65 @@
+#ifndef IK_H
+#define IK_H
+
+#include <stdint.h>
+
+#include "../Leg.h"
+
+/*
+ * Inverse kinematics for a single leg: finds the servo phases which put the foot at a point in the leg's own
+ * frame, where the coxa joint is at 0,0,0 and the leg is pointing straight out along X (see figures 2.1 - 2.4).
+ * Co-ordinates are in 1/IK_SCALE mm.  The phases are offsets from PHASE_NEUTRAL in µs (before calibration),
+ * for the TIBIA, FEMUR and COXA joints.
+ *
+ * There are three engines, selected at build time with IK_ENGINE (see hardware.mk):
+ *  IK_ENGINE_DOUBLE: the original floating point solver, using sqrt / atan2 and the dcmath lookups.
+ *  IK_ENGINE_FIXED: the same equations in closed form, in fixed point using the dcmath *_q functions.
+ *  IK_ENGINE_TABLE: the joint angles as for IK_ENGINE_FIXED, but the servo linkages (the trapezoids in figures 1.3
+ *   and 1.4, which are most of the work) are looked up in tables built by ik_init() and interpolated.  The tables
+ *   are in SRAM (IK_TABLE_SIZE bytes).
+ * See ik/main.test for how close each is to the exact solution, and how long they take.
+ */
+#define IK_ENGINE_DOUBLE		0
+#define IK_ENGINE_FIXED			1
+#define IK_ENGINE_TABLE			2
+
+#ifndef IK_ENGINE
+#define IK_ENGINE				IK_ENGINE_FIXED
+#endif
+
+#define IK_SHIFT				4
+#define IK_SCALE				(1 << IK_SHIFT)
+
+//µs of phase per dcmath angle count (a turn is 65536) in Q16, for the fixed point engines
+#define IK_SERVO_PHASE			((int32_t) ((PHASE_MAX - PHASE_MIN) / SERVO_TRAVEL * 2 * M_PI + 0.5))
+#define IK_COXA_PHASE			((int32_t) (COXA_PHASE_MULTIPLIER * 2 * M_PI - 0.5))
+
+//The linkage tables have the phase for every 2^IK_TABLE_SHIFT counts of joint angle from 0 to PI
+#define IK_TABLE_SHIFT			8
+#define IK_TABLE_COUNT			((32768 >> IK_TABLE_SHIFT) + 1)
+#define IK_TABLE_SIZE			(IK_TABLE_COUNT * 2 * sizeof(int16_t))
+
+void ik_solve_double(int16_t x, int16_t y, int16_t z, int16_t* phase);
+void ik_solve_fixed(int16_t x, int16_t y, int16_t z, int16_t* phase);
+void ik_init_table();
+void ik_solve_table(int16_t x, int16_t y, int16_t z, int16_t* phase);
+
+//The joint angles for IK_ENGINE_FIXED and IK_ENGINE_TABLE, as dcmath fractions of a turn
+void ik_angles_fixed(int16_t x, int16_t y, int16_t z, uint16_t* angle);
+//The phase for the TIBIA or FEMUR joint at the given angle in radians, from the double engine; ik_init_table() uses it
+double ik_linkage_double(uint8_t joint, double angle);
+
+#if IK_ENGINE == IK_ENGINE_DOUBLE
+#define ik_init()
+#define ik_solve				ik_solve_double
+#elif IK_ENGINE == IK_ENGINE_FIXED
+#define ik_init()
+#define ik_solve				ik_solve_fixed
+#elif IK_ENGINE == IK_ENGINE_TABLE
+#define ik_init					ik_init_table
+#define ik_solve				ik_solve_table
+#else
+#error Unsupported IK_ENGINE value.
+#endif
+
+#endif
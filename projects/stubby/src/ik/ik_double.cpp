@@ -0,0 +1,69 @@
+#include "ik.h"
+
+#include <math.h>
+#include <dcutil/dcmath.h>
+
+/*
+ * Returns the angle with the given cosine, saturating for points out of reach (rather than the NAN from acos_f)
+ */
+static double acos_sat(double value){
+	if (value >= 1) return 0;
+	if (value <= -1) return M_PI;
+	return acos_f(value);
+}
+
+/*
+ * Returns the angle which the servo needs to move from neutral.  Used for both tibia and femur.
+ */
+static double solveServoTrapezoid(double desired_angle, double length_a, double length_b, double length_c, double length_d, double angle_E_offset, double angle_E_offset2, double angle_N){
+	//See diagrams in doc/diagrams.pdf for description of sides and angles
+	//Use law of cosines to find the length of the line between the control rod connection point and the servo shaft
+	double length_e = sqrt(length_d * length_d + length_a * length_a - 2 * length_d * length_a * cos_f(desired_angle + angle_E_offset));
+
+	//Use law of cosines to find the angle between the line we just calculated (e) and the line between the servo shaft and servo horn / control rod connection (b)
+	double angle_C = acos_sat((length_e * length_e + length_b * length_b - length_c * length_c) / (2 * length_e * length_b));
+	//Use law of cosines to find the angle between the line we just calculated (e) and the line between the joint and the servo shaft (d)
+	double angle_D = acos_sat((length_e * length_e + length_a * length_a - length_d * length_d) / (2 * length_e * length_a));
+
+	return (angle_C + angle_D + angle_E_offset2) - angle_N;
+}
+
+double ik_linkage_double(uint8_t joint, double angle){
+	if (joint == TIBIA) return solveServoTrapezoid(angle, TIBIA_A, TIBIA_B, TIBIA_C, TIBIA_D, TIBIA_E_OFFSET_ANGLE, TIBIA_E_OFFSET_ANGLE, TIBIA_NEUTRAL_SERVO_ANGLE) * ((PHASE_MAX - PHASE_MIN) / SERVO_TRAVEL);
+	else return solveServoTrapezoid(angle, FEMUR_A, FEMUR_B, FEMUR_C, FEMUR_D, FEMUR_E_OFFSET_ANGLE, FEMUR_E_OFFSET_ANGLE, FEMUR_NEUTRAL_SERVO_ANGLE) * ((PHASE_MAX - PHASE_MIN) / SERVO_TRAVEL);
+}
+
+static void ik_phases_double(double x, double y, double z, double* phase){
+	//Find the angle of the leg, used to set the coxa joint.  See figure 2.1, 'coxa angle'.
+	double coxa_angle = atan2(y, x);
+
+	//Find the length of the leg, from coxa joint to end of tibia, on the x,y plane (to be later
+	// used for X,Z inverse kinematics).  See figure 2.1, 'leg length', 'p.x', and 'p.y'.
+	double leg_length = sqrt((x * x) + (y * y));
+
+	//Find the distance between the femur joint and the end of the tibia.  Do this using the
+	// right triangle of (FEMUR_HEIGHT + COXA_HEIGHT - z), (leg_length - COXA_LENGTH).  See figure
+	// 2.2, 'leg extension'
+	double leg_extension = sqrt((FEMUR_HEIGHT + COXA_HEIGHT - z) * (FEMUR_HEIGHT + COXA_HEIGHT - z) + (leg_length - COXA_LENGTH) * (leg_length - COXA_LENGTH));
+	//Find the first part of the femur angle using law of cosines.  See figure 2.2 for a diagram of this.
+	double femur_angle_a = acos_sat((((FEMUR_HEIGHT + COXA_HEIGHT - z) * (FEMUR_HEIGHT + COXA_HEIGHT - z)) + (leg_extension * leg_extension) - ((leg_length - COXA_LENGTH) * (leg_length - COXA_LENGTH))) / (2 * (FEMUR_HEIGHT + COXA_HEIGHT - z) * leg_extension));
+	//Find the second part of the femur angle using law of cosines.  See figure 2.3 for a diagram of this.
+	double femur_angle_b = acos_sat(((FEMUR_LENGTH * FEMUR_LENGTH) + (leg_extension * leg_extension) - (TIBIA_LENGTH * TIBIA_LENGTH)) / (2 * FEMUR_LENGTH * leg_extension));
+	double femur_angle = femur_angle_a + femur_angle_b;
+
+	//Find the desired tibia angle using law of cosines.  See figure 2.4 for a diagram of this.
+	double tibia_angle = acos_sat(((FEMUR_LENGTH * FEMUR_LENGTH) + (TIBIA_LENGTH * TIBIA_LENGTH) - (leg_extension * leg_extension)) / (2 * FEMUR_LENGTH * TIBIA_LENGTH));
+
+	//Convert the joint angles to servo angles, and then to phase.  For the Coxa we just use a linear equation (see COXA_PHASE_MULTIPLIER).
+	phase[TIBIA] = ik_linkage_double(TIBIA, tibia_angle);
+	phase[FEMUR] = ik_linkage_double(FEMUR, femur_angle);
+	phase[COXA] = coxa_angle * COXA_PHASE_MULTIPLIER;
+}
+
+void ik_solve_double(int16_t x, int16_t y, int16_t z, int16_t* phase){
+	double result[JOINT_COUNT];
+	ik_phases_double((double) x / IK_SCALE, (double) y / IK_SCALE, (double) z / IK_SCALE, result);
+	for (uint8_t j = 0; j < JOINT_COUNT; j++){
+		phase[j] = (int16_t) lround(result[j]);
+	}
+}
@@ -0,0 +1,101 @@
+#include "ik.h"
+
+#include <math.h>
+#include <dcutil/dcmath.h>
+
+//Squared lengths are in 1/IK_SCALE^2 mm^2, and angles are dcmath fractions of a turn.  The geometry is rounded
+// once, at compile time, from the doubles in Leg.h.
+#define SQUARE(mm)				((int32_t) ((mm) * (mm) * IK_SCALE * IK_SCALE + 0.5))
+#define ANGLE(radians)			((uint16_t) (int32_t) ((radians) * (32768 / M_PI) + 0.5))
+
+//Lengths in 1/IK_SCALE^2 mm.  Near full extension 1/IK_SCALE mm of leg extension is worth several µs.
+#define LENGTH_FINE(mm)			((int32_t) ((mm) * IK_SCALE * IK_SCALE + 0.5))
+
+//The constants for solving a servo trapezoid (see figures 1.3 and 1.4)
+typedef struct linkage {
+	int32_t ad2;				//a^2 + d^2
+	int32_t ad;					//2 * a * d, cut by 4 bits so that multiplying by a Q14 cosine fits
+	int32_t c_num;				//b^2 - c^2, for the law of cosines for angle C
+	int32_t c_sum2;				//(b + c)^2 and (b - c)^2, for the area of the triangle around angle C
+	int32_t c_diff2;
+	int32_t d_num;				//a^2 - d^2, for angle D
+	int32_t d_sum2;				//(a + d)^2 and (a - d)^2
+	int32_t d_diff2;
+	uint16_t e_offset;
+	uint16_t neutral;
+} linkage_t;
+
+#define LINKAGE(a, b, c, d, e_offset, neutral) { \
+	SQUARE(a) + SQUARE(d), (int32_t) (2 * (a) * (d) * IK_SCALE * IK_SCALE / 16 + 0.5), \
+	SQUARE(b) - SQUARE(c), SQUARE((b) + (c)), SQUARE((b) - (c)), \
+	SQUARE(a) - SQUARE(d), SQUARE((a) + (d)), SQUARE((a) - (d)), \
+	ANGLE(e_offset), ANGLE(neutral) }
+
+static const linkage_t tibia = LINKAGE(TIBIA_A, TIBIA_B, TIBIA_C, TIBIA_D, TIBIA_E_OFFSET_ANGLE, TIBIA_NEUTRAL_SERVO_ANGLE);
+static const linkage_t femur = LINKAGE(FEMUR_A, FEMUR_B, FEMUR_C, FEMUR_D, FEMUR_E_OFFSET_ANGLE, FEMUR_NEUTRAL_SERVO_ANGLE);
+
+/*
+ * Returns the angle between two sides of a triangle, given the law of cosines numerator for the angle (num), the
+ * square of one of the three sides (e2), and the squares of the sum and difference of the other two.  Rather than
+ * acos(num / 2xy), which is poorly conditioned near 0 and PI (and the trapezoids work right up to there), this is
+ * atan2(4 * area, num), with the area from Heron's formula: 16 * area^2 = ((x + y)^2 - e2) * (e2 - (x - y)^2),
+ * whichever two sides x and y are.  Out of reach the area is 0, so it saturates to 0 or PI.
+ */
+static uint16_t cosine_rule(int32_t num, int32_t e2, int32_t sum2, int32_t diff2){
+	int32_t outer = sum2 - e2;
+	int32_t inner = e2 - diff2;
+	//With 8 more bits going into the square roots the area is in 1/2^16 mm^2, so num is scaled to match
+	int32_t area = (outer <= 0 || inner <= 0) ? 0 : (int32_t) sqrt_q((uint32_t) outer << 8) * sqrt_q((uint32_t) inner << 8);
+	num <<= 16 - 2 * IK_SHIFT;
+
+	while (area > INT16_MAX || num > INT16_MAX || num < -INT16_MAX){
+		area >>= 1;
+		num >>= 1;
+	}
+	return atan2_q(area, num);
+}
+
+/*
+ * Returns the angle which the servo needs to move from neutral.  See solveServoTrapezoid() in ik_double.cpp.
+ */
+static int16_t solveServoTrapezoid(uint16_t desired_angle, const linkage_t* l){
+	int32_t length_e2 = l->ad2 - ((l->ad * cos_q(desired_angle + l->e_offset)) >> 10);
+
+	uint16_t angle_C = cosine_rule(length_e2 + l->c_num, length_e2, l->c_sum2, l->c_diff2);
+	uint16_t angle_D = cosine_rule(length_e2 + l->d_num, length_e2, l->d_sum2, l->d_diff2);
+
+	return (int16_t) (uint16_t) (angle_C + angle_D + l->e_offset - l->neutral);
+}
+
+static int16_t toPhase(int16_t angle, int32_t multiplier){
+	return (int16_t) (((int32_t) angle * multiplier + 32768) >> 16);
+}
+
+void ik_angles_fixed(int16_t x, int16_t y, int16_t z, uint16_t* angle){
+	//Figure 2.1, 'coxa angle' and 'leg length'.  The leg length is fine (see LENGTH_FINE), except past 255mm, which is
+	// out of reach anyway.
+	angle[COXA] = atan2_q(y, x);
+	uint32_t leg_length2 = (int32_t) x * x + (int32_t) y * y;
+	int32_t leg_length = leg_length2 < ((uint32_t) 1 << 24) ? sqrt_q(leg_length2 << (2 * IK_SHIFT)) : (int32_t) sqrt_q(leg_length2) << IK_SHIFT;
+
+	//Figure 2.2, the right triangle of height (FEMUR_HEIGHT + COXA_HEIGHT - z), width (leg_length - COXA_LENGTH),
+	// and hypotenuse 'leg extension'.  The law of cosines there reduces to the angle of the hypotenuse from vertical.
+	int32_t height = LENGTH_FINE(FEMUR_HEIGHT + COXA_HEIGHT) - ((int32_t) z << IK_SHIFT);
+	int32_t width = leg_length - LENGTH_FINE(COXA_LENGTH);
+	int32_t leg_extension2 = (((uint32_t) height * height) >> (2 * IK_SHIFT)) + (((uint32_t) width * width) >> (2 * IK_SHIFT));
+	uint16_t femur_angle_a = atan2_q((width < 0 ? -width : width) >> IK_SHIFT, height >> IK_SHIFT);
+
+	//Figures 2.3 and 2.4
+	uint16_t femur_angle_b = cosine_rule(SQUARE(FEMUR_LENGTH) - SQUARE(TIBIA_LENGTH) + leg_extension2, leg_extension2, SQUARE(FEMUR_LENGTH + TIBIA_LENGTH), SQUARE(FEMUR_LENGTH - TIBIA_LENGTH));
+	angle[FEMUR] = femur_angle_a + femur_angle_b;
+	angle[TIBIA] = cosine_rule(SQUARE(FEMUR_LENGTH) + SQUARE(TIBIA_LENGTH) - leg_extension2, leg_extension2, SQUARE(FEMUR_LENGTH + TIBIA_LENGTH), SQUARE(FEMUR_LENGTH - TIBIA_LENGTH));
+}
+
+void ik_solve_fixed(int16_t x, int16_t y, int16_t z, int16_t* phase){
+	uint16_t angle[JOINT_COUNT];
+	ik_angles_fixed(x, y, z, angle);
+
+	phase[TIBIA] = toPhase(solveServoTrapezoid(angle[TIBIA], &tibia), IK_SERVO_PHASE);
+	phase[FEMUR] = toPhase(solveServoTrapezoid(angle[FEMUR], &femur), IK_SERVO_PHASE);
+	phase[COXA] = toPhase((int16_t) angle[COXA], IK_COXA_PHASE);
+}
@@ -0,0 +1,34 @@
+#include "ik.h"
+
+#include <math.h>
+#include <dcutil/dcmath.h>
+
+//Phase for each joint angle (see IK_TABLE_SHIFT), in 1/IK_SCALE µs so that interpolating does not add rounding
+static int16_t tibia[IK_TABLE_COUNT];
+static int16_t femur[IK_TABLE_COUNT];
+
+static int16_t lookup(const int16_t* table, uint16_t angle){
+	//Past PI (which is out of reach) the last entry is used
+	if (angle >= 32768) return (table[IK_TABLE_COUNT - 1] + (IK_SCALE / 2)) >> IK_SHIFT;
+	uint16_t i = angle >> IK_TABLE_SHIFT;
+	int32_t fraction = angle & ((1 << IK_TABLE_SHIFT) - 1);
+	int32_t value = ((int32_t) table[i] << IK_TABLE_SHIFT) + (table[i + 1] - table[i]) * fraction;
+	return (value + ((int32_t) 1 << (IK_TABLE_SHIFT + IK_SHIFT - 1))) >> (IK_TABLE_SHIFT + IK_SHIFT);
+}
+
+void ik_init_table(){
+	for (uint16_t i = 0; i < IK_TABLE_COUNT; i++){
+		double angle = angleQToRad((uint32_t) i << IK_TABLE_SHIFT);
+		tibia[i] = lround(ik_linkage_double(TIBIA, angle) * IK_SCALE);
+		femur[i] = lround(ik_linkage_double(FEMUR, angle) * IK_SCALE);
+	}
+}
+
+void ik_solve_table(int16_t x, int16_t y, int16_t z, int16_t* phase){
+	uint16_t angle[JOINT_COUNT];
+	ik_angles_fixed(x, y, z, angle);
+
+	phase[TIBIA] = lookup(tibia, angle[TIBIA]);
+	phase[FEMUR] = lookup(femur, angle[FEMUR]);
+	phase[COXA] = ((int32_t) (int16_t) angle[COXA] * IK_COXA_PHASE + 32768) >> 16;
+}